@@ -0,0 +1,345 @@
+/**
+    Microbenchmarks of the parser, the assembly and the solver kernels.
+
+    Usage: bench_glls [--json file] [--filter name] [--repetitions n]
+                      [--warmup n] [--scale f]
+*/
+#include "benchmark.h"
+#include "../src/conditionset.h"
+#include "../src/condparser.h"
+#include "../src/condtree.h"
+#include "../src/parsercommon.h"
+#include "../src/solveglls.h"
+#include "../src/symbollist.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+double scale = 1.0;
+
+int scaled(double n)
+{
+    return std::max(1, static_cast<int>(n * scale));
+}
+
+//! a dictionary of the Y names Bz and Br and the X name I
+CondDict makeDict()
+{
+    SymbolList sym;
+    sym.insert("Bz");
+    sym.insert("Br");
+    return CondDict(std::move(sym), "I");
+}
+
+//! `n` condition lines, `nested` ones need more work of finalizeTree()
+std::vector<std::string> conditionLines(int n, bool nested)
+{
+    std::vector<std::string> lines;
+    std::ostringstream os;
+    for (int i = 0; i < n; ++i) {
+        os.str("");
+        if (nested) {
+            os << "(Bz" << i << " - Br" << i+1 << ")*3/2 + 4*(Br" << i+2
+               << " + Bz" << i+3 << ") = 2*(Bz" << i << " - 1.25e-3) + I"
+               << i % 7;
+        } else {
+            os << "Bz" << i << " + 2.5*Br" << i+1 << " = " << i % 17;
+        }
+        lines.push_back(os.str());
+    }
+    return lines;
+}
+
+std::vector<CondTree> parseLines(
+        const std::vector<std::string> &lines,
+        const CondDict &dict
+)
+{
+    std::vector<CondTree> trees;
+    for (const auto &s : lines) {
+        CondParser cp(s.data(), s.data() + s.size(), dict);
+        for (auto &t : cp.parse()) {
+            trees.push_back(std::move(t));
+        }
+    }
+    return trees;
+}
+
+std::size_t totalSize(const std::vector<std::string> &lines)
+{
+    std::size_t n = 0;
+    for (const auto &s : lines) {
+        n += s.size() + 1;
+    }
+    return n;
+}
+
+//! `rows` random coefficient rows of `xSize` X columns and a constant
+GllsProblem randomProblem(int rows, int xSize, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    GllsProblem g;
+    g.xSize = xSize;
+    g.coef.resize(static_cast<std::size_t>(rows) * (xSize+1));
+    for (auto &v : g.coef) {
+        v = dist(gen);
+    }
+    return g;
+}
+
+void benchNextLine(Benchmark &b)
+{
+    const int rows = scaled(200000);
+    std::string text = "# coefficients\nx\ny\n";
+    std::ostringstream os;
+    for (int i = 0; i < rows; ++i) {
+        os << "  " << i % 97 * 0.5 << ' ' << -i % 13 << " 3.25e-2";
+        if (i % 10 == 0) {
+            os << "    # comment\n\n";
+        } else {
+            os << '\n';
+        }
+    }
+    text += os.str();
+    std::unique_ptr<std::istringstream> is;
+    b.run("nextLine", {{"rows", double(rows)}},
+            BenchWork{double(text.size()), double(rows), 0},
+            [&]() { is.reset(new std::istringstream(text)); },
+            [&]() {
+                std::size_t n = 0;
+                for (;;) {
+                    const auto l = nextLine(*is);
+                    if (l.first < 0) {
+                        break;
+                    }
+                    n += l.second.size();
+                }
+                benchKeep(&n);
+            });
+}
+
+void benchLexer(Benchmark &b)
+{
+    const CondDict dict = makeDict();
+    for (const bool nested : {false, true}) {
+        const auto lines = conditionLines(scaled(100000), nested);
+        b.run("CondLexer",
+                {{"lines", double(lines.size())}, {"nested", double(nested)}},
+                BenchWork{double(totalSize(lines)), double(lines.size()), 0},
+                [&]() {
+                    std::size_t tokens = 0;
+                    for (const auto &s : lines) {
+                        CondLexer lexer(s.data(), s.data() + s.size(), dict);
+                        typedef CondLexer::Token Token;
+                        Token t;
+                        while ((t = lexer.token()) != Token::TK_EOF) {
+                            if (t == Token::TK_INVALID) {
+                                throw std::logic_error(lexer.msg());
+                            }
+                            ++tokens;
+                        }
+                    }
+                    benchKeep(&tokens);
+                });
+    }
+}
+
+void benchFinalizeTree(Benchmark &b)
+{
+    const CondDict dict = makeDict();
+    for (const bool nested : {false, true}) {
+        const auto lines = conditionLines(scaled(50000), nested);
+        const auto parsed = parseLines(lines, dict);
+        std::vector<CondTree> trees;
+        b.run("finalizeTree",
+                {{"trees", double(parsed.size())}, {"nested", double(nested)}},
+                BenchWork{0, double(parsed.size()), 0},
+                [&]() { trees = std::vector<CondTree>(parsed); },
+                [&]() {
+                    for (auto &t : trees) {
+                        if (finalizeTree(t) != FinalizationStatus::SUCCESS) {
+                            throw std::logic_error("finalizeTree");
+                        }
+                    }
+                    benchKeep(trees.data());
+                });
+    }
+}
+
+void benchToList(Benchmark &b)
+{
+    const CondDict dict = makeDict();
+    for (const bool nested : {false, true}) {
+        auto trees = parseLines(conditionLines(scaled(50000), nested), dict);
+        for (auto &t : trees) {
+            finalizeTree(t);
+        }
+        b.run("toList",
+                {{"trees", double(trees.size())}, {"nested", double(nested)}},
+                BenchWork{0, double(trees.size()), 0},
+                [&]() {
+                    std::size_t terms = 0;
+                    for (const auto &t : trees) {
+                        terms += toList(t).size();
+                    }
+                    benchKeep(&terms);
+                });
+    }
+}
+
+void benchArrangeX(Benchmark &b)
+{
+    const int rows = scaled(20000);
+    for (const int xSize : {8, 64}) {
+        const GllsProblem source = randomProblem(rows, xSize, 1);
+        // every other X is fixed
+        std::vector<std::pair<int, double> > xs;
+        for (int i = 0; i < xSize; i += 2) {
+            xs.emplace_back(i, 0.5 * i);
+        }
+        GllsProblem g;
+        b.run("arrangeX", {{"rows", double(rows)}, {"x", double(xSize)}},
+                BenchWork{8.0 * source.coef.size(), double(rows), 0},
+                [&]() { g = source; },
+                [&]() {
+                    arrangeX(g, xs);
+                    benchKeep(g.coef.data());
+                });
+    }
+}
+
+void benchArrangeY(Benchmark &b)
+{
+    const int rows = scaled(20000);
+    for (const int xSize : {8, 64}) {
+        const GllsProblem source = randomProblem(rows, xSize, 2);
+        // conditions of three Y each, spread over M
+        ConditionSet ys;
+        const int conds = rows / 2;
+        for (int i = 0; i < conds; ++i) {
+            ys.addTerm(i, 1.0);
+            ys.addTerm((i * 7 + 3) % rows, -2.0);
+            ys.addTerm((i * 13 + 5) % rows, 0.5);
+            ys.addConstant(i % 5);
+            ys.endRow();
+        }
+        GllsProblem g;
+        b.run("arrangeY",
+                {{"rows", double(rows)}, {"x", double(xSize)},
+                 {"conditions", double(conds)}},
+                BenchWork{8.0 * 3 * conds * (xSize+1), double(conds), 0},
+                [&]() { g = source; },
+                [&]() {
+                    arrangeY(g, ys);
+                    benchKeep(g.coef.data());
+                });
+    }
+}
+
+/**
+    the arranged problem is solved as a whole; the operation count is
+    nominal, i.e. of the dense normal matrix, LU and substitution
+*/
+void benchSolve(Benchmark &b, const char *name, int rows, int xSize)
+{
+    const GllsProblem g = randomProblem(rows, xSize, 3);
+    const double m = rows;
+    const double n = xSize;
+    double flops;
+    if (rows > xSize) {
+        flops = 2*m*n*n + 2.0/3*n*n*n + 4*m*n;
+    } else if (rows < xSize) {
+        flops = 2*n*m*m + 2.0/3*m*m*m + 4*m*n;
+    } else {
+        flops = 2.0/3*n*n*n + 2*n*n;
+    }
+    b.run(name, {{"rows", double(rows)}, {"x", double(xSize)}},
+            BenchWork{8.0 * g.coef.size(), m, flops},
+            [&]() {
+                const auto x = solve(g);
+                benchKeep(x.data());
+            });
+}
+
+void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [--json file] [--filter name] [--repetitions n]"
+                 " [--warmup n] [--scale f]\n"
+              << "  --json F        write the results as JSON to F, "
+                 "- for stdout\n"
+              << "  --filter NAME   run the cases whose name contains NAME\n"
+              << "  --repetitions N timed repetitions of every case, "
+                 "default 15\n"
+              << "  --warmup N      untimed repetitions first, default 2\n"
+              << "  --scale F       multiply the problem sizes by F\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Benchmark::Options options;
+    std::string json;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i+1 < argc;
+        if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            json = argv[++i];
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scale") == 0 && hasValue) {
+            scale = std::atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.repetitions < 1 || options.warmup < 0 || !(scale > 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Benchmark b(options);
+    try {
+        benchNextLine(b);
+        benchLexer(b);
+        benchFinalizeTree(b);
+        benchToList(b);
+        benchArrangeX(b);
+        benchArrangeY(b);
+        benchSolve(b, "solve/ls", scaled(4000), 100);
+        benchSolve(b, "solve/minnorm", 100, scaled(4000));
+        benchSolve(b, "solve/exact", 200, 200);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    b.writeText(json == "-" ? std::cerr : std::cout);
+    if (json == "-") {
+        b.writeJson(std::cout);
+    } else if (!json.empty()) {
+        std::ofstream os(json);
+        b.writeJson(os);
+        if (!os) {
+            std::cerr << "failed to write " << json << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
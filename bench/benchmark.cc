@@ -0,0 +1,162 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+double BenchResult::percentile(double p) const
+{
+    if (seconds.empty()) {
+        return 0.0;
+    }
+    const double pos = p / 100.0 * (seconds.size() - 1);
+    const std::size_t i = static_cast<std::size_t>(pos);
+    if (i + 1 >= seconds.size()) {
+        return seconds.back();
+    }
+    return seconds[i] + (pos - i) * (seconds[i+1] - seconds[i]);
+}
+
+double BenchResult::mean() const
+{
+    if (seconds.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(seconds.begin(), seconds.end(), 0.0)
+            / seconds.size();
+}
+
+Benchmark::Benchmark(const Options &options)
+    : options_(options)
+{
+}
+
+bool Benchmark::run(
+        const std::string &name,
+        const Shape &shape,
+        const BenchWork &work,
+        const std::function<void()> &setup,
+        const std::function<void()> &run
+)
+{
+    if (name.find(options_.filter) == std::string::npos) {
+        return false;
+    }
+    typedef std::chrono::steady_clock Clock;
+    BenchResult r;
+    r.name = name;
+    r.shape = shape;
+    r.work = work;
+    for (int i = 0; i < options_.warmup; ++i) {
+        setup();
+        run();
+    }
+    for (int i = 0; i < options_.repetitions; ++i) {
+        setup();
+        const auto start = Clock::now();
+        run();
+        r.seconds.push_back(
+                std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(r.seconds.begin(), r.seconds.end());
+    results_.push_back(std::move(r));
+    return true;
+}
+
+static std::string shapeText(const BenchResult &r)
+{
+    std::ostringstream os;
+    for (std::size_t i = 0; i < r.shape.size(); ++i) {
+        os << (i ? "," : "") << r.shape[i].first << '=' << r.shape[i].second;
+    }
+    return os.str();
+}
+
+void Benchmark::writeText(std::ostream &os) const
+{
+    for (const auto &r : results_) {
+        const double t = r.median();
+        os << std::left << std::setw(14) << r.name << ' '
+           << std::setw(32) << shapeText(r) << std::right
+           << " median " << std::setw(10) << t * 1e3 << " ms"
+           << "  p10 " << std::setw(10) << r.percentile(10) * 1e3
+           << "  p90 " << std::setw(10) << r.percentile(90) * 1e3;
+        if (r.work.bytes > 0) {
+            os << "  " << r.work.bytes / t / 1e6 << " MB/s";
+        }
+        if (r.work.rows > 0) {
+            os << "  " << r.work.rows / t << " rows/s";
+        }
+        if (r.work.flops > 0) {
+            os << "  " << r.work.flops / t / 1e9 << " GFLOP/s";
+        }
+        os << '\n';
+    }
+}
+
+static void jsonString(std::ostream &os, const std::string &s)
+{
+    os << '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+
+void Benchmark::writeJson(std::ostream &os) const
+{
+    const auto precision = os.precision(9);
+    os << "{\n  \"warmup\": " << options_.warmup
+       << ",\n  \"repetitions\": " << options_.repetitions
+#ifdef NDEBUG
+       << ",\n  \"assertions\": false"
+#else
+       << ",\n  \"assertions\": true"
+#endif
+       << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+        const auto &r = results_[i];
+        const double t = r.median();
+        os << (i ? "," : "") << "\n    {\"name\": ";
+        jsonString(os, r.name);
+        os << ", \"shape\": {";
+        for (std::size_t k = 0; k < r.shape.size(); ++k) {
+            os << (k ? ", " : "");
+            jsonString(os, r.shape[k].first);
+            os << ": " << r.shape[k].second;
+        }
+        os << "},\n     \"seconds\": {\"min\": " << r.seconds.front()
+           << ", \"p10\": " << r.percentile(10)
+           << ", \"median\": " << t
+           << ", \"p90\": " << r.percentile(90)
+           << ", \"max\": " << r.seconds.back()
+           << ", \"mean\": " << r.mean() << '}';
+        if (r.work.bytes > 0) {
+            os << ",\n     \"mb_per_s\": " << r.work.bytes / t / 1e6;
+        }
+        if (r.work.rows > 0) {
+            os << ",\n     \"rows_per_s\": " << r.work.rows / t;
+        }
+        if (r.work.flops > 0) {
+            os << ",\n     \"gflop_per_s\": " << r.work.flops / t / 1e9;
+        }
+        os << '}';
+    }
+    os << "\n  ]\n}\n";
+    os.precision(precision);
+}
+
+namespace {
+const void *volatile sink;
+} // namespace
+
+void benchKeep(const void *p)
+{
+    sink = p;
+}
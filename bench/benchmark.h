@@ -0,0 +1,87 @@
+/**
+*   @file benchmark.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_BENCHMARK_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_BENCHMARK_H_
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! the work of one repetition, for the throughput figures; 0 if not applicable
+struct BenchWork
+{
+    double bytes;
+    double rows;
+    //! nominal floating point operations
+    double flops;
+};
+
+struct BenchResult
+{
+    std::string name;
+    //! the parameters of the shape, e.g. {"rows", 10000}
+    std::vector<std::pair<std::string, double> > shape;
+    BenchWork work;
+    //! wall time of every timed repetition in seconds, sorted
+    std::vector<double> seconds;
+    //! linearly interpolated, p in [0, 100]
+    double percentile(double p) const;
+    double median() const { return percentile(50); }
+    double mean() const;
+};
+
+/**
+    @brief a minimal timing harness
+
+    Every case runs `warmup` untimed and then `repetitions` timed
+    repetitions. A repetition calls `setup` untimed and then `run` timed,
+    e.g. to restore an input that `run` consumes.
+*/
+class Benchmark
+{
+public:
+    struct Options
+    {
+        Options() : warmup(2), repetitions(15) {}
+        int warmup;
+        int repetitions;
+        //! only cases whose name contains this are run
+        std::string filter;
+    };
+    explicit Benchmark(const Options &options = Options());
+    typedef std::vector<std::pair<std::string, double> > Shape;
+    //! @return false if the case was filtered out
+    bool run(
+            const std::string &name,
+            const Shape &shape,
+            const BenchWork &work,
+            const std::function<void()> &setup,
+            const std::function<void()> &run
+    );
+    bool run(
+            const std::string &name,
+            const Shape &shape,
+            const BenchWork &work,
+            const std::function<void()> &run
+    )
+        { return this->run(name, shape, work, []() {}, run); }
+    const std::vector<BenchResult> &results() const { return results_; }
+    //! one line per case
+    void writeText(std::ostream &) const;
+    //! a JSON object with a "results" array, see readme.md
+    void writeJson(std::ostream &) const;
+private:
+    Options options_;
+    std::vector<BenchResult> results_;
+};
+
+/**
+    @brief make a result observable, so that the computation of it is not
+           optimized away
+*/
+void benchKeep(const void *);
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_BENCHMARK_H_
@@ -0,0 +1,290 @@
+/**
+    Throughput of the whole solve of generated workloads, compared with a
+    baseline, see readme.md.
+
+    Usage: perfcheck_glls --baseline file [--tolerance t] [--repetitions n]
+                          [--retries n] [--update]
+*/
+#include "benchmark.h"
+#include "../src/glls.h"
+#include "../tools/generator.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+//! the baseline section of this build, the debug build is much slower
+#ifdef NDEBUG
+const char *const FLAVOR = "release";
+#else
+const char *const FLAVOR = "debug";
+#endif
+
+struct Workload
+{
+    const char *name;
+    GeneratorOptions options;
+};
+
+GeneratorOptions shape(int xSize, long rows, long conditions,
+        int plain, int nested, int chained, int aggregate, int depth = 3)
+{
+    GeneratorOptions o;
+    o.xSize = xSize;
+    o.rows = rows;
+    o.conditions = conditions;
+    o.plain = plain;
+    o.nested = nested;
+    o.chained = chained;
+    o.aggregate = aggregate;
+    o.depth = depth;
+    return o;
+}
+
+const Workload workloads[] = {
+    {"tall_ls", shape(40, 6000, 2000, 4, 2, 1, 1)},
+    // the ranges of the aggregates keep the conditions independent
+    {"wide_minnorm", shape(400, 402, 200, 0, 0, 0, 1)},
+    {"square_exact", shape(120, 360, 120, 0, 0, 0, 1)},
+    {"deep_nesting", shape(10, 1500, 500, 0, 1, 0, 0, 8)},
+    {"many_conditions", shape(20, 6000, 10000, 1, 0, 0, 1)},
+};
+
+typedef std::map<std::string, std::map<std::string, double> > Baseline;
+
+void skipSpace(std::istream &is)
+{
+    while (std::isspace(is.peek())) {
+        is.get();
+    }
+}
+
+void expect(std::istream &is, char c)
+{
+    skipSpace(is);
+    if (is.get() != c) {
+        throw std::runtime_error(std::string("baseline: expected ") + c);
+    }
+}
+
+std::string readString(std::istream &is)
+{
+    expect(is, '"');
+    std::string s;
+    std::getline(is, s, '"');
+    return s;
+}
+
+//! @return whether the next character closes the object
+bool nextMember(std::istream &is, bool first)
+{
+    skipSpace(is);
+    if (is.peek() == '}') {
+        is.get();
+        return false;
+    }
+    if (!first) {
+        expect(is, ',');
+    }
+    return true;
+}
+
+//! an object of objects of numbers, as written by writeBaseline()
+Baseline readBaseline(std::istream &is)
+{
+    Baseline b;
+    expect(is, '{');
+    for (bool first = true; nextMember(is, first); first = false) {
+        auto &section = b[readString(is)];
+        expect(is, ':');
+        expect(is, '{');
+        for (bool f = true; nextMember(is, f); f = false) {
+            const std::string name = readString(is);
+            expect(is, ':');
+            double v;
+            if (!(is >> v)) {
+                throw std::runtime_error("baseline: expected a number");
+            }
+            section[name] = v;
+        }
+    }
+    return b;
+}
+
+void writeBaseline(std::ostream &os, const Baseline &b)
+{
+    os << "{";
+    const char *sep = "\n";
+    for (const auto &section : b) {
+        os << sep << "  \"" << section.first << "\": {";
+        const char *inner = "\n";
+        for (const auto &w : section.second) {
+            os << inner << "    \"" << w.first << "\": "
+               << std::setprecision(4) << w.second;
+            inner = ",\n";
+        }
+        os << "\n  }";
+        sep = ",\n";
+    }
+    os << "\n}\n";
+}
+
+//! the median MB/s of the input of a workload, and the relative spread
+std::pair<double, double> measure(
+        const std::string &name,
+        const std::string &input,
+        int repetitions
+)
+{
+    Benchmark::Options options;
+    options.warmup = 1;
+    options.repetitions = repetitions;
+    Benchmark b(options);
+    std::unique_ptr<std::istringstream> is;
+    b.run(name, {}, BenchWork{double(input.size()), 0, 0},
+            [&]() { is.reset(new std::istringstream(input)); },
+            [&]() {
+                const auto x = glls(*is);
+                benchKeep(x.data());
+            });
+    const BenchResult &r = b.results().front();
+    const double t = r.median();
+    return std::make_pair(input.size() / t / 1e6,
+            (r.percentile(90) - r.percentile(10)) / t);
+}
+
+void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " --baseline file [--tolerance t]"
+                 " [--repetitions n] [--retries n] [--update]\n"
+              << "  --baseline F    the baseline JSON\n"
+              << "  --tolerance T   the allowed loss of throughput, "
+                 "default 0.25\n"
+              << "  --repetitions N timed runs of every workload, "
+                 "default 5\n"
+              << "  --retries N     measure a slower workload again up to "
+                 "N times, default 2\n"
+              << "  --update        write the throughput of this build as "
+                 "the baseline\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string path;
+    double tolerance = 0.25;
+    int repetitions = 5;
+    int retries = 2;
+    bool update = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i+1 < argc;
+        if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+            tolerance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            repetitions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--retries") == 0 && hasValue) {
+            retries = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (path.empty() || repetitions < 1 || retries < 0
+            || !(tolerance >= 0 && tolerance < 1)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Baseline baseline;
+    try {
+        std::ifstream is(path);
+        if (is) {
+            baseline = readBaseline(is);
+        } else if (!update) {
+            std::cerr << "failed to open " << path << std::endl;
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+    auto &expected = baseline[FLAVOR];
+
+    std::cout << std::left << std::setw(18) << "workload" << std::right
+              << std::setw(12) << "baseline" << std::setw(12) << "MB/s"
+              << std::setw(9) << "ratio" << std::setw(9) << "spread"
+              << '\n' << std::fixed << std::setprecision(2);
+    int regressions = 0;
+    for (const auto &w : workloads) {
+        std::ostringstream os;
+        generateInput(os, w.options);
+        const std::string input = os.str();
+        auto m = measure(w.name, input, repetitions);
+        const auto it = expected.find(w.name);
+        const bool known = it != expected.end() && it->second > 0;
+        // a slower run is measured again, the best median counts
+        for (int k = 0; !update && known && k < retries
+                && m.first < it->second * (1 - tolerance); ++k) {
+            const auto again = measure(w.name, input, repetitions);
+            if (again.first > m.first) {
+                m = again;
+            }
+        }
+        std::cout << std::left << std::setw(18) << w.name << std::right
+                  << std::setw(12);
+        if (known) {
+            std::cout << it->second;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(12) << m.first << std::setw(9);
+        if (known) {
+            std::cout << m.first / it->second;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(8) << m.second * 100 << '%';
+        if (update) {
+            expected[w.name] = m.first;
+        } else if (!known) {
+            std::cout << "  no baseline";
+        } else if (m.first < it->second * (1 - tolerance)) {
+            std::cout << "  REGRESSION";
+            ++regressions;
+        }
+        std::cout << std::endl;
+    }
+
+    if (update) {
+        std::ofstream os(path);
+        writeBaseline(os, baseline);
+        if (!os) {
+            std::cerr << "failed to write " << path << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (regressions) {
+        std::cout << regressions << " of " << sizeof(workloads) / sizeof(workloads[0])
+                  << " workloads are slower than the " << FLAVOR
+                  << " baseline by more than " << tolerance * 100 << "%\n";
+        return 1;
+    }
+    return 0;
+}
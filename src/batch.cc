@@ -0,0 +1,164 @@
+#include "batch.h"
+#include "glls.h"
+#include "gllstrace.h"
+#include "parsercommon.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <stdexcept>
+#include <sstream>
+
+void solveBatch(
+        std::size_t count,
+        const std::function<std::string(std::size_t)> &input,
+        ThreadPool &pool,
+        const std::function<void(std::size_t, const BatchResult &)> &emit
+)
+{
+    std::vector<BatchResult> results(count);
+    std::vector<char> done(count, 0);
+    // tasks finished, the pool may run other work, so wait() is not used
+    std::size_t finished = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+    for (std::size_t i = 0; i < count; ++i) {
+        pool.submit([&, i]() {
+            BatchResult r;
+            try {
+                std::istringstream ss(input(i));
+                r.x = glls(ss);
+            } catch (const ParserError &e) {
+                r.error = "Error on input line " + std::to_string(e.line())
+                    + ": " + e.what();
+            } catch (const std::exception &e) {
+                r.error = e.what();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = std::move(r);
+            done[i] = 1;
+            ++finished;
+            cv.notify_all();
+        });
+    }
+    try {
+        for (std::size_t i = 0; i < count; ++i) {
+            BatchResult r;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]{ return done[i] != 0; });
+                r = std::move(results[i]);
+            }
+            emit(i, r);
+        }
+    } catch (...) {
+        // the tasks refer to the locals
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]{ return finished == count; });
+        throw;
+    }
+}
+
+/** X values of `common` and `own`, sorted, the later of equal indices kept */
+static std::vector<std::pair<int, double> > mergeX(
+        const std::vector<std::pair<int, double> > &common,
+        const std::vector<std::pair<int, double> > &own)
+{
+    std::vector<std::pair<int, double> > xs(common);
+    xs.insert(xs.end(), own.cbegin(), own.cend());
+    std::stable_sort(xs.begin(), xs.end(),
+        [](const std::pair<int, double> &a, const std::pair<int, double> &b)
+        { return a.first < b.first; });
+    std::vector<std::pair<int, double> > merged;
+    merged.reserve(xs.size());
+    for (const auto &x : xs) {
+        if (!merged.empty() && merged.back().first == x.first) {
+            merged.back() = x;
+        } else {
+            merged.push_back(x);
+        }
+    }
+    return merged;
+}
+
+std::vector<BlockResult> solveBlocks(
+        std::istream &is, ThreadPool &pool, bool lazy, bool diagnostics)
+{
+    GllsParser gp(is, true);
+    gp.setPool(&pool);
+    gp.setLazy(lazy);
+    gp.setBlocksAllowed(true);
+    const GllsProblem m = gp.run();
+    const auto &blocks = gp.blocks();
+    std::vector<BlockResult> results(std::max<std::size_t>(blocks.size(), 1));
+    // only the blocks are waited for, the pool may be shared
+    pool.parallelFor(results.size(), [&](std::size_t i) {
+        GllsTrace::Span trace("block", "index", i);
+        BlockResult &r = results[i];
+        try {
+            ConditionSet ys = gp.yConds();
+            auto xs = gp.xValues();
+            if (!blocks.empty()) {
+                r.name = blocks[i].name;
+                ys.append(blocks[i].yConds);
+                xs = mergeX(xs, blocks[i].xValues);
+            }
+            if (ys.empty()) {
+                throw std::invalid_argument(
+                        "no condition on the unknown");
+            }
+            GllsProblem g = m;
+            arrangeX(g, xs);
+            arrangeY(g, ys);
+            if (diagnostics) {
+                r.x = solve(g, r.diagnostics);
+                r.worstLine = ys.lineOf(r.diagnostics.worstRow);
+            } else {
+                r.x = solve(g);
+            }
+        } catch (const std::exception &e) {
+            r.x.clear();
+            r.error = e.what();
+        }
+    });
+    return results;
+}
+
+static std::string trim(const std::string &s)
+{
+    const auto notSpace = [](char c)
+        { return !std::isspace(static_cast<unsigned char>(c)); };
+    const auto b = std::find_if(s.cbegin(), s.cend(), notSpace);
+    const auto e = std::find_if(s.crbegin(), s.crend(), notSpace).base();
+    return b < e ? std::string(b, e) : std::string();
+}
+
+std::vector<std::string> splitProblems(
+        std::istream &is, const std::string &delimiter)
+{
+    std::vector<std::string> problems;
+    std::string current;
+    bool blank = true;
+    std::string line;
+    while (std::getline(is, line)) {
+        if (trim(line) == delimiter) {
+            if (!blank) {
+                problems.push_back(std::move(current));
+            }
+            current.clear();
+            blank = true;
+            continue;
+        }
+        blank = blank && trim(line).empty();
+        current += line;
+        current += '\n';
+    }
+    if (!blank) {
+        problems.push_back(std::move(current));
+    }
+    return problems;
+}
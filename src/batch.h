@@ -0,0 +1,87 @@
+/**
+*   @file batch.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_BATCH_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_BATCH_H_
+
+#include "solveglls.h"
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct BatchResult
+{
+    //! the full length `x` vector, empty on failure
+    std::vector<double> x;
+    //! the error message, empty on success
+    std::string error;
+};
+
+/**
+    @brief solve independent problems concurrently
+
+    Problem i is read by input(i) and solved by glls() on a worker of the
+    pool. A failing problem does not affect the others. emit(i, result) is
+    called on the calling thread in the order of i, as soon as the results
+    of all problems up to i are known. Only these tasks are waited for, so
+    the pool may be shared with other work, but the calling thread blocks
+    and must not be a worker of it.
+
+    @param input returns the text of a problem, may throw std::exception
+*/
+void solveBatch(
+        std::size_t count,
+        const std::function<std::string(std::size_t)> &input,
+        ThreadPool &pool,
+        const std::function<void(std::size_t, const BatchResult &)> &emit
+);
+
+struct BlockResult
+{
+    //! the block name, empty for an input without blocks
+    std::string name;
+    //! the full length `x` vector, empty on failure
+    std::vector<double> x;
+    //! the error message, empty on success
+    std::string error;
+    //! only filled if requested
+    GllsDiagnostics diagnostics;
+    //! the input line of diagnostics.worstRow
+    int worstLine;
+};
+
+/**
+    @brief solve every condition block of one input against the same M
+
+    The input is parsed once, see GllsParser::setBlocksAllowed(). Each
+    block is arranged with the common conditions in front of the first
+    header plus its own, and solved on a worker of the pool; a value of X
+    set by the block replaces the common one. An input without blocks gives
+    one unnamed result. The blocks run with ThreadPool::parallelFor(), so
+    the pool may be shared, and this may be called from one of its tasks.
+
+    @param lazy see GllsParser::setLazy()
+    @param diagnostics whether to fill BlockResult::diagnostics
+    @return the results in block order
+    @throw ParserError if the input is invalid
+*/
+std::vector<BlockResult> solveBlocks(
+        std::istream &,
+        ThreadPool &pool,
+        bool lazy = false,
+        bool diagnostics = false
+);
+
+/**
+    @brief split a stream into problems at the lines equal to `delimiter`,
+           ignoring surrounding white space; empty problems are dropped
+*/
+std::vector<std::string> splitProblems(
+        std::istream &, const std::string &delimiter);
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_BATCH_H_
@@ -0,0 +1,54 @@
+/**
+*   @file binaryio.h
+*
+*   Native binary encoding of plain values and vectors, for the files
+*   written and read by the same build, e.g. the cache of GllsCache.
+*   T must be a type that is safe to copy bytewise.
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_BINARYIO_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_BINARYIO_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+template<class T> void writePod(std::ostream &os, const T &v)
+{
+    os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template<class T> bool readPod(std::istream &is, T &v)
+{
+    return static_cast<bool>(is.read(reinterpret_cast<char *>(&v), sizeof(T)));
+}
+
+template<class T> void writeVector(std::ostream &os, const std::vector<T> &v)
+{
+    writePod(os, static_cast<std::uint64_t>(v.size()));
+    if (!v.empty()) {
+        os.write(reinterpret_cast<const char *>(v.data()),
+                static_cast<std::streamsize>(v.size() * sizeof(T)));
+    }
+}
+
+/**
+    @param limit the maximum number of elements accepted, which guards
+           against a huge allocation on a corrupted file
+*/
+template<class T> bool readVector(
+        std::istream &is, std::vector<T> &v, std::uint64_t limit = 1ULL << 40)
+{
+    std::uint64_t n;
+    if (!readPod(is, n) || n > limit / sizeof(T)) {
+        return false;
+    }
+    v.resize(static_cast<std::size_t>(n));
+    if (n > 0) {
+        is.read(reinterpret_cast<char *>(v.data()),
+                static_cast<std::streamsize>(n * sizeof(T)));
+    }
+    return static_cast<bool>(is);
+}
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_BINARYIO_H_
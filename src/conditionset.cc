@@ -0,0 +1,268 @@
+#include "conditionset.h"
+#include "binaryio.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+ConditionSet::ConditionSet()
+    : offsets_(1, 0), rangeOffsets_(1, 0), pendingConstant_(0.0),
+      familyOffsets_(1, 0),
+      pendingFamilyRow_(0), expandedRows_(0)
+{
+}
+
+void ConditionSet::setLine(int line)
+{
+    if (!lines_.empty() && lines_.back().first == expandedRows_) {
+        lines_.back().second = line;
+    } else if (lines_.empty() || lines_.back().second != line) {
+        lines_.push_back(std::make_pair(expandedRows_, line));
+    }
+}
+
+int ConditionSet::lineOf(std::size_t row) const
+{
+    const auto it = std::upper_bound(lines_.cbegin(), lines_.cend(),
+            std::make_pair(row, std::numeric_limits<int>::max()));
+    return it == lines_.cbegin() ? 0 : (it-1)->second;
+}
+
+void ConditionSet::addFamilyTerm(int id, int stride, double coef)
+{
+    familyIds_.push_back(id);
+    familyStrides_.push_back(stride);
+    familyCoefs_.push_back(coef);
+}
+
+void ConditionSet::endFamilyRow(double constant)
+{
+    familyOffsets_.push_back(familyIds_.size());
+    familyConstants_.push_back(constant);
+}
+
+void ConditionSet::endFamily(int count)
+{
+    families_.push_back(
+            Family{size(), pendingFamilyRow_, familyConstants_.size(), count});
+    expandedRows_ += (familyConstants_.size() - pendingFamilyRow_) * count;
+    pendingFamilyRow_ = familyConstants_.size();
+}
+
+void ConditionSet::endRow()
+{
+    std::sort(pending_.begin(), pending_.end(),
+        [](const std::pair<int, double> &a, const std::pair<int, double> &b)
+        { return a.first < b.first; });
+    for (std::size_t i = 0; i < pending_.size(); ++i) {
+        if (i > 0 && pending_[i].first == pending_[i-1].first) {
+            coefs_.back() += pending_[i].second;
+        } else {
+            ids_.push_back(pending_[i].first);
+            coefs_.push_back(pending_[i].second);
+        }
+    }
+    offsets_.push_back(ids_.size());
+    constants_.push_back(pendingConstant_);
+    ranges_.insert(ranges_.end(), pendingRanges_.cbegin(), pendingRanges_.cend());
+    rangeOffsets_.push_back(ranges_.size());
+    pending_.clear();
+    pendingRanges_.clear();
+    pendingConstant_ = 0.0;
+    ++expandedRows_;
+}
+
+void ConditionSet::append(const ConditionSet &cs, int line)
+{
+    setLine(line);
+    const auto lines = std::move(lines_);
+    append(cs);
+    lines_ = std::move(lines);
+}
+
+void ConditionSet::append(const ConditionSet &cs)
+{
+    for (const auto &l : cs.lines_) {
+        lines_.push_back(std::make_pair(expandedRows_ + l.first, l.second));
+    }
+    expandedRows_ += cs.expandedRows_;
+    const std::size_t base = ids_.size();
+    ids_.insert(ids_.end(), cs.ids_.cbegin(), cs.ids_.cend());
+    coefs_.insert(coefs_.end(), cs.coefs_.cbegin(), cs.coefs_.cend());
+    constants_.insert(
+            constants_.end(), cs.constants_.cbegin(), cs.constants_.cend());
+    for (std::size_t i = 1; i < cs.offsets_.size(); ++i) {
+        offsets_.push_back(base + cs.offsets_[i]);
+    }
+    const std::size_t rangeBase = ranges_.size();
+    ranges_.insert(ranges_.end(), cs.ranges_.cbegin(), cs.ranges_.cend());
+    for (std::size_t i = 1; i < cs.rangeOffsets_.size(); ++i) {
+        rangeOffsets_.push_back(rangeBase + cs.rangeOffsets_[i]);
+    }
+    const std::size_t rowBase = size() - cs.size();
+    const std::size_t templBase = familyConstants_.size();
+    const std::size_t termBase = familyIds_.size();
+    for (const auto &f : cs.families_) {
+        families_.push_back(Family{
+                rowBase + f.position,
+                templBase + f.firstRow, templBase + f.lastRow,
+                f.count});
+    }
+    familyIds_.insert(
+            familyIds_.end(), cs.familyIds_.cbegin(), cs.familyIds_.cend());
+    familyStrides_.insert(familyStrides_.end(),
+            cs.familyStrides_.cbegin(), cs.familyStrides_.cend());
+    familyCoefs_.insert(familyCoefs_.end(),
+            cs.familyCoefs_.cbegin(), cs.familyCoefs_.cend());
+    familyConstants_.insert(familyConstants_.end(),
+            cs.familyConstants_.cbegin(), cs.familyConstants_.cend());
+    for (std::size_t i = 1; i < cs.familyOffsets_.size(); ++i) {
+        familyOffsets_.push_back(termBase + cs.familyOffsets_[i]);
+    }
+    pendingFamilyRow_ = familyConstants_.size();
+}
+
+void ConditionSet::reserve(std::size_t rows, std::size_t terms)
+{
+    offsets_.reserve(rows + 1);
+    rangeOffsets_.reserve(rows + 1);
+    constants_.reserve(rows);
+    ids_.reserve(terms);
+    coefs_.reserve(terms);
+}
+
+void ConditionSet::clear()
+{
+    offsets_.resize(1);
+    ids_.clear();
+    coefs_.clear();
+    constants_.clear();
+    rangeOffsets_.resize(1);
+    ranges_.clear();
+    pending_.clear();
+    pendingRanges_.clear();
+    pendingConstant_ = 0.0;
+    families_.clear();
+    familyOffsets_.resize(1);
+    familyIds_.clear();
+    familyStrides_.clear();
+    familyCoefs_.clear();
+    familyConstants_.clear();
+    pendingFamilyRow_ = 0;
+    expandedRows_ = 0;
+    lines_.clear();
+}
+
+void ConditionSet::write(std::ostream &os) const
+{
+    writeVector(os, offsets_);
+    writeVector(os, ids_);
+    writeVector(os, coefs_);
+    writeVector(os, constants_);
+    writeVector(os, rangeOffsets_);
+    writeVector(os, ranges_);
+    writeVector(os, families_);
+    writeVector(os, familyOffsets_);
+    writeVector(os, familyIds_);
+    writeVector(os, familyStrides_);
+    writeVector(os, familyCoefs_);
+    writeVector(os, familyConstants_);
+    std::vector<std::uint64_t> lineRows;
+    std::vector<int> lineNumbers;
+    for (const auto &l : lines_) {
+        lineRows.push_back(l.first);
+        lineNumbers.push_back(l.second);
+    }
+    writeVector(os, lineRows);
+    writeVector(os, lineNumbers);
+}
+
+//! whether `offsets` starts at 0 and never decreases
+static bool isMonotonic(const std::vector<std::size_t> &offsets)
+{
+    return !offsets.empty() && offsets[0] == 0
+        && std::is_sorted(offsets.cbegin(), offsets.cend());
+}
+
+//! whether first + k*stride is a row of M for all k in [0, count)
+static bool inRows(int first, int stride, int count, std::size_t rows)
+{
+    const long long last = first + static_cast<long long>(count - 1) * stride;
+    return count <= 0 || (first >= 0 && static_cast<std::size_t>(first) < rows
+            && last >= 0 && static_cast<unsigned long long>(last) < rows);
+}
+
+bool ConditionSet::read(std::istream &is, std::size_t rows)
+{
+    clear();
+    std::vector<std::uint64_t> lineRows;
+    std::vector<int> lineNumbers;
+    bool ok = readVector(is, offsets_)
+        && readVector(is, ids_)
+        && readVector(is, coefs_)
+        && readVector(is, constants_)
+        && readVector(is, rangeOffsets_)
+        && readVector(is, ranges_)
+        && readVector(is, families_)
+        && readVector(is, familyOffsets_)
+        && readVector(is, familyIds_)
+        && readVector(is, familyStrides_)
+        && readVector(is, familyCoefs_)
+        && readVector(is, familyConstants_)
+        && readVector(is, lineRows)
+        && readVector(is, lineNumbers)
+        && lineRows.size() == lineNumbers.size()
+        && offsets_.size() == constants_.size() + 1
+        && offsets_.back() == ids_.size()
+        && ids_.size() == coefs_.size()
+        && rangeOffsets_.size() == offsets_.size()
+        && rangeOffsets_.back() == ranges_.size()
+        && familyOffsets_.size() == familyConstants_.size() + 1
+        && familyOffsets_.back() == familyIds_.size()
+        && familyIds_.size() == familyStrides_.size()
+        && familyIds_.size() == familyCoefs_.size()
+        && isMonotonic(offsets_) && isMonotonic(rangeOffsets_)
+        && isMonotonic(familyOffsets_);
+    // every row of M referred to exists, arrangeY() does not check
+    for (std::size_t i = 0; ok && i < ids_.size(); ++i) {
+        ok = ids_[i] >= 0 && static_cast<std::size_t>(ids_[i]) < rows;
+    }
+    for (std::size_t i = 0; ok && i < ranges_.size(); ++i) {
+        const Range &r = ranges_[i];
+        ok = r.count >= 0 && inRows(r.first, r.stride, r.count, rows);
+    }
+    std::size_t position = 0;
+    for (std::size_t i = 0; ok && i < families_.size(); ++i) {
+        const Family &f = families_[i];
+        ok = f.position >= position && f.position <= size()
+            && f.firstRow <= f.lastRow
+            && f.lastRow <= familyConstants_.size() && f.count >= 0;
+        position = f.position;
+        for (std::size_t r = f.firstRow; ok && r < f.lastRow; ++r) {
+            const std::size_t end = familyOffsets_[r+1];
+            for (std::size_t t = familyOffsets_[r]; ok && t < end; ++t) {
+                ok = inRows(familyIds_[t], familyStrides_[t], f.count, rows);
+            }
+        }
+    }
+    if (!ok) {
+        clear();
+        return false;
+    }
+    pendingFamilyRow_ = familyConstants_.size();
+    expandedRows_ = size();
+    for (const auto &f : families_) {
+        expandedRows_ += (f.lastRow - f.firstRow) * f.count;
+    }
+    for (std::size_t i = 0; i < lineRows.size(); ++i) {
+        if (lineRows[i] > expandedRows_
+                || (i > 0 && lineRows[i] < lineRows[i-1])) {
+            clear();
+            return false;
+        }
+        lines_.emplace_back(lineRows[i], lineNumbers[i]);
+    }
+    return true;
+}
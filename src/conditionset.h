@@ -0,0 +1,216 @@
+/**
+*   @file conditionset.h
+*/
+
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_CONDITIONSET_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_CONDITIONSET_H_
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <iosfwd>
+
+/**
+    @brief zerofied linear conditions in compressed sparse row form
+
+    Row i stands for
+
+        sum(coefs()[k] * S_ids()[k]) + constants()[i] = 0,
+        k in [rowBegin(i), rowEnd(i))
+
+    where the IDs are the symbol IDs of CondDict. The IDs of one row are
+    sorted and unique. A row is built up term by term with addTerm() and
+    addConstant(); endRow() sorts and merges the pending terms in a small
+    flat buffer and appends them to the shared arrays.
+
+    A plain row may also hold ranges, i.e. sums of the symbols first,
+    first+stride, ..., first+(count-1)*stride scaled by one coefficient.
+
+    Besides the plain rows, a set holds families of rows, which are
+    expanded lazily by forEachRow(). A family repeats its template rows
+    `count` times, where the ID of a template term grows by its stride on
+    every iteration. Families keep their position among the plain rows.
+
+    Optionally, the input line of every row is recorded as runs of expanded
+    rows, see setLine().
+*/
+class ConditionSet
+{
+public:
+    ConditionSet();
+    struct Range
+    {
+        int first;
+        int count;
+        int stride;
+        double coef;
+    };
+    //! a row as seen by forEachRow()
+    struct RowView
+    {
+        const int *ids;
+        const double *coefs;
+        std::size_t size;
+        const Range *ranges;
+        std::size_t rangeCount;
+        double constant;
+    };
+    struct Family
+    {
+        //! number of plain rows in front of the family
+        std::size_t position;
+        //! template rows [firstRow, lastRow)
+        std::size_t firstRow;
+        std::size_t lastRow;
+        //! number of iterations
+        int count;
+    };
+    //! @return number of plain rows
+    std::size_t size() const { return constants_.size(); }
+    //! @return number of rows including the expansion of the families
+    std::size_t expandedSize() const { return expandedRows_; }
+    bool empty() const { return constants_.empty() && families_.empty(); }
+    std::size_t rowBegin(std::size_t row) const { return offsets_[row]; }
+    std::size_t rowEnd(std::size_t row) const { return offsets_[row+1]; }
+    const std::vector<int> &ids() const { return ids_; }
+    const std::vector<double> &coefs() const { return coefs_; }
+    const std::vector<double> &constants() const { return constants_; }
+    std::size_t rangeBegin(std::size_t row) const
+        { return rangeOffsets_[row]; }
+    std::size_t rangeEnd(std::size_t row) const
+        { return rangeOffsets_[row+1]; }
+    const std::vector<Range> &ranges() const { return ranges_; }
+    //! add a term to the pending row
+    void addTerm(int id, double coef) { pending_.emplace_back(id, coef); }
+    //! add a range to the pending row
+    void addRange(int first, int count, int stride, double coef)
+        { pendingRanges_.push_back(Range{first, count, stride, coef}); }
+    //! add a constant to the pending row
+    void addConstant(double c) { pendingConstant_ += c; }
+    //! finish the pending row
+    void endRow();
+    //! add a term to the pending family template row
+    void addFamilyTerm(int id, int stride, double coef);
+    void endFamilyRow(double constant);
+    //! turn the pending template rows into a family of `count` iterations
+    void endFamily(int count);
+    const std::vector<Family> &families() const { return families_; }
+    std::size_t familyRowBegin(std::size_t row) const
+        { return familyOffsets_[row]; }
+    std::size_t familyRowEnd(std::size_t row) const
+        { return familyOffsets_[row+1]; }
+    const std::vector<int> &familyIds() const { return familyIds_; }
+    const std::vector<int> &familyStrides() const { return familyStrides_; }
+    const std::vector<double> &familyCoefs() const { return familyCoefs_; }
+    const std::vector<double> &familyConstants() const
+        { return familyConstants_; }
+    /**
+        @brief visit all rows in order, families are expanded on the fly
+
+        @param f callable as f(const RowView &)
+    */
+    template<class F> void forEachRow(F &&f) const;
+    //! visit the expanded rows [first, last) only
+    template<class F>
+    void forEachRow(std::size_t first, std::size_t last, F &&f) const;
+    //! append all rows of another set, with its lines if it has any
+    void append(const ConditionSet &);
+    //! append all rows of another set as rows of input line `line`
+    void append(const ConditionSet &, int line);
+    //! the rows added from now on belong to input line `line`
+    void setLine(int line);
+    //! @return the input line of an expanded row, 0 if not recorded
+    int lineOf(std::size_t row) const;
+    //! pairs of the first expanded row and the line of each run of rows
+    const std::vector<std::pair<std::size_t, int> > &lines() const
+        { return lines_; }
+    void reserve(std::size_t rows, std::size_t terms);
+    //! remove all rows, the capacity is kept
+    void clear();
+    //! binary encoding for a cache, see binaryio.h
+    void write(std::ostream &) const;
+    /**
+        @param rows the number of rows of M, every ID and every expanded
+               range or family ID must be below it
+        @return false if the data is corrupted or refers to other rows,
+                the set is cleared then
+    */
+    bool read(std::istream &, std::size_t rows);
+private:
+    std::vector<std::size_t> offsets_;
+    std::vector<int> ids_;
+    std::vector<double> coefs_;
+    std::vector<double> constants_;
+    std::vector<std::size_t> rangeOffsets_;
+    std::vector<Range> ranges_;
+    std::vector<std::pair<int, double> > pending_;
+    std::vector<Range> pendingRanges_;
+    double pendingConstant_;
+    std::vector<Family> families_;
+    std::vector<std::size_t> familyOffsets_;
+    std::vector<int> familyIds_;
+    std::vector<int> familyStrides_;
+    std::vector<double> familyCoefs_;
+    std::vector<double> familyConstants_;
+    //! the first template row of the pending family
+    std::size_t pendingFamilyRow_;
+    std::size_t expandedRows_;
+    //! pairs of the first expanded row and the line of a run of rows
+    std::vector<std::pair<std::size_t, int> > lines_;
+};
+
+template<class F> void ConditionSet::forEachRow(F &&f) const
+{
+    forEachRow(0, expandedSize(), std::forward<F>(f));
+}
+
+template<class F>
+void ConditionSet::forEachRow(std::size_t first, std::size_t last, F &&f) const
+{
+    std::vector<int> ids;
+    std::size_t row = 0;
+    // expanded index of `row`
+    std::size_t pos = 0;
+    for (std::size_t fi = 0; fi <= families_.size() && pos < last; ++fi) {
+        const std::size_t end =
+                fi < families_.size() ? families_[fi].position : size();
+        const std::size_t skip = first > pos ? first - pos : 0;
+        for (std::size_t r = row + skip; r < end && pos + (r-row) < last; ++r) {
+            const RowView v = {
+                ids_.data() + offsets_[r], coefs_.data() + offsets_[r],
+                offsets_[r+1] - offsets_[r],
+                ranges_.data() + rangeOffsets_[r],
+                rangeOffsets_[r+1] - rangeOffsets_[r],
+                constants_[r]
+            };
+            f(v);
+        }
+        pos += end - row;
+        row = end;
+        if (fi == families_.size()) {
+            break;
+        }
+        const Family &fam = families_[fi];
+        const std::size_t rows = fam.lastRow - fam.firstRow;
+        const std::size_t total = rows * fam.count;
+        for (std::size_t k = first > pos ? first - pos : 0;
+                k < total && pos + k < last; ++k) {
+            const int it = static_cast<int>(k / rows);
+            const auto r = fam.firstRow + k % rows;
+            const auto b = familyOffsets_[r];
+            const auto n = familyOffsets_[r+1] - b;
+            ids.resize(n);
+            for (std::size_t t = 0; t < n; ++t) {
+                ids[t] = familyIds_[b+t] + it * familyStrides_[b+t];
+            }
+            const RowView v = {
+                ids.data(), familyCoefs_.data() + b, n,
+                nullptr, 0, familyConstants_[r]
+            };
+            f(v);
+        }
+        pos += total;
+    }
+}
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_CONDITIONSET_H_
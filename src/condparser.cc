@@ -3,9 +3,11 @@
 #include "parsercommon.h"
 
 #include <istream>
-#include <sstream>
+#include <iterator>
 #include <cassert>
 #include <cctype>
+#include <climits>
+#include <cstring>
 
 //constexpr int CondDict::ID_CONST;
 //constexpr int CondDict::ID_INVALID;
@@ -21,19 +23,28 @@ CondTree build_equation(const CondTree &a, const CondTree &b)
 }
 
 CondDict::CondDict(const SymbolList &sl, const std::string &xVarName)
-    : xVarName_(xVarName), symList_(sl)
+    : xVarName_(xVarName), symList_(std::make_shared<FrozenSymbolList>(sl))
 {
     // assert(!xVarName_.empty());
     checkXVarName();
 }
 
 CondDict::CondDict(SymbolList &&sl, const std::string &xVarName)
-    : xVarName_(xVarName), symList_(sl)
+    : xVarName_(xVarName), symList_(std::make_shared<FrozenSymbolList>(sl))
 {
     // assert(!xVarName_.empty());
     checkXVarName();
 }
 
+CondDict::CondDict(
+        std::shared_ptr<const FrozenSymbolList> sl,
+        const std::string &xVarName
+) : xVarName_(xVarName), symList_(std::move(sl))
+{
+    assert(symList_);
+    checkXVarName();
+}
+
 void CondDict::checkXVarName() const
 {
     if (xVarName_.empty()) {
@@ -42,88 +53,381 @@ void CondDict::checkXVarName() const
 }
 
 int CondDict::symToID(const std::string &name, int index) const
+{
+    return symToID(name.data(), name.size(), index);
+}
+
+int CondDict::symToID(const char *name, std::size_t len, int index) const
 {
     assert(index >= 0);
-    if (name == xVarName_) {
+    if (xVarName_.compare(0, xVarName_.npos, name, len) == 0) {
         return ID_X_VAR_NEG_BASE - index;
     }
-    const int offset = symList_.query(name);
+    const int offset = symList_->query(name, len);
     if (offset >= 0) {
-        return static_cast<int>(symList_.size() * index + offset);
+        return static_cast<int>(symList_->size() * index + offset);
     }
     return ID_INVALID;
 }
 
+int CondDict::shiftID(int id0, int index) const
+{
+    assert(index >= 0);
+    if (id0 <= ID_X_VAR_NEG_BASE) {
+        return id0 - index;
+    }
+    assert(id0 >= ID_Y_VAR_POS_BASE);
+    return id0 + yStride() * index;
+}
+
+namespace {
+
+enum CharClass : unsigned char
+{
+    CC_OTHER = 0, CC_SPACE, CC_ALPHA, CC_DIGIT, CC_OP
+};
+
+struct CharClassTable
+{
+    CharClassTable()
+    {
+        for (int c = 0; c < 256; ++c) {
+            if (std::isspace(c)) {
+                table[c] = CC_SPACE;
+            } else if (std::isalpha(c)) {
+                table[c] = CC_ALPHA;
+            } else if (std::isdigit(c)) {
+                table[c] = CC_DIGIT;
+            } else {
+                table[c] = CC_OTHER;
+            }
+        }
+        for (const char *p = "-+*/()="; *p; ++p) {
+            table[static_cast<unsigned char>(*p)] = CC_OP;
+        }
+    }
+    CharClass operator[](char c) const
+    {
+        return static_cast<CharClass>(table[static_cast<unsigned char>(c)]);
+    }
+    unsigned char table[256];
+};
+
+const CharClassTable charClass;
+
+std::string readAll(std::istream &s)
+{
+    return std::string(
+            std::istreambuf_iterator<char>(s),
+            std::istreambuf_iterator<char>()
+    );
+}
+
+} // namespace
+
 CondLexer::CondLexer(std::istream &s, const CondDict &d)
-        : stream_(s), dict_(d)
+        : isFamily_(false), isMean_(false), buffer_(readAll(s)),
+          cur_(buffer_.data()), end_(buffer_.data() + buffer_.size()),
+          dict_(d)
 {
 }
 
 CondLexer::CondLexer(std::istream &s, CondDict &&d)
-        : stream_(s), dict_(d)
+        : isFamily_(false), isMean_(false), buffer_(readAll(s)),
+          cur_(buffer_.data()), end_(buffer_.data() + buffer_.size()),
+          dict_(d)
 {
 }
 
+CondLexer::CondLexer(const char *begin, const char *end, const CondDict &d)
+        : isFamily_(false), isMean_(false), cur_(begin), end_(end), dict_(d)
+{
+}
+
+void CondLexer::skipSpace()
+{
+    while (cur_ != end_ && charClass[*cur_] == CC_SPACE) {
+        ++cur_;
+    }
+}
+
+bool CondLexer::readInteger(int &v)
+{
+    const char *const begin = cur_;
+    v = 0;
+    while (cur_ != end_ && charClass[*cur_] == CC_DIGIT) {
+        if (v > (INT_MAX - 9) / 10) {
+            return false;
+        }
+        v = v * 10 + (*cur_ - '0');
+        ++cur_;
+    }
+    return cur_ != begin;
+}
+
 CondLexer::Token CondLexer::token()
 {
-    stream_ >> std::ws;
-    const int peek = static_cast<int>(stream_.peek());
-    if (peek == std::istream::traits_type::eof()) {
+    skipSpace();
+    if (cur_ == end_) {
         msg_ = "EOF";
         return Token::TK_EOF;
-    } else if (std::isalpha(peek)) {
-        return peekAlpha();
-        } else if (std::isdigit(peek)) {
-        stream_ >> num_;
-        return Token::TK_NUM;
-    } else switch (peek) {
-        case '-':
-        case '+':
-        case '*':
-        case '/':
-        case '(':
-        case ')':
-        case '=':
-            symbol_ = static_cast<int>(stream_.get());
+    }
+    switch (charClass[*cur_]) {
+        case CC_ALPHA:
+            return peekAlpha();
+        case CC_DIGIT:
+            cur_ = parseNumber(cur_, end_, num_);
+            return Token::TK_NUM;
+        case CC_OP:
+            symbol_ = static_cast<unsigned char>(*cur_++);
             msg_ = static_cast<char>(symbol_);
             return Token::TK_OP;
         default:
-            symbol_ = static_cast<int>(stream_.get());
+            symbol_ = static_cast<unsigned char>(*cur_++);
             msg_ = "invalid symbol ";
             msg_ += static_cast<char>(symbol_);
             return Token::TK_INVALID;
     }
-    assert(!"code should be unreachable");
 }
 
 CondLexer::Token CondLexer::peekAlpha()
 {
-    std::string name;
-    std::string numstr;
-    while (std::isalpha(static_cast<int>(stream_.peek()))) {
-        name.push_back(static_cast<char>(stream_.get()));
-    }
-    while (std::isdigit(static_cast<int>(stream_.peek()))) {
-        numstr.push_back(static_cast<char>(stream_.get()));
-    }
-    if (numstr.empty()) {
-        msg_ = name + " should follow an integer index";
-        return Token::TK_INVALID;
+    const char *const name = cur_;
+    while (cur_ != end_ && charClass[*cur_] == CC_ALPHA) {
+        ++cur_;
     }
+    const char *const numstr = cur_;
     // do not use std::istringstream because it differs from 010 and 10
     int num = 0;
-    for (const auto i : numstr) {
+    while (cur_ != end_ && charClass[*cur_] == CC_DIGIT) {
         num *= 10;
-        num += i - '0';
+        num += *cur_ - '0';
+        ++cur_;
+    }
+    if (numstr == cur_) {
+        if (isFamily_ && cur_ != end_ && *cur_ == '{') {
+            return peekIndexed(name, numstr - name);
+        }
+        if (!isFamily_ && numstr - name == 3
+            && std::strncmp(name, "for", 3) == 0) {
+            return peekFamily();
+        }
+        const bool sum = numstr - name == 3
+            && std::strncmp(name, "sum", 3) == 0;
+        const bool mean = numstr - name == 4
+            && std::strncmp(name, "mean", 4) == 0;
+        if (sum || mean) {
+            skipSpace();
+            if (cur_ != end_ && *cur_ == '(') {
+                return peekAggregate(mean);
+            }
+        }
+        msg_.assign(name, numstr);
+        msg_ += " should follow an integer index";
+        return Token::TK_INVALID;
     }
     msg_.clear();
-    symbol_ = dict_.symToID(name, num);
+    symbol_ = dict_.symToID(name, numstr - name, num);
     if (symbol_ == dict_.ID_INVALID)  {
         msg_ += ", invalid symbol ";
-        msg_ += name;
-        msg_ += numstr;
+        msg_.append(name, cur_);
+        return Token::TK_INVALID;
+    }
+    if (isFamily_) {
+        return familySymbol(dict_.symToID(name, numstr - name, 0), 0, num);
+    }
+    return Token::TK_ID;
+}
+
+CondLexer::Token CondLexer::peekFamily()
+{
+    skipSpace();
+    const char *const var = cur_;
+    while (cur_ != end_ && charClass[*cur_] == CC_ALPHA) {
+        ++cur_;
+    }
+    const char *const varEnd = cur_;
+    skipSpace();
+    const char *const in = cur_;
+    while (cur_ != end_ && charClass[*cur_] == CC_ALPHA) {
+        ++cur_;
+    }
+    const bool hasIn = (cur_ - in == 2 && std::strncmp(in, "in", 2) == 0);
+    int first = 0;
+    int last = 0;
+    bool good = var != varEnd && hasIn;
+    if (good) {
+        skipSpace();
+        good = readInteger(first);
+    }
+    if (good) {
+        skipSpace();
+        good = end_ - cur_ >= 2 && cur_[0] == '.' && cur_[1] == '.';
+        cur_ += good ? 2 : 0;
+    }
+    if (good) {
+        skipSpace();
+        good = readInteger(last);
+    }
+    if (good) {
+        skipSpace();
+        good = cur_ != end_ && *cur_ == ':';
+    }
+    if (!good) {
+        msg_ = "family header, expect 'for var in first..last:'";
+        return Token::TK_INVALID;
+    }
+    ++cur_;
+    if (last < first) {
+        msg_ = "family header, empty range";
         return Token::TK_INVALID;
     }
+    isFamily_ = true;
+    family_.var.assign(var, varEnd);
+    family_.first = first;
+    family_.last = last;
+    family_.terms.clear();
+    msg_ = "for";
+    return Token::TK_FOR;
+}
+
+bool CondLexer::readSymbol(const char *&name, std::size_t &len, int &index)
+{
+    name = cur_;
+    while (cur_ != end_ && charClass[*cur_] == CC_ALPHA) {
+        ++cur_;
+    }
+    len = cur_ - name;
+    return len > 0 && readInteger(index);
+}
+
+CondLexer::Token CondLexer::peekAggregate(bool mean)
+{
+    assert(*cur_ == '(');
+    ++cur_;
+    if (isFamily_) {
+        msg_ = "aggregates are not allowed in a family";
+        return Token::TK_INVALID;
+    }
+    const char *first = nullptr;
+    const char *last = nullptr;
+    std::size_t firstLen = 0;
+    std::size_t lastLen = 0;
+    int firstIndex = 0;
+    int lastIndex = 0;
+    skipSpace();
+    bool good = readSymbol(first, firstLen, firstIndex);
+    if (good) {
+        skipSpace();
+        good = end_ - cur_ >= 2 && cur_[0] == '.' && cur_[1] == '.';
+        cur_ += good ? 2 : 0;
+    }
+    if (good) {
+        skipSpace();
+        good = readSymbol(last, lastLen, lastIndex);
+    }
+    if (good) {
+        skipSpace();
+        good = cur_ != end_ && *cur_ == ')';
+    }
+    if (!good) {
+        msg_ = "aggregate, expect '(name first..name last)'";
+        return Token::TK_INVALID;
+    }
+    ++cur_;
+    if (firstLen != lastLen || std::strncmp(first, last, firstLen) != 0) {
+        msg_ = "aggregate over different names";
+        return Token::TK_INVALID;
+    }
+    const int id0 = dict_.symToID(first, firstLen, 0);
+    if (id0 == dict_.ID_INVALID) {
+        msg_ = ", invalid symbol ";
+        msg_.append(first, first + firstLen);
+        return Token::TK_INVALID;
+    }
+    if (id0 <= dict_.ID_X_VAR_NEG_BASE) {
+        msg_ = "aggregate of the unknown variable";
+        return Token::TK_INVALID;
+    }
+    if (lastIndex < firstIndex) {
+        msg_ = "aggregate over an empty range";
+        return Token::TK_INVALID;
+    }
+    range_.first = dict_.shiftID(id0, firstIndex);
+    range_.count = lastIndex - firstIndex + 1;
+    range_.stride = dict_.yStride();
+    isMean_ = mean;
+    msg_ = mean ? "mean" : "sum";
+    return Token::TK_RANGE;
+}
+
+CondLexer::Token CondLexer::peekIndexed(const char *name, std::size_t len)
+{
+    assert(*cur_ == '{');
+    ++cur_;
+    skipSpace();
+    int scale = 1;
+    int offset = 0;
+    bool good = true;
+    bool hasVar = true;
+    if (cur_ != end_ && charClass[*cur_] == CC_DIGIT) {
+        good = readInteger(scale);
+        skipSpace();
+        if (good && cur_ != end_ && *cur_ == '*') {
+            ++cur_;
+            skipSpace();
+        } else {
+            offset = scale;
+            scale = 0;
+            hasVar = false;
+        }
+    }
+    if (good && hasVar) {
+        const char *const var = cur_;
+        while (cur_ != end_ && charClass[*cur_] == CC_ALPHA) {
+            ++cur_;
+        }
+        good = family_.var.compare(0, family_.var.npos, var, cur_ - var) == 0;
+        skipSpace();
+        if (good && cur_ != end_ && (*cur_ == '+' || *cur_ == '-')) {
+            const bool negative = (*cur_ == '-');
+            ++cur_;
+            skipSpace();
+            good = readInteger(offset);
+            offset = negative ? -offset : offset;
+            skipSpace();
+        }
+    }
+    good = good && cur_ != end_ && *cur_ == '}';
+    if (!good) {
+        msg_.assign(name, name + len);
+        msg_ += " has an invalid index";
+        return Token::TK_INVALID;
+    }
+    ++cur_;
+    const int id0 = dict_.symToID(name, len, 0);
+    if (id0 == dict_.ID_INVALID) {
+        msg_ = ", invalid symbol ";
+        msg_.append(name, name + len);
+        return Token::TK_INVALID;
+    }
+    return familySymbol(id0, scale, offset);
+}
+
+CondLexer::Token CondLexer::familySymbol(int id0, int scale, int offset)
+{
+    auto &terms = family_.terms;
+    std::size_t i = 0;
+    for (; i < terms.size(); ++i) {
+        const auto &t = terms[i];
+        if (t.id0 == id0 && t.scale == scale && t.offset == offset) {
+            break;
+        }
+    }
+    if (i == terms.size()) {
+        terms.push_back(CondFamily::Term{id0, scale, offset});
+    }
+    symbol_ = static_cast<int>(i);
     return Token::TK_ID;
 }
 
@@ -136,6 +440,17 @@ CondParser::CondParser(
     forward_ = lexer_.token();
 }
 
+CondParser::CondParser(std::istream &s, const CondDict &d) : lexer_(s, d)
+{
+    forward_ = lexer_.token();
+}
+
+CondParser::CondParser(const char *begin, const char *end, const CondDict &d)
+    : lexer_(begin, end, d)
+{
+    forward_ = lexer_.token();
+}
+
 std::vector<CondTree> CondParser::parseCondMiddle()
 {
     std::vector<CondTree> trees;
@@ -180,6 +495,9 @@ std::vector<CondTree> CondParser::parseCond()
 
 std::vector<CondTree> CondParser::parse()
 {
+    if (forward_ == CondLexer::Token::TK_FOR) {
+        forward_ = lexer_.token();
+    }
     const auto r = parseCond();
     if (forward_ != CondLexer::Token::TK_EOF) {
         throw ParserError(
@@ -231,12 +549,29 @@ std::unique_ptr<CondTreeNode> CondParser::parseAtomTail()
             forward_ = lexer_.token();
             return CondTreeNode::make(num);
         };
+        case CondLexer::Token::TK_RANGE: {
+            auto r = CondTreeNode::make(lexer_.range());
+            if (lexer_.isMean()) {
+                auto m = CondTreeNode::make('*');
+                m->left = CondTreeNode::make(1.0 / lexer_.range().count);
+                m->right = std::move(r);
+                r = std::move(m);
+            }
+            forward_ = lexer_.token();
+            return r;
+        };
         case CondLexer::Token::TK_INVALID:
             throw ParserError(
                     0,
                     "invalid token " + lexer_.msg(),
                     ParserError::Type::INVALID_TOKEN
             );
+        case CondLexer::Token::TK_FOR:
+            throw ParserError(
+                    0,
+                    "a family must start at the beginning of the line",
+                    ParserError::Type::UNEXPECTED_CHAR
+            );
         case CondLexer::Token::TK_OP:
             if (lexer_.symbol() == '(') {
                 forward_ = lexer_.token();
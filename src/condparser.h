@@ -6,6 +6,11 @@
 
 Grammar:
 
+    line        := family
+                 | cond
+
+    family      := 'for' var 'in' integer '..' integer ':' cond
+
     cond        := expr cond_middle
 
     cond_middle := '=' expr cond_tail
@@ -30,12 +35,29 @@ Grammar:
 
     atom_tail   := id
                  | posiive_number
+                 | aggregate
                  | '(' expr ')'
 
+    aggregate   := ('sum' | 'mean') '(' id '..' id ')'
+
     id          := [a-zA-Z]+ [0-9]+
+                 | [a-zA-Z]+ '{' index '}'          (in a family only)
+
+    index       := (integer '*')? var (('+' | '-') integer)?
+                 | integer
+
+    var         := [a-zA-Z]+
+
+    integer     := [0-9]+
 
     positive_number :=  [0-9]+ (\.[0-9]+)? ([eE][-+]?[0-9]+)?
 
+An aggregate, e.g. `mean(Bz0..Bz999)`, is the sum or the mean of one Y name
+over an inclusive index range. Aggregates are not allowed in a family.
+
+A family, e.g. `for i in 0..9999: Bz{i} = Bz{i+1}`, stands for the
+condition repeated for every value of the variable in the inclusive range.
+
 ========================================
 
 */
@@ -61,6 +83,11 @@ class CondDict
 public:
     CondDict(const SymbolList &, const std::string &xVarName);
     CondDict(SymbolList &&, const std::string &xVarName);
+    /** @brief share an already frozen symbol list, copying is cheap */
+    CondDict(
+            std::shared_ptr<const FrozenSymbolList>,
+            const std::string &xVarName
+    );
     //! symbol ID for constant
     static constexpr int ID_CONST = -1;
     //! invalid symbol ID
@@ -70,25 +97,87 @@ public:
     //! the first ID for the Y symbols
     static constexpr int ID_Y_VAR_POS_BASE = 0;
     int symToID(const std::string &name, int index) const;
+    int symToID(const char *name, std::size_t len, int index) const;
+    /**
+        @param id0 the valid symbol ID of a name at index 0
+        @return the symbol ID of the same name at the given index
+    */
+    int shiftID(int id0, int index) const;
+    //! @return the ID difference between neighbouring indices of a Y name
+    int yStride() const { return static_cast<int>(symList_->size()); }
 private:
     const std::string xVarName_;
-    const SymbolList symList_;
+    const std::shared_ptr<const FrozenSymbolList> symList_;
     void checkXVarName() const;
 };
 
+/**
+    @brief an indexed family of conditions `for var in first..last: cond`
+
+    While parsing a family, the symbol IDs in the condition trees are
+    indices into `terms` instead of real symbol IDs.
+*/
+struct CondFamily
+{
+    struct Term
+    {
+        //! symbol ID of the name at index 0
+        int id0;
+        //! the index of the symbol is (scale * var + offset)
+        int scale;
+        int offset;
+    };
+    std::string var;
+    int first;
+    int last;
+    std::vector<Term> terms;
+};
+
+/**
+    @brief Lexer scanning a contiguous character range
+
+    Identifiers, indices and numbers are tokenized in place without
+    allocation. The istream constructors read the rest of the stream into
+    an internal buffer and scan that.
+*/
 class CondLexer
 {
 public:
     CondLexer(std::istream &, const CondDict &);
     CondLexer(std::istream &, CondDict &&);
-    enum class Token {TK_INVALID, TK_EOF, TK_NUM, TK_ID, TK_OP};
+    //! the range [begin, end) must outlive the lexer
+    CondLexer(const char *begin, const char *end, const CondDict &);
+    enum class Token {
+        TK_INVALID, TK_EOF, TK_NUM, TK_ID, TK_OP, TK_FOR, TK_RANGE
+    };
     double num() const { return num_; }
     int symbol() const { return symbol_; }
     const std::string &msg() const { return msg_; }
     Token token();
+    //! valid after a TK_FOR token, which carries the whole family header
+    bool isFamily() const { return isFamily_; }
+    const CondFamily &family() const { return family_; }
+    //! valid after a TK_RANGE token
+    const CondRange &range() const { return range_; }
+    //! whether the TK_RANGE token is a mean rather than a sum
+    bool isMean() const { return isMean_; }
 private:
-    std::istream &stream_;
     Token peekAlpha();
+    Token peekFamily();
+    Token peekAggregate(bool mean);
+    bool readSymbol(const char *&name, std::size_t &len, int &index);
+    Token peekIndexed(const char *name, std::size_t len);
+    Token familySymbol(int id0, int scale, int offset);
+    void skipSpace();
+    bool readInteger(int &);
+    bool isFamily_;
+    CondFamily family_;
+    CondRange range_;
+    bool isMean_;
+    //! owns the characters when constructed from a stream
+    std::string buffer_;
+    const char *cur_;
+    const char *end_;
     double num_;
     /***
         @brief for both ascii symbol and numbered symbol
@@ -102,8 +191,13 @@ private:
 class CondParser {
 public:
     CondParser(std::istream &, const SymbolList &, const std::string &xVarName);
+    CondParser(std::istream &, const CondDict &);
+    CondParser(const char *begin, const char *end, const CondDict &);
     /** brief the main parse function */
     std::vector<CondTree> parse();
+    /** @brief whether the parsed line is a family, see CondFamily */
+    bool isFamily() const { return lexer_.isFamily(); }
+    const CondFamily &family() const { return lexer_.family(); }
 private:
     CondLexer lexer_;
     CondLexer::Token forward_;
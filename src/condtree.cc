@@ -1,13 +1,13 @@
 #include "condtree.h"
 #include "symbollist.h"
 #include "condparser.h"
+#include "conditionset.h"
 
 #include <algorithm>
 #include <memory>
 #include <ostream>
 #include <utility>
 #include <cassert>
-#include <map>
 
 static FinalizationStatus finalizePlus(std::unique_ptr<CondTreeNode> &root);
 static FinalizationStatus finalizeMinus(std::unique_ptr<CondTreeNode> &root);
@@ -35,6 +35,11 @@ CondTreeNode::CondTreeNode(double num) : type(Type::NUM_NODE)
     value.num = num;
 }
 
+CondTreeNode::CondTreeNode(const CondRange &range) : type(Type::RANGE_NODE)
+{
+    value.range = range;
+}
+
 bool CondTreeNode::isTerm() const
 {
     return !(left || right);
@@ -56,12 +61,17 @@ std::unique_ptr<CondTreeNode> CondTreeNode::make(double num)
     return std::unique_ptr<CondTreeNode>(new CondTreeNode(num));
 }
 
+std::unique_ptr<CondTreeNode> CondTreeNode::make(const CondRange &range)
+{
+    return std::unique_ptr<CondTreeNode>(new CondTreeNode(range));
+}
+
 bool CondTreeNode::isValid() const
 {
     return
         (
               !(left || right)
-            && (type == Type::NUM_NODE || type == Type::ID_NODE)
+            && (type == Type::NUM_NODE || isSymbol())
         ) || (
                (type == Type::OP_NODE)
             && left && right
@@ -100,6 +110,14 @@ CondTree::CondTree(std::unique_ptr<CondTreeNode> r) : root(std::move(r))
 {
 }
 
+/** a number times a sum, whose terms are scaled only when they are listed */
+static bool isScaledSum(const std::unique_ptr<CondTreeNode> &root)
+{
+    return root->isOp('*')
+        && root->left->type == CondTreeNode::Type::NUM_NODE
+        && root->right->isOp('+');
+}
+
 static bool isFinalFormImpl(const std::unique_ptr<CondTreeNode> &root)
 {
     switch (root->type) {
@@ -107,13 +125,19 @@ static bool isFinalFormImpl(const std::unique_ptr<CondTreeNode> &root)
             return root->isTerm();
         case CondTreeNode::Type::NUM_NODE:
             return root->isTerm();
+        case CondTreeNode::Type::RANGE_NODE:
+            return root->isTerm();
         case CondTreeNode::Type::OP_NODE:
             switch (root->value.op) {
                 case '+':
-                    return isFinalForm(root->left) && isFinalForm(root->right);
+                    // the validity of the whole tree is checked once
+                    return isFinalFormImpl(root->left)
+                        && isFinalFormImpl(root->right);
                 case '*':
                     return root->left->type == CondTreeNode::Type::NUM_NODE
-                        && root->right->type == CondTreeNode::Type::ID_NODE;
+                        && (root->right->isSymbol()
+                            || (root->right->isOp('+')
+                                && isFinalFormImpl(root->right)));
                 default:
                     break;
             }
@@ -180,6 +204,48 @@ static bool auxFinalizeMultiplyNum(std::unique_ptr<CondTreeNode> &root)
     return false;
 }
 
+/**
+    multiply the terms of the final form `root` by `factor` in place, which
+    is linear in the number of terms, unlike distributing the factor over
+    each `+` with new nodes; a scaled sum inside only takes the factor
+*/
+static void scaleFinalForm(std::unique_ptr<CondTreeNode> &root, double factor)
+{
+    switch (root->type) {
+        case CondTreeNode::Type::NUM_NODE:
+            root->value.num *= factor;
+            break;
+        case CondTreeNode::Type::ID_NODE:
+        case CondTreeNode::Type::RANGE_NODE: {
+            auto n = CondTreeNode::make('*');
+            n->left = CondTreeNode::make(factor);
+            n->right = std::move(root);
+            root = std::move(n);
+            break;
+        }
+        default:
+            if (root->isOp('+')) {
+                scaleFinalForm(root->left, factor);
+                scaleFinalForm(root->right, factor);
+            } else {
+                assert(root->isOp('*')
+                    && root->left->type == CondTreeNode::Type::NUM_NODE);
+                root->left->value.num *= factor;
+            }
+            break;
+    }
+}
+
+//! replace a scaled sum by its sum with the terms scaled
+static void expandScaledSum(std::unique_ptr<CondTreeNode> &root)
+{
+    if (isScaledSum(root)) {
+        std::unique_ptr<CondTreeNode> sum = std::move(root->right);
+        scaleFinalForm(sum, root->left->value.num);
+        root = std::move(sum);
+    }
+}
+
 static bool auxFinalizeMultiplyPlus(
         std::unique_ptr<CondTreeNode> &root,
         FinalizationStatus &s
@@ -188,9 +254,21 @@ static bool auxFinalizeMultiplyPlus(
     assert(root->isOp('*'));
     bool pass = false;
     s = FinalizationStatus::SUCCESS;
+    if (root->left->type != CondTreeNode::Type::NUM_NODE) {
+        // a product of a sum and a symbol or another sum is distributed,
+        // which is not linear anyway
+        expandScaledSum(root->left);
+        expandScaledSum(root->right);
+    }
     if (root->left->isOp('+')) {
         std::swap(root->left, root->right);
     }
+    if (root->left->type == CondTreeNode::Type::NUM_NODE
+            && root->right->isOp('+')) {
+        // the operands are final forms, the sum is kept as a scaled sum,
+        // so a nested product does not visit the terms below it at all
+        return true;
+    }
     if (root->right->isOp('+')) {
         pass = true;
         // ensure exception safe
@@ -227,6 +305,8 @@ static bool auxFinalizeMultiplyMul(
     if (root->right->isOp('*')) {
         std::swap(root->left, root->right->right);
         std::swap(root->left, root->right);
+        // the two factors first, e.g. two numbers of nested scaled sums
+        s = finalizeMultiply(root->left);
         if (s != FinalizationStatus::SUCCESS) {
             return true;
         }
@@ -256,11 +336,11 @@ static FinalizationStatus finalizeMultiply(std::unique_ptr<CondTreeNode> &root)
     if (auxFinalizeMultiplyMul(root,res)) {
         return res;
     }
-    assert(root->left->type == CondTreeNode::Type::NUM_NODE);
     switch (root->left->type) {
         case CondTreeNode::Type::NUM_NODE:
             return FinalizationStatus::SUCCESS;
         case CondTreeNode::Type::ID_NODE:
+        case CondTreeNode::Type::RANGE_NODE:
             return FinalizationStatus::HIGH_ORDER;
         default:
             return FinalizationStatus::UNKNOWN_FAILURE;
@@ -335,6 +415,11 @@ nodeLatex(std::ostream &s, const std::unique_ptr<CondTreeNode> &root)
         case CondTreeNode::Type::NUM_NODE:
             s << '$' << root->value.num << '$';
             break;
+        case CondTreeNode::Type::RANGE_NODE:
+            s << "$\\sum_{k<" << root->value.range.count << "} S_{"
+              << root->value.range.first << '+' << root->value.range.stride
+              << "k}$";
+            break;
         default:
             break;
     }
@@ -370,40 +455,44 @@ operator<< (std::ostream &s, const std::unique_ptr<CondTreeNode> &root)
     return s;
 }
 
-inline void insertPolynomialTerm(
-        std::map<int, double> &m,
-        double factor,
-        int id
-)
-{
-    m[id] += factor;
-}
-
-static void toListImpl(
-    std::map<int, double> &m,
-    const std::unique_ptr<CondTreeNode> &root
-)
+/**
+    @param f called as f(id, factor) for symbols and constants
+    @param g called as g(range, factor) for ranges
+    @param scale the product of the factors of the scaled sums around `root`
+*/
+template<class F, class G>
+static void forEachTerm(
+        const std::unique_ptr<CondTreeNode> &root, F &f, G &g,
+        double scale = 1.0)
 {
     switch (root->type) {
         case CondTreeNode::Type::ID_NODE:
-            insertPolynomialTerm(m, 1.0, root->value.id);
+            f(root->value.id, scale);
             break;
         case CondTreeNode::Type::NUM_NODE:
-            insertPolynomialTerm(m, root->value.num, CondDict::ID_CONST);
+            f(static_cast<int>(CondDict::ID_CONST), scale * root->value.num);
+            break;
+        case CondTreeNode::Type::RANGE_NODE:
+            g(root->value.range, scale);
             break;
         case CondTreeNode::Type::OP_NODE:
             switch (root->value.op) {
                 case '+':
-                    toListImpl(m, root->left);
-                    toListImpl(m, root->right);
+                    forEachTerm(root->left, f, g, scale);
+                    forEachTerm(root->right, f, g, scale);
                     break;
-                case '*':
-                    insertPolynomialTerm(
-                            m,
-                            root->left->value.num,
-                            root->right->value.id
-                    );
+                case '*': {
+                    const double factor = scale * root->left->value.num;
+                    if (root->right->isOp('+')) {
+                        forEachTerm(root->right, f, g, factor);
+                    } else if (root->right->type
+                            == CondTreeNode::Type::RANGE_NODE) {
+                        g(root->right->value.range, factor);
+                    } else {
+                        f(root->right->value.id, factor);
+                    }
                     break;
+                }
                 default:
                     assert(false);
                     break;
@@ -419,13 +508,49 @@ std::vector<std::pair<int, double> >
 toList(const std::unique_ptr<CondTreeNode> &root)
 {
     assert(isFinalForm(root));
-    std::map<int, double> m;
-    toListImpl(m, root);
-    std::vector<std::pair<int, double> > res(m.size());
-    std::copy(m.cbegin(), m.cend(), res.begin());
+    std::vector<std::pair<int, double> > res;
+    auto collect = [&res](int id, double factor) {
+        res.emplace_back(id, factor);
+    };
+    auto expand = [&res](const CondRange &r, double factor) {
+        for (int k = 0; k < r.count; ++k) {
+            res.emplace_back(r.first + k * r.stride, factor);
+        }
+    };
+    forEachTerm(root, collect, expand);
+    std::sort(res.begin(), res.end(),
+        [](const std::pair<int, double> &a, const std::pair<int, double> &b)
+        { return a.first < b.first; });
+    // merge the terms of the same symbol
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < res.size(); ++i) {
+        if (n > 0 && res[n-1].first == res[i].first) {
+            res[n-1].second += res[i].second;
+        } else {
+            res[n++] = res[i];
+        }
+    }
+    res.resize(n);
     return res;
 }
 
+void toRow(const std::unique_ptr<CondTreeNode> &root, ConditionSet &cs)
+{
+    assert(isFinalForm(root));
+    auto add = [&cs](int id, double factor) {
+        if (id == CondDict::ID_CONST) {
+            cs.addConstant(factor);
+        } else {
+            cs.addTerm(id, factor);
+        }
+    };
+    auto addRange = [&cs](const CondRange &r, double factor) {
+        cs.addRange(r.first, r.count, r.stride, factor);
+    };
+    forEachTerm(root, add, addRange);
+    cs.endRow();
+}
+
 bool isEqual(
         const std::vector<std::pair<int, double> > v1,
         const std::vector<std::pair<int, double> > v2
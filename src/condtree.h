@@ -6,22 +6,39 @@
 #include <iosfwd>
 #include <vector>
 
+class ConditionSet;
+
+/**
+    @brief the symbols first, first+stride, ..., first+(count-1)*stride
+*/
+struct CondRange
+{
+    int first;
+    int count;
+    int stride;
+};
+
 class CondTreeNode
 {
 public:
-    enum class Type {INVALID_NODE, ID_NODE, OP_NODE, NUM_NODE};
+    enum class Type {INVALID_NODE, ID_NODE, OP_NODE, NUM_NODE, RANGE_NODE};
     CondTreeNode();
     CondTreeNode(const CondTreeNode &);
     CondTreeNode(CondTreeNode &&) = default;
     explicit CondTreeNode(int id);
     explicit CondTreeNode(char op);
     explicit CondTreeNode(double num);
+    //! the sum of a range of symbols
+    explicit CondTreeNode(const CondRange &range);
     std::unique_ptr<CondTreeNode> clone() const;
     static std::unique_ptr<CondTreeNode> make(int id);
     static std::unique_ptr<CondTreeNode> make(char op);
     static std::unique_ptr<CondTreeNode> make(double num);
+    static std::unique_ptr<CondTreeNode> make(const CondRange &range);
     bool isOp(char op) const { return type == Type::OP_NODE && value.op == op; }
     bool isTerm() const;
+    bool isSymbol() const
+        { return type == Type::ID_NODE || type == Type::RANGE_NODE; }
     bool isValid() const;
     Type type;
     /** non-anonymous union is more convenient for the copy ctor */
@@ -29,6 +46,7 @@ public:
         char op;
         int id;
         double num;
+        CondRange range;
     } value;
     std::unique_ptr<CondTreeNode> left;
     std::unique_ptr<CondTreeNode> right;
@@ -88,6 +106,15 @@ toList(const CondTree &tree)
     return toList(tree.root);
 }
 
+/**
+    @brief append a tree in final form as a new row of the set
+*/
+void toRow(const std::unique_ptr<CondTreeNode> &root, ConditionSet &);
+inline void toRow(const CondTree &tree, ConditionSet &cs)
+{
+    toRow(tree.root, cs);
+}
+
 bool isEqual(
         const std::vector<std::pair<int, double> >,
         const std::vector<std::pair<int,  double> >
@@ -1,8 +1,10 @@
 #include "glls.h"
 
-std::vector<double> glls(std::istream &s)
+std::vector<double> glls(std::istream &s, unsigned threads, bool lazy)
 {
     GllsParser gp(s, true);
+    gp.setThreads(threads);
+    gp.setLazy(lazy);
     auto g = gp.run();
     arrangeX(g, gp.xValues());
     arrangeY(g, gp.yConds());
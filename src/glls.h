@@ -6,6 +6,13 @@
 
 #include <iosfwd>
 
-std::vector<double> glls(std::istream &s);
+/**
+    @param threads number of threads parsing the conditions,
+        see GllsParser::setThreads()
+    @param lazy load only the referenced coefficient rows,
+        see GllsParser::setLazy()
+*/
+std::vector<double> glls(
+        std::istream &s, unsigned threads = 1, bool lazy = false);
 
 #endif
@@ -0,0 +1,32 @@
+/**
+*   @file gllsalloc.cc
+*
+*   Replaces the global operator new to count every allocation with
+*   GllsProfile::countAllocation(), and turns the allocation columns of the
+*   profile on. It is not part of the libraries: an executable opts in by
+*   linking this file, e.g. the glls_alloc object library of CMake.
+*/
+#include "gllsprofile.h"
+
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size)
+{
+    GllsProfile::countAllocation(size);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+const bool counting = (GllsProfile::setCountingAllocations(true), true);
+
+} // namespace
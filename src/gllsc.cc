@@ -0,0 +1,141 @@
+#include "gllsc.h"
+#include "gllsmodel.h"
+#include "parsercommon.h"
+
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct glls_model
+{
+    std::unique_ptr<GllsModel> model;
+    std::string error;
+    int errorLine;
+};
+
+/** run `f`, translating its exception into an error code of `m` */
+template<class F> static int guarded(glls_model *m, F f)
+{
+    m->error.clear();
+    m->errorLine = 0;
+    try {
+        f();
+        return GLLS_OK;
+    } catch (const ParserError &e) {
+        m->error = e.what();
+        m->errorLine = e.line();
+        return GLLS_ERROR_PARSE;
+    } catch (const std::invalid_argument &e) {
+        m->error = e.what();
+        return GLLS_ERROR_ARGUMENT;
+    } catch (const std::bad_alloc &) {
+        m->error = "out of memory";
+        return GLLS_ERROR_MEMORY;
+    } catch (const std::exception &e) {
+        m->error = e.what();
+        return GLLS_ERROR_SOLVE;
+    }
+}
+
+glls_model *glls_model_new(
+        const double *data,
+        int rows,
+        int cols,
+        size_t stride,
+        int has_constant,
+        int copy
+)
+{
+    return glls_model_new_strided(
+            data, rows, cols, stride, 1, has_constant, copy);
+}
+
+glls_model *glls_model_new_strided(
+        const double *data,
+        int rows,
+        int cols,
+        size_t row_stride,
+        size_t col_stride,
+        int has_constant,
+        int copy
+)
+{
+    try {
+        std::unique_ptr<glls_model> m(new glls_model);
+        m->model.reset(new GllsModel(data, rows, cols, row_stride, col_stride,
+                has_constant != 0,
+                copy ? GllsModel::Storage::COPY : GllsModel::Storage::BORROW));
+        m->errorLine = 0;
+        return m.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void glls_model_free(glls_model *m)
+{
+    delete m;
+}
+
+int glls_set_names(glls_model *m, const char *x_name, const char *symbols)
+{
+    return guarded(m, [&]() {
+        std::istringstream ss(symbols ? symbols : "");
+        std::vector<std::string> names;
+        std::string s;
+        while (ss >> s) {
+            names.push_back(s);
+        }
+        m->model->setNames(x_name ? x_name : "", names);
+    });
+}
+
+int glls_add_conditions_text(glls_model *m, const char *text, int first_line)
+{
+    return guarded(m, [&]() {
+        m->model->addConditions(text ? text : "", first_line);
+    });
+}
+
+int glls_add_conditions_triplets(
+        glls_model *m,
+        size_t count,
+        size_t terms,
+        const int *conds,
+        const int *rows,
+        const double *coefs,
+        const double *constants
+)
+{
+    return guarded(m, [&]() {
+        m->model->addConditions(count, terms, conds, rows, coefs, constants);
+    });
+}
+
+int glls_fix_x(glls_model *m, size_t n, const int *index, const double *value)
+{
+    return guarded(m, [&]() { m->model->fixX(n, index, value); });
+}
+
+void glls_clear_conditions(glls_model *m)
+{
+    m->model->clearConditions();
+}
+
+int glls_solve(glls_model *m, double *x)
+{
+    return guarded(m, [&]() { m->model->solve(x); });
+}
+
+const char *glls_last_error(const glls_model *m)
+{
+    return m->error.c_str();
+}
+
+int glls_last_error_line(const glls_model *m)
+{
+    return m->errorLine;
+}
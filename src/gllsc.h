@@ -0,0 +1,103 @@
+/**
+*   @file gllsc.h
+*
+*   C interface of GllsModel, see gllsmodel.h. All functions returning int
+*   return GLLS_OK or an error code; glls_last_error() describes the last
+*   error of a model. A model must not be used by two threads at once.
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSC_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSC_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    GLLS_OK = 0,
+    /* invalid size, index or name */
+    GLLS_ERROR_ARGUMENT = 1,
+    /* invalid condition text, see glls_last_error_line() */
+    GLLS_ERROR_PARSE = 2,
+    /* nothing to solve, or the solver failed */
+    GLLS_ERROR_SOLVE = 3,
+    GLLS_ERROR_MEMORY = 4
+};
+
+typedef struct glls_model glls_model;
+
+/**
+    Element (r, c) of M is at data[r*stride + c], with the constant of row
+    r at column `cols` if has_constant is nonzero. If copy is zero the
+    buffer is borrowed and must outlive the model unchanged.
+
+    @return NULL for invalid sizes or without memory
+*/
+glls_model *glls_model_new(
+        const double *data,
+        int rows,
+        int cols,
+        size_t stride,
+        int has_constant,
+        int copy
+);
+
+/**
+    glls_model_new() with element (r, c) of M at
+    data[r*row_stride + c*col_stride], e.g. row_stride 1 and col_stride the
+    leading dimension for a column-major Fortran array, which is read in
+    place without a transpose.
+
+    @return NULL for invalid sizes or strides, or without memory
+*/
+glls_model *glls_model_new_strided(
+        const double *data,
+        int rows,
+        int cols,
+        size_t row_stride,
+        size_t col_stride,
+        int has_constant,
+        int copy
+);
+
+void glls_model_free(glls_model *m);
+
+/** @param symbols the names of the Y symbols separated by white space */
+int glls_set_names(glls_model *m, const char *x_name, const char *symbols);
+
+/** @param first_line the line number of the first line for the errors */
+int glls_add_conditions_text(glls_model *m, const char *text, int first_line);
+
+/**
+    Term k adds coefs[k] * Y[rows[k]] to condition conds[k] of `count` new
+    conditions; constants may be NULL.
+*/
+int glls_add_conditions_triplets(
+        glls_model *m,
+        size_t count,
+        size_t terms,
+        const int *conds,
+        const int *rows,
+        const double *coefs,
+        const double *constants
+);
+
+int glls_fix_x(glls_model *m, size_t n, const int *index, const double *value);
+
+void glls_clear_conditions(glls_model *m);
+
+/** @param x receives the `cols` entries of X */
+int glls_solve(glls_model *m, double *x);
+
+/** @return the message of the last error, empty after success */
+const char *glls_last_error(const glls_model *m);
+
+/** @return the input line of the last GLLS_ERROR_PARSE, else 0 */
+int glls_last_error_line(const glls_model *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GENERAL_LINEAR_LEAST_SQUARES_GLLSC_H_ */
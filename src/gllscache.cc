@@ -0,0 +1,261 @@
+#include "gllscache.h"
+#include "binaryio.h"
+#include "gllsparser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const char COEF_MAGIC[8] = {'G', 'L', 'L', 'S', 'C', 'O', 'E', '1'};
+const char PROBLEM_MAGIC[8] = {'G', 'L', 'L', 'S', 'P', 'R', 'B', '3'};
+
+std::string toHex(std::uint64_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 15; i >= 0; --i, v >>= 4) {
+        s[i] = digits[v & 0xf];
+    }
+    return s;
+}
+
+bool readMagic(std::istream &is, const char (&magic)[8])
+{
+    char buf[8];
+    return is.read(buf, sizeof(buf)) && std::memcmp(buf, magic, 8) == 0;
+}
+
+/**
+    Write through a temporary file renamed into place, so that a reader
+    never sees a partial entry.
+*/
+template<class F> void writeFile(const std::string &path, F &&write)
+{
+    std::random_device rd;
+    const std::string tmp = path + ".tmp" + std::to_string(rd());
+    {
+        std::ofstream os(tmp, std::ios::binary);
+        if (!os) {
+            return;
+        }
+        write(os);
+        if (!os.flush()) {
+            os.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+    }
+}
+
+} // namespace
+
+GllsCache::GllsCache(const std::string &dir)
+    : dir_(dir), lastHit_(Hit::NONE)
+{
+}
+
+std::uint64_t GllsCache::hash(const char *p, std::size_t n)
+{
+    // word-wise multiply-rotate, finished by the avalanche of MurmurHash3
+    const std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+    std::uint64_t h = 0xcbf29ce484222325ULL ^ (n * k);
+    for (; n >= 8; p += 8, n -= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p, 8);
+        h ^= w * k;
+        h = ((h << 31) | (h >> 33)) * k;
+    }
+    if (n > 0) {
+        std::uint64_t w = 0;
+        std::memcpy(&w, p, n);
+        h ^= w * k;
+        h = ((h << 31) | (h >> 33)) * k;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+std::size_t GllsCache::condOffset(const std::string &text)
+{
+    std::size_t begin = 0;
+    while (begin < text.size()) {
+        std::size_t end = text.find('\n', begin);
+        if (end == text.npos) {
+            end = text.size();
+        }
+        const char *const first = text.data() + begin;
+        const char *const stop = std::find(first, text.data() + end, '#');
+        if (std::find(first, stop, '=') != stop) {
+            return begin;
+        }
+        begin = end + 1;
+    }
+    return text.size();
+}
+
+std::string GllsCache::coefPath(const Key &k) const
+{
+    return dir_ + "/" + toHex(k.coefHash) + ".coef";
+}
+
+std::string GllsCache::problemPath(const Key &k) const
+{
+    return dir_ + "/" + toHex(k.coefHash) + "-" + toHex(k.condHash) + ".prob";
+}
+
+bool GllsCache::loadCoef(const Key &k, std::vector<double> &coef) const
+{
+    std::ifstream is(coefPath(k), std::ios::binary);
+    std::uint64_t length;
+    return readMagic(is, COEF_MAGIC)
+        && readPod(is, length) && length == k.coefLength
+        && readVector(is, coef);
+}
+
+void GllsCache::storeCoef(const Key &k, const std::vector<double> &coef) const
+{
+    writeFile(coefPath(k), [&](std::ostream &os) {
+        os.write(COEF_MAGIC, sizeof(COEF_MAGIC));
+        writePod(os, k.coefLength);
+        writeVector(os, coef);
+    });
+}
+
+bool GllsCache::loadProblem(
+        const Key &k,
+        GllsProblem &g,
+        GllsFactorization &f
+)
+{
+    std::ifstream is(problemPath(k), std::ios::binary);
+    std::uint64_t coefLength, condLength, matrixRows;
+    std::vector<int> xIds, reservedIds;
+    std::vector<double> xs, reserved;
+    int kind;
+    const bool ok = readMagic(is, PROBLEM_MAGIC)
+        && readPod(is, coefLength) && coefLength == k.coefLength
+        && readPod(is, condLength) && condLength == k.condLength
+        && readVector(is, xIds) && readVector(is, xs)
+        && xIds.size() == xs.size()
+        && readPod(is, matrixRows)
+        && yConds_.read(is, matrixRows)
+        && readPod(is, g.xSize)
+        && readVector(is, reservedIds) && readVector(is, reserved)
+        && reservedIds.size() == reserved.size()
+        && readVector(is, g.coef)
+        && readPod(is, kind)
+        && kind >= 0 && kind <= static_cast<int>(GllsFactorization::Kind::EXACT)
+        && readPod(is, f.rows) && readPod(is, f.cols)
+        && readVector(is, f.lu)
+        && readVector(is, f.pivots)
+        && f.cols == g.xSize
+        && g.coef.size() == static_cast<std::size_t>(f.rows) * (g.xSize+1)
+        && f.lu.size() == f.pivots.size() * f.pivots.size()
+        && yConds_.expandedSize() == static_cast<std::size_t>(f.rows);
+    if (!ok) {
+        yConds_.clear();
+        return false;
+    }
+    f.kind = static_cast<GllsFactorization::Kind>(kind);
+    xValues_.clear();
+    for (std::size_t i = 0; i < xIds.size(); ++i) {
+        xValues_.emplace_back(xIds[i], xs[i]);
+    }
+    g.reservedX.clear();
+    for (std::size_t i = 0; i < reservedIds.size(); ++i) {
+        g.reservedX.emplace_back(reservedIds[i], reserved[i]);
+    }
+    g.rows.clear();
+    return true;
+}
+
+void GllsCache::storeProblem(
+        const Key &k,
+        std::size_t matrixRows,
+        const GllsProblem &g,
+        const GllsFactorization &f
+) const
+{
+    writeFile(problemPath(k), [&](std::ostream &os) {
+        os.write(PROBLEM_MAGIC, sizeof(PROBLEM_MAGIC));
+        writePod(os, k.coefLength);
+        writePod(os, k.condLength);
+        std::vector<int> ids;
+        std::vector<double> values;
+        for (const auto &x : xValues_) {
+            ids.push_back(x.first);
+            values.push_back(x.second);
+        }
+        writeVector(os, ids);
+        writeVector(os, values);
+        writePod(os, static_cast<std::uint64_t>(matrixRows));
+        yConds_.write(os);
+        writePod(os, g.xSize);
+        ids.clear();
+        values.clear();
+        for (const auto &x : g.reservedX) {
+            ids.push_back(x.first);
+            values.push_back(x.second);
+        }
+        writeVector(os, ids);
+        writeVector(os, values);
+        writeVector(os, g.coef);
+        writePod(os, static_cast<int>(f.kind));
+        writePod(os, f.rows);
+        writePod(os, f.cols);
+        writeVector(os, f.lu);
+        writeVector(os, f.pivots);
+    });
+}
+
+std::vector<double> GllsCache::solve(std::istream &s, unsigned threads)
+{
+    const std::string text(
+            (std::istreambuf_iterator<char>(s)),
+            std::istreambuf_iterator<char>());
+    const std::size_t split = condOffset(text);
+    const Key key = {
+        hash(text.data(), split), split,
+        hash(text.data() + split, text.size() - split), text.size() - split
+    };
+    GllsProblem g;
+    GllsFactorization f;
+    if (loadProblem(key, g, f)) {
+        lastHit_ = Hit::PROBLEM;
+        return substitute(f, g);
+    }
+    std::istringstream ss(text);
+    GllsParser gp(ss, true);
+    gp.setThreads(threads);
+    std::vector<double> coef;
+    const bool hasCoef = loadCoef(key, coef);
+    if (hasCoef) {
+        gp.presetCoef(std::move(coef));
+    }
+    g = gp.run();
+    if (!hasCoef) {
+        storeCoef(key, gp.coef());
+    }
+    lastHit_ = hasCoef ? Hit::COEF : Hit::NONE;
+    xValues_ = gp.xValues();
+    yConds_ = gp.yConds();
+    const std::size_t matrixRows = g.coef.size() / (g.xSize + 1);
+    arrangeX(g, xValues_);
+    arrangeY(g, yConds_);
+    f = factorize(g);
+    storeProblem(key, matrixRows, g, f);
+    return substitute(f, g);
+}
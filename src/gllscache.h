@@ -0,0 +1,81 @@
+/**
+*   @file gllscache.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSCACHE_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSCACHE_H_
+
+#include "conditionset.h"
+#include "solveglls.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+    @brief on-disk cache of parsed problems and their factorizations
+
+    The input is split at its first condition line into the coefficient
+    section (names and M) and the condition section, which are hashed
+    separately. A cache directory holds two kinds of entries:
+
+        <coef hash>.coef              the parsed M
+        <coef hash>-<cond hash>.prob  xValues, yConds, the arranged problem
+                                      and its factorization
+
+    An unchanged input is solved by a substitution with the cached factors.
+    If only the conditions changed, the cached M is reused and only the
+    conditions are parsed. Unreadable or corrupted entries are misses, and
+    failures to write are ignored.
+*/
+class GllsCache
+{
+public:
+    //! @param dir an existing directory
+    explicit GllsCache(const std::string &dir);
+    //! @brief what solve() took from the cache
+    enum class Hit { NONE, COEF, PROBLEM };
+    /**
+        @brief solve the input like glls()
+
+        @param threads see GllsParser::setThreads()
+    */
+    std::vector<double> solve(std::istream &, unsigned threads = 1);
+    Hit lastHit() const { return lastHit_; }
+    //! conditions of the last solved problem
+    const std::vector<std::pair<int, double> > &xValues() const
+        { return xValues_; }
+    const ConditionSet &yConds() const { return yConds_; }
+    //! @return a 64-bit hash of the bytes [p, p+n)
+    static std::uint64_t hash(const char *p, std::size_t n);
+    /**
+        @return the offset of the first line containing '=' outside a
+                comment, i.e. the start of the condition section
+    */
+    static std::size_t condOffset(const std::string &text);
+private:
+    struct Key
+    {
+        std::uint64_t coefHash;
+        std::uint64_t coefLength;
+        std::uint64_t condHash;
+        std::uint64_t condLength;
+    };
+    std::string coefPath(const Key &) const;
+    std::string problemPath(const Key &) const;
+    bool loadCoef(const Key &, std::vector<double> &) const;
+    void storeCoef(const Key &, const std::vector<double> &) const;
+    bool loadProblem(const Key &, GllsProblem &, GllsFactorization &);
+    //! @param matrixRows the number of rows of M the conditions refer to
+    void storeProblem(
+            const Key &, std::size_t matrixRows, const GllsProblem &,
+            const GllsFactorization &
+    ) const;
+    const std::string dir_;
+    Hit lastHit_;
+    std::vector<std::pair<int, double> > xValues_;
+    ConditionSet yConds_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSCACHE_H_
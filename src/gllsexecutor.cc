@@ -0,0 +1,70 @@
+#include "gllsexecutor.h"
+#include "gllsparser.h"
+
+#include <sstream>
+#include <utility>
+
+GllsExecutor::GllsExecutor(unsigned threads)
+    : pool_(threads)
+{
+}
+
+GllsExecutor::~GllsExecutor()
+{
+}
+
+static void checkCancel(const GllsCancelToken &cancel)
+{
+    if (cancel.cancelled()) {
+        throw GllsCancelled();
+    }
+}
+
+std::future<std::vector<double> > GllsExecutor::submit(
+        std::string input,
+        Priority priority,
+        GllsCancelToken cancel
+)
+{
+    // std::function needs a copyable task
+    const auto promise = std::make_shared<std::promise<std::vector<double> > >();
+    const auto text = std::make_shared<std::string>(std::move(input));
+    ThreadPool *const pool = &pool_;
+    pool_.submit([=]() {
+        try {
+            checkCancel(cancel);
+            std::istringstream ss(*text);
+            GllsParser gp(ss, true);
+            gp.setPool(pool);
+            auto g = gp.run();
+            checkCancel(cancel);
+            arrangeX(g, gp.xValues());
+            arrangeY(g, gp.yConds(), pool);
+            checkCancel(cancel);
+            promise->set_value(solve(g, pool));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    }, priority);
+    return promise->get_future();
+}
+
+std::future<std::vector<double> > GllsExecutor::submit(
+        GllsProblem arranged,
+        Priority priority,
+        GllsCancelToken cancel
+)
+{
+    const auto promise = std::make_shared<std::promise<std::vector<double> > >();
+    const auto g = std::make_shared<GllsProblem>(std::move(arranged));
+    ThreadPool *const pool = &pool_;
+    pool_.submit([=]() {
+        try {
+            checkCancel(cancel);
+            promise->set_value(solve(*g, pool));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    }, priority);
+    return promise->get_future();
+}
@@ -0,0 +1,80 @@
+/**
+*   @file gllsexecutor.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSEXECUTOR_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSEXECUTOR_H_
+
+#include "solveglls.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//! the result of a cancelled GllsExecutor::submit()
+class GllsCancelled : public std::runtime_error
+{
+public:
+    GllsCancelled() : std::runtime_error("cancelled") {}
+};
+
+/**
+    @brief cancels the problems it was given to, copies share the state
+
+    A problem stops at the next phase boundary, i.e. before it is started,
+    parsed, arranged or factorized.
+*/
+class GllsCancelToken
+{
+public:
+    GllsCancelToken() : flag_(std::make_shared<std::atomic<bool> >(false)) {}
+    void cancel() { *flag_ = true; }
+    bool cancelled() const { return *flag_; }
+private:
+    std::shared_ptr<std::atomic<bool> > flag_;
+};
+
+/**
+    @brief solves problems asynchronously on one work-stealing pool
+
+    Each problem runs as one task of the pool, and the parser, arrangeY()
+    and factorize() of the problem schedule their parallel work onto the
+    same pool, so concurrent problems share the cores instead of each
+    starting own threads.
+*/
+class GllsExecutor
+{
+public:
+    typedef ThreadPool::Priority Priority;
+    //! @param threads number of workers, 0 for the hardware concurrency
+    explicit GllsExecutor(unsigned threads = 0);
+    //! waits for all submitted problems
+    ~GllsExecutor();
+    /**
+        @brief parse and solve an input text, see readme.md
+
+        @return the full length `x` vector; the future throws ParserError,
+                GllsCancelled or the exception of the solver
+    */
+    std::future<std::vector<double> > submit(
+            std::string input,
+            Priority priority = Priority::NORMAL,
+            GllsCancelToken cancel = GllsCancelToken()
+    );
+    //! solve a problem after arrangeX() and arrangeY()
+    std::future<std::vector<double> > submit(
+            GllsProblem arranged,
+            Priority priority = Priority::NORMAL,
+            GllsCancelToken cancel = GllsCancelToken()
+    );
+    ThreadPool &pool() { return pool_; }
+private:
+    GllsExecutor(const GllsExecutor &) = delete;
+    GllsExecutor &operator=(const GllsExecutor &) = delete;
+    ThreadPool pool_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSEXECUTOR_H_
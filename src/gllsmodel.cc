@@ -0,0 +1,172 @@
+#include "gllsmodel.h"
+#include "gllsparser.h"
+#include "parsercommon.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+GllsModel::GllsModel(
+        const double *data,
+        int rows,
+        int cols,
+        std::size_t stride,
+        bool hasConstant,
+        Storage storage
+)
+    : GllsModel(data, rows, cols, stride, 1, hasConstant, storage)
+{
+}
+
+GllsModel::GllsModel(
+        const double *data,
+        int rows,
+        int cols,
+        std::size_t rowStride,
+        std::size_t colStride,
+        bool hasConstant,
+        Storage storage
+)
+{
+    const std::size_t n = cols + hasConstant;
+    // the rows or the columns are apart by at least a whole column or row
+    const bool rowMajor = colStride > 0 && rowStride >= n * colStride;
+    const bool colMajor = rowStride > 0 && colStride >= rows * rowStride;
+    if (!data || rows <= 0 || cols <= 0 || !(rowMajor || colMajor)) {
+        throw std::invalid_argument("invalid matrix size");
+    }
+    matrix_.data = data;
+    matrix_.rows = rows;
+    matrix_.cols = cols;
+    matrix_.rowStride = rowStride;
+    matrix_.colStride = colStride;
+    matrix_.hasConstant = hasConstant;
+    if (storage == Storage::COPY) {
+        // packed row-major, without the padding
+        copy_.reserve(rows * n);
+        for (int r = 0; r < rows; ++r) {
+            const double *const row = data + r*rowStride;
+            for (std::size_t c = 0; c < n; ++c) {
+                copy_.push_back(row[c*colStride]);
+            }
+        }
+        matrix_.data = copy_.data();
+        matrix_.rowStride = n;
+        matrix_.colStride = 1;
+    }
+    setNames("x", std::vector<std::string>(1, "y"));
+}
+
+GllsModel::~GllsModel()
+{
+}
+
+void GllsModel::setNames(
+        const std::string &xName,
+        const std::vector<std::string> &symbols
+)
+{
+    std::unique_ptr<GllsParser> p(new GllsParser(noInput_));
+    p->define(xName, symbols, matrix_.cols, matrix_.rows);
+    parser_ = std::move(p);
+}
+
+void GllsModel::addConditions(const std::string &text, int firstLine)
+{
+    std::istringstream ss(text);
+    ConditionSet ys;
+    std::vector<std::pair<int, double> > xs;
+    int line = firstLine;
+    while (true) {
+        const auto p = nextLine(ss);
+        if (p.first <= 0) {
+            break;
+        }
+        line += p.first;
+        parser_->parseCondition(p.second, line-1, ys, xs);
+    }
+    yConds_.append(ys);
+    for (const auto &x : xs) {
+        xValues_[x.first] = x.second;
+    }
+}
+
+void GllsModel::addConditions(
+        std::size_t count,
+        std::size_t terms,
+        const int *conds,
+        const int *rows,
+        const double *coefs,
+        const double *constants
+)
+{
+    // bucket the terms by condition, keeping their order
+    std::vector<std::size_t> begin(count + 1);
+    for (std::size_t k = 0; k < terms; ++k) {
+        if (conds[k] < 0 || static_cast<std::size_t>(conds[k]) >= count) {
+            throw std::invalid_argument("condition index out of range");
+        }
+        if (rows[k] < 0 || rows[k] >= matrix_.rows) {
+            throw std::invalid_argument("row index out of range");
+        }
+        ++begin[conds[k] + 1];
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        begin[i+1] += begin[i];
+    }
+    std::vector<std::size_t> order(terms);
+    std::vector<std::size_t> next(begin.cbegin(), begin.cend() - 1);
+    for (std::size_t k = 0; k < terms; ++k) {
+        order[next[conds[k]]++] = k;
+    }
+    ConditionSet ys;
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t j = begin[i]; j < begin[i+1]; ++j) {
+            ys.addTerm(rows[order[j]], coefs[order[j]]);
+        }
+        if (constants) {
+            ys.addConstant(constants[i]);
+        }
+        ys.endRow();
+    }
+    // no input line
+    yConds_.append(ys, 0);
+}
+
+void GllsModel::fixX(std::size_t n, const int *index, const double *value)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        if (index[i] < 0 || index[i] >= matrix_.cols) {
+            throw std::invalid_argument("index of X out of range");
+        }
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        xValues_[index[i]] = value[i];
+    }
+}
+
+void GllsModel::clearConditions()
+{
+    yConds_.clear();
+    xValues_.clear();
+}
+
+void GllsModel::solve(double *x) const
+{
+    const auto v = solve();
+    std::copy(v.cbegin(), v.cend(), x);
+}
+
+std::vector<double> GllsModel::solve() const
+{
+    if (yConds_.empty()) {
+        throw std::invalid_argument("no condition on Y");
+    }
+    if (xValues_.size() == static_cast<std::size_t>(matrix_.cols)) {
+        throw std::invalid_argument("all values of X are fixed");
+    }
+    GllsProblem g = arrangeY(matrix_, yConds_);
+    arrangeX(g, std::vector<std::pair<int, double> >(
+            xValues_.cbegin(), xValues_.cend()));
+    return ::solve(g);
+}
@@ -0,0 +1,137 @@
+/**
+*   @file gllsmodel.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSMODEL_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSMODEL_H_
+
+#include "conditionset.h"
+#include "solveglls.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class GllsParser;
+
+/**
+    @brief a problem built from memory buffers instead of an input text
+
+    Row r of M gives Y_r = M_r0*x0 + ... + M_r(n-1)*x(n-1) [+ constant]. The
+    conditions are polynomials sum(c_k * Y_k) + constant = 0, given as text
+    lines in the input syntax or as sparse triplets, and values of X are
+    fixed by index. solve() arranges the referenced rows of M in place, so a
+    borrowed matrix is never copied.
+*/
+class GllsModel
+{
+public:
+    enum class Storage {
+        //! keep the pointer, the caller keeps the buffer alive and unchanged
+        BORROW,
+        //! copy the matrix
+        COPY
+    };
+    /**
+        @param data element (r, c) at data[r*stride + c]
+        @param cols number of X columns
+        @param stride at least cols+1 with, cols without a constant column
+        @param hasConstant whether column `cols` holds the constant
+        @throw std::invalid_argument for invalid sizes
+    */
+    GllsModel(
+            const double *data,
+            int rows,
+            int cols,
+            std::size_t stride,
+            bool hasConstant = false,
+            Storage storage = Storage::BORROW
+    );
+    /**
+        @brief a matrix of any layout, e.g. column-major from Fortran with
+               rowStride 1 and colStride the leading dimension
+
+        @param data element (r, c) at data[r*rowStride + c*colStride]
+        @throw std::invalid_argument for invalid sizes, or strides by which
+               two elements would share a place
+    */
+    GllsModel(
+            const double *data,
+            int rows,
+            int cols,
+            std::size_t rowStride,
+            std::size_t colStride,
+            bool hasConstant,
+            Storage storage = Storage::BORROW
+    );
+    ~GllsModel();
+    /**
+        @brief the names used by addConditions(const std::string &)
+
+        Without, X is named x and the rows of M are y0, y1, ... Like in the
+        input, the rows belong to the symbols in turn, i.e. with the symbols
+        a and b, row 2*i is a<i> and row 2*i+1 is b<i>.
+
+        @throw std::invalid_argument
+    */
+    void setNames(
+            const std::string &xName,
+            const std::vector<std::string> &symbols
+    );
+    /**
+        @brief append condition lines in the input syntax
+
+        @param firstLine the line number of the first line of `text`
+        @throw ParserError, no condition of `text` is kept then
+    */
+    void addConditions(const std::string &text, int firstLine = 1);
+    /**
+        @brief append `count` conditions given as triplets
+
+        Term k adds coefs[k] * Y_rows[k] to condition conds[k]; the terms may
+        come in any order. Condition i has the constant constants[i], or 0 if
+        `constants` is null.
+
+        @throw std::invalid_argument for an index out of range, no condition
+               is kept then
+    */
+    void addConditions(
+            std::size_t count,
+            std::size_t terms,
+            const int *conds,
+            const int *rows,
+            const double *coefs,
+            const double *constants = nullptr
+    );
+    /**
+        @brief fix x[index[i]] to value[i], replacing an earlier value
+
+        @throw std::invalid_argument for an index out of range
+    */
+    void fixX(std::size_t n, const int *index, const double *value);
+    //! remove all conditions and fixed values of X
+    void clearConditions();
+    /**
+        @param x receives the cols() entries of X
+        @throw std::invalid_argument if there is no condition on Y
+    */
+    void solve(double *x) const;
+    std::vector<double> solve() const;
+    int rows() const { return matrix_.rows; }
+    int cols() const { return matrix_.cols; }
+    const ConditionSet &yConds() const { return yConds_; }
+private:
+    GllsModel(const GllsModel &) = delete;
+    GllsModel &operator=(const GllsModel &) = delete;
+    std::vector<double> copy_;
+    GllsMatrixView matrix_;
+    //! parseCondition() only, never reads its stream
+    std::istringstream noInput_;
+    std::unique_ptr<GllsParser> parser_;
+    ConditionSet yConds_;
+    std::map<int, double> xValues_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSMODEL_H_
@@ -2,17 +2,61 @@
 #include "condtree.h"
 #include "parsercommon.h"
 #include "condparser.h"
+#include "gllsprofile.h"
+#include "gllstrace.h"
+#include "threadpool.h"
 
 #include <vector>
-#include <list>
 #include <sstream>
 #include <algorithm>
 #include <functional>
 #include <cassert>
 #include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+struct GllsParser::CondBuffer
+{
+    //! conditions in front of the first block header of the lines
+    ConditionSet yConds;
+    std::vector<std::pair<int, double> > xValues;
+    //! blocks started by the lines
+    std::vector<ConditionBlock> blocks;
+    //! where the conditions of the next line go
+    ConditionSet &ys() { return blocks.empty() ? yConds : blocks.back().yConds; }
+    std::vector<std::pair<int, double> > &xs()
+        { return blocks.empty() ? xValues : blocks.back().xValues; }
+    //! rows of the line being attached
+    ConditionSet line;
+    //! header of `line` if the line is a family
+    CondFamily family;
+};
 
 GllsParser::GllsParser(std::istream &stream_, bool homo)
-        : stream_(stream_), isHomogeneous_(homo), currentLine_(1), xVarSize_(0)
+        : stream_(stream_), isHomogeneous_(homo), threads_(1), pool_(nullptr),
+          lazy_(false), hasPresetCoef_(false), conditionsRequired_(true),
+          blocksAllowed_(false), currentLine_(1), xVarSize_(0)
+{
+}
+
+void GllsParser::setThreads(unsigned n)
+{
+    threads_ = n ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void GllsParser::presetCoef(std::vector<double> coef)
+{
+    presetCoef_ = std::move(coef);
+    hasPresetCoef_ = true;
+}
+
+GllsParser::~GllsParser()
 {
 }
 
@@ -22,13 +66,70 @@ GllsProblem GllsParser::run()
     sym_.clear();
     readYVarNames();
     coef_.clear();
+    coefRows_.clear();
+    xValues_.clear();
+    yConds_.clear();
+    blocks_.clear();
     readCoefWithCond();
     GllsProblem g;
     g.coef = coef_;
+    g.rows = coefRows_;
     g.xSize = xVarSize_;
     return g;
 }
 
+static bool isName(const std::string &s)
+{
+    return !s.empty() && std::all_of(s.cbegin(), s.cend(),
+            [](char c) { return std::isalpha(static_cast<unsigned char>(c)); });
+}
+
+void GllsParser::define(
+        const std::string &xVarName,
+        const std::vector<std::string> &symbols,
+        int xVarSize,
+        int yVarSize
+)
+{
+    if (!isName(xVarName)) {
+        throw std::invalid_argument("invalid name " + xVarName);
+    }
+    if (symbols.empty() || xVarSize <= 0 || yVarSize <= 0
+            || yVarSize % symbols.size()) {
+        throw std::invalid_argument("the names do not fit the matrix");
+    }
+    SymbolList sym;
+    for (const auto &s : symbols) {
+        if (!isName(s) || s == xVarName) {
+            throw std::invalid_argument("invalid name " + s);
+        }
+        if (!sym.insert(s)) {
+            throw std::invalid_argument("duplicated name " + s);
+        }
+    }
+    xVarName_ = xVarName;
+    sym_ = std::move(sym);
+    dict_.reset(new CondDict(
+            std::make_shared<FrozenSymbolList>(sym_), xVarName_));
+    xVarSize_ = xVarSize;
+    yVarSize_ = yVarSize;
+}
+
+void GllsParser::parseCondition(
+        const std::string &s,
+        int line,
+        ConditionSet &ys,
+        std::vector<std::pair<int, double> > &xs
+) const
+{
+    assert(dict_);
+    CondBuffer buf;
+    attachCond(s, line, buf);
+    assert(buf.blocks.empty());
+    ys.append(buf.yConds);
+    xs.insert(xs.end(), buf.xValues.cbegin(), buf.xValues.cend());
+}
+
 void GllsParser::readXVarName()
 {
     static const std::string fail_msg("failed to read name of the unknown");
@@ -103,40 +204,356 @@ void GllsParser::readYVarNames()
             );
         }
     }
+    dict_.reset(new CondDict(
+            std::make_shared<FrozenSymbolList>(sym_), xVarName_));
+}
+
+//! number of coefficient rows per recorded stream position in lazy mode
+static const int COEF_BLOCK = 64;
+
+static bool isBlockHeader(const std::string &s)
+{
+    const auto i = s.find_first_not_of(" \t");
+    return i != s.npos && s[i] == '[';
 }
 
 void GllsParser::readCoefWithCond()
 {
+    const bool lazy = !hasPresetCoef_
+        && lazy_ && stream_.tellg() != std::streampos(-1);
+    coefBlocks_.clear();
     std::string firstCond;
-    while (true) {
-        const auto p = nextLine(stream_);
-        checkGood(p, "unexpected file end");
-        currentLine_ += p.first;
-        const std::string &s = p.second;
-        if (s.find('=') != s.npos) {
-            firstCond = s;
-            break;
+    int rows = 0;
+    {
+        GllsProfile::Span span("readCoefWithCond");
+        GllsTrace::Span trace("readCoef", "rows", 0);
+        while (true) {
+            const auto pos = lazy ? stream_.tellg() : std::streampos(0);
+            const auto p = nextLine(stream_);
+            if (p.first <= 0 && rows > 0 && !conditionsRequired_) {
+                currentLine_ -= p.first;
+                break;
+            }
+            checkGood(p, "unexpected file end");
+            const int line = currentLine_;
+            currentLine_ += p.first;
+            const std::string &s = p.second;
+            if (s.find('=') != s.npos || isBlockHeader(s)) {
+                firstCond = s;
+                break;
+            }
+            if (lazy && rows % COEF_BLOCK == 0) {
+                coefBlocks_.push_back(std::make_pair(pos, line));
+            }
+            // the first row is parsed anyway for the size of X
+            if (!(lazy || hasPresetCoef_) || rows == 0) {
+                attachCoef(s);
+                span.addRows(1);
+            }
+            span.addBytes(s.size() + 1);
+            ++rows;
         }
-        attachCoef(s);
+        trace.setArg(rows);
     }
-    yVarSize_ = coef_.size() / (xVarSize_+1);
-    if ( coef_.size() % ((xVarSize_+1) *sym_.size()) ) {
+    yVarSize_ = rows;
+    if (rows % sym_.size()) {
         throw ParserError(
                 currentLine_-1,
                 "rows of coefficients are unaligned",
                 ParserError::Type::EXPECT_DIGIT
         );
     }
-    attachCond(firstCond);
+    if (hasPresetCoef_) {
+        if (presetCoef_.size() != static_cast<std::size_t>(rows)*(xVarSize_+1)) {
+            throw ParserError(
+                    currentLine_-1,
+                    "preset coefficients do not fit the input",
+                    ParserError::Type::SEMANTIC_ERROR
+            );
+        }
+        coef_ = presetCoef_;
+    }
+    if (!firstCond.empty()) {
+        GllsProfile::Span span("attachCond");
+        if (pool_) {
+            readCondBatched(firstCond, *pool_);
+        } else if (threads_ > 1) {
+            ThreadPool pool(threads_ - 1);
+            readCondBatched(firstCond, pool);
+        } else {
+            readCond(firstCond);
+        }
+        std::size_t conds = yConds_.expandedSize();
+        for (const auto &b : blocks_) {
+            conds += b.yConds.expandedSize();
+        }
+        span.addRows(conds);
+    }
+    checkBlockNames();
+    if (lazy) {
+        loadReferencedRows();
+    }
+}
+
+/**
+    Collect the Y IDs, i.e. the row indices of M, used by the conditions,
+    and parse these rows in ascending order. Rows in the same block are
+    reached by reading forward instead of seeking.
+*/
+void GllsParser::loadReferencedRows()
+{
+    std::vector<int> &rows = coefRows_;
+    rows.clear();
+    const auto collect = [&rows](const ConditionSet::RowView &r) {
+        rows.insert(rows.end(), r.ids, r.ids + r.size);
+        for (std::size_t k = 0; k < r.rangeCount; ++k) {
+            const auto &range = r.ranges[k];
+            for (int n = 0; n < range.count; ++n) {
+                rows.push_back(range.first + n * range.stride);
+            }
+        }
+    };
+    yConds_.forEachRow(collect);
+    for (const auto &b : blocks_) {
+        b.yConds.forEachRow(collect);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    GllsProfile::Span span("readCoefWithCond");
+    GllsTrace::Span trace("loadReferencedRows", "rows", rows.size());
+    span.addRows(rows.size());
+    coef_.clear();
+    coef_.reserve(rows.size() * (xVarSize_+1));
+    const int endLine = currentLine_;
+    stream_.clear();
+    int next = -1;
+    for (const int row : rows) {
+        assert(row >= 0 && row < yVarSize_);
+        if (next < 0 || row / COEF_BLOCK != next / COEF_BLOCK) {
+            const auto &b = coefBlocks_[row / COEF_BLOCK];
+            stream_.seekg(b.first);
+            currentLine_ = b.second;
+            next = row - row % COEF_BLOCK;
+        }
+        for (; next <= row; ++next) {
+            const auto p = nextLine(stream_);
+            checkGood(p, "unexpected file end");
+            currentLine_ += p.first;
+            if (next == row) {
+                parseCoefRow(p.second);
+            }
+        }
+    }
+    currentLine_ = endLine;
+}
+
+void GllsParser::readCond(const std::string &firstCond)
+{
+    GllsTrace::Span trace("readCond");
+    CondBuffer buf;
+    attachCond(firstCond, currentLine_-1, buf);
     while (true) {
         const auto p = nextLine(stream_);
         currentLine_ += p.first;
         if (p.first > 0) {
-            attachCond(p.second);
+            attachCond(p.second, currentLine_-1, buf);
         } else {
             break;
         }
     }
+    assemble(buf);
+}
+
+void GllsParser::assemble(CondBuffer &buf)
+{
+    ConditionSet &ys = blocks_.empty() ? yConds_ : blocks_.back().yConds;
+    auto &xs = blocks_.empty() ? xValues_ : blocks_.back().xValues;
+    ys.append(buf.yConds);
+    xs.insert(xs.end(), buf.xValues.cbegin(), buf.xValues.cend());
+    std::move(buf.blocks.begin(), buf.blocks.end(),
+            std::back_inserter(blocks_));
+}
+
+void GllsParser::checkBlockNames() const
+{
+    std::vector<const ConditionBlock *> sorted;
+    sorted.reserve(blocks_.size());
+    for (const auto &b : blocks_) {
+        sorted.push_back(&b);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+        [](const ConditionBlock *a, const ConditionBlock *b) {
+            return a->name < b->name || (a->name == b->name && a->line < b->line);
+        });
+    // report the first repetition in input order
+    const ConditionBlock *dup = nullptr;
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        if (sorted[i]->name == sorted[i-1]->name
+                && (!dup || sorted[i]->line < dup->line)) {
+            dup = sorted[i];
+        }
+    }
+    if (dup) {
+        throw ParserError(
+                dup->line,
+                "duplicated block name " + dup->name,
+                ParserError::Type::SEMANTIC_ERROR
+        );
+    }
+}
+
+namespace {
+
+struct LineBatch
+{
+    std::size_t seq;
+    //! pairs of line number and content
+    std::vector<std::pair<int, std::string> > lines;
+};
+
+} // namespace
+
+/**
+    The lines are read into batches, the batches are parsed into their own
+    CondBuffer and appended in order of their sequence number. Every task
+    of `pool.parallelFor()` runs the same loop and takes whichever of the
+    three is due: appending the next batch, parsing a batch, or reading the
+    next one, reading and appending by one task at a time. At most `window`
+    batches are in flight. The calling thread runs a task as well, so this
+    may be called from a task of the pool and makes progress even if no
+    worker is free. The first error in input order is rethrown.
+*/
+void GllsParser::readCondBatched(const std::string &firstCond, ThreadPool &pool)
+{
+    const std::size_t batchSize = 256;
+    const std::size_t tasks = pool.size() + 1;
+    const std::size_t window = 4 * tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<LineBatch> todo;
+    std::map<std::size_t, std::pair<CondBuffer, std::exception_ptr> > done;
+    std::size_t produced = 1;
+    std::size_t assembled = 0;
+    bool reading = false;
+    bool assembling = false;
+    bool eof = false;
+    std::exception_ptr error;
+
+    // the first batch holds the line read by readCoefWithCond()
+    todo.emplace_back();
+    todo.back().seq = 0;
+    todo.back().lines.emplace_back(currentLine_-1, firstCond);
+
+    const auto finished = [&]() {
+        return error || (eof && assembled == produced);
+    };
+    const auto canRead = [&]() {
+        return !reading && !eof && produced < assembled + window;
+    };
+    const auto canAssemble = [&]() {
+        return !assembling && done.count(assembled) > 0;
+    };
+
+    // reads the lines of the next batch, with `mutex` unlocked
+    const auto read = [&](LineBatch &batch) {
+        GllsTrace::Span trace("nextLine", "lines", 0);
+        bool end = false;
+        while (batch.lines.size() < batchSize) {
+            auto p = nextLine(stream_);
+            currentLine_ += p.first;
+            if (p.first <= 0) {
+                end = true;
+                break;
+            }
+            batch.lines.emplace_back(currentLine_-1, std::move(p.second));
+        }
+        trace.setArg(batch.lines.size());
+        return end;
+    };
+    const auto parse = [&](const LineBatch &batch, CondBuffer &buf) {
+        GllsTrace::Span trace("attachCond", "line", batch.lines.front().first);
+        for (const auto &l : batch.lines) {
+            attachCond(l.second, l.first, buf);
+        }
+    };
+
+    pool.parallelFor(tasks, [&](std::size_t) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&]{
+                return finished() || canAssemble() || !todo.empty()
+                    || canRead();
+            });
+            if (finished()) {
+                return;
+            }
+            if (canAssemble()) {
+                const auto it = done.find(assembled);
+                if (it->second.second) {
+                    error = it->second.second;
+                    cv.notify_all();
+                    return;
+                }
+                CondBuffer buf = std::move(it->second.first);
+                done.erase(it);
+                assembling = true;
+                lock.unlock();
+                std::exception_ptr e;
+                try {
+                    assemble(buf);
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                lock.lock();
+                assembling = false;
+                if (e) {
+                    error = e;
+                } else {
+                    ++assembled;
+                }
+            } else if (!todo.empty()) {
+                LineBatch batch = std::move(todo.front());
+                todo.pop_front();
+                lock.unlock();
+                CondBuffer buf;
+                std::exception_ptr e;
+                try {
+                    parse(batch, buf);
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                lock.lock();
+                done.emplace(batch.seq, std::make_pair(std::move(buf), e));
+            } else {
+                LineBatch batch;
+                batch.seq = produced;
+                reading = true;
+                lock.unlock();
+                bool end = true;
+                std::exception_ptr e;
+                try {
+                    end = read(batch);
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                lock.lock();
+                reading = false;
+                eof = end;
+                if (e) {
+                    // ordered after the batches read before
+                    done.emplace(produced++,
+                            std::make_pair(CondBuffer(), e));
+                } else if (!batch.lines.empty()) {
+                    todo.push_back(std::move(batch));
+                    ++produced;
+                }
+            }
+            cv.notify_all();
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
 }
 
 void GllsParser::attachCoef(const std::string &s)
@@ -145,6 +562,11 @@ void GllsParser::attachCoef(const std::string &s)
         guessXVarSize(s);
         return;
     }
+    parseCoefRow(s);
+}
+
+void GllsParser::parseCoefRow(const std::string &s)
+{
     std::istringstream ss(s);
     const int len = isHomogeneous_ ? xVarSize_ : (xVarSize_+1);
     for (int i = 0; i < len; ++i) {
@@ -196,124 +618,277 @@ void GllsParser::guessXVarSize(const std::string &s)
     assert(xVarSize_ > 0);
 }
 
-static std::list<std::vector<std::pair<int, double> > >
-auxLinearEquation(
+/** @return true if the line is a family, whose header is copied to `family` */
+static bool auxLinearEquation(
         const std::string &s,
-        const SymbolList &sl,
-        const std::string &xName
+        const CondDict &dict,
+        ConditionSet &cs,
+        CondFamily &family
 )
 {
-    std::istringstream ss(s);
-    auto cp = CondParser(ss, sl, xName);
-    auto cs = cp.parse();
-    std::list<std::vector<std::pair<int, double> > > ls(cs.size());
-    std::transform(cs.begin(), cs.end(), ls.begin(),
-        [](CondTree &t){
-            const auto res = finalizeTree(t);
-            if (res != FinalizationStatus::SUCCESS) {
-                throw ParserError(
-                        0,
-                        toString(res),
-                        ParserError::Type::SEMANTIC_ERROR
-                );
-            }
-            return toList(t);
+    auto cp = CondParser(s.data(), s.data() + s.size(), dict);
+    std::vector<CondTree> trees;
+    {
+        GllsTrace::Span trace("CondParser::parse");
+        trees = cp.parse();
+    }
+    for (auto &t : trees) {
+        const auto res = finalizeTree(t);
+        if (res != FinalizationStatus::SUCCESS) {
+            throw ParserError(
+                    0,
+                    toString(res),
+                    ParserError::Type::SEMANTIC_ERROR
+            );
         }
-    );
-    return ls;
+        toRow(t, cs);
+    }
+    if (cp.isFamily()) {
+        family = cp.family();
+    }
+    return cp.isFamily();
 }
 
-static bool auxHasSymbol(
-        const std::list<std::vector<std::pair<int, double> > > &ls,
-        std::function<bool(int)> f
-)
+static bool auxHasSymbol(const ConditionSet &cs, std::function<bool(int)> f)
 {
-    return std::any_of(ls.cbegin(), ls.cend(),
-            [&f](const std::vector<std::pair<int, double> > &xs) {
-                return std::any_of(xs.begin(), xs.end(),
-                        [&f](const std::pair<int, double> &x){
-                            return f(x.first);
-                        }
-                );
-            }
-    );
+    return std::any_of(cs.ids().cbegin(), cs.ids().cend(), f);
 }
 
-void GllsParser::attachCond(const std::string &s)
+void GllsParser::attachCond(
+        const std::string &s,
+        int line,
+        CondBuffer &buf
+) const
 {
     assert(!s.empty());
-    std::list<std::vector<std::pair<int, double> > > ls;
+    if (isBlockHeader(s)) {
+        attachBlock(s, line, buf);
+        return;
+    }
+    ConditionSet &cs = buf.line;
+    cs.clear();
+    bool isFamily = false;
     try {
-        ls = auxLinearEquation(s, sym_, xVarName_);
+        isFamily = auxLinearEquation(s, *dict_, cs, buf.family);
     } catch (ParserError &e) {
-        throw ParserError(e.line()+currentLine_-1, e.msg(), e.type());
+        throw ParserError(e.line()+line, e.msg(), e.type());
+    }
+    if (isFamily) {
+        attachFamily(line, buf);
+        return;
     }
-    const bool hasX = auxHasSymbol(ls, std::bind2nd(std::less_equal<int>(),
-                    static_cast<int>(CondDict::ID_X_VAR_NEG_BASE)));
-    const bool hasY = auxHasSymbol(ls, std::bind2nd(std::greater_equal<int>(),
-                    static_cast<int>(CondDict::ID_Y_VAR_POS_BASE)));
+    const bool hasX = auxHasSymbol(cs, std::bind2nd(
+            std::less_equal<int>(),
+            static_cast<int>(CondDict::ID_X_VAR_NEG_BASE)));
+    const bool hasY = !cs.ranges().empty()
+        || auxHasSymbol(cs, std::bind2nd(
+            std::greater_equal<int>(),
+            static_cast<int>(CondDict::ID_Y_VAR_POS_BASE)));
     if (hasX && hasY) {
         throw ParserError(
-                currentLine_-1,
+                line,
                 "can not mix X and Y parameters",
                 ParserError::Type::SEMANTIC_ERROR
         );
     }
     if (hasX) {
-        solveX(ls);
+        solveX(cs, line, buf);
         return;
     }
     if (hasY) {
-        const auto invalidY = auxHasSymbol(ls,
-                std::bind2nd(std::greater_equal<int>(), yVarSize_));
+        const auto &ranges = cs.ranges();
+        const auto invalidY = auxHasSymbol(cs,
+                std::bind2nd(std::greater_equal<int>(), yVarSize_))
+            || std::any_of(ranges.cbegin(), ranges.cend(),
+                [this](const ConditionSet::Range &r) {
+                    return r.first + (r.count-1LL) * r.stride >= yVarSize_;
+                });
         if (invalidY) {
             throw ParserError(
-                    currentLine_-1,
+                    line,
                     "too large index of the unknown",
                     ParserError::Type::SEMANTIC_ERROR
             );
         }
-        yConds_.insert(yConds_.end(), ls.begin(), ls.end());
+        buf.ys().append(cs, line);
         return;
     }
     throw ParserError(
-            currentLine_-1,
+            line,
             "equation does not have any unknown",
             ParserError::Type::SEMANTIC_ERROR
     );
 }
 
+void GllsParser::attachBlock(
+        const std::string &s,
+        int line,
+        CondBuffer &buf
+) const
+{
+    if (!blocksAllowed_) {
+        throw ParserError(
+                line,
+                "unexpected condition block header",
+                ParserError::Type::UNEXPECTED_CHAR
+        );
+    }
+    const auto b = s.find('[');
+    const auto e = s.find(']', b);
+    if (e == s.npos || e+1 != s.size()) {
+        throw ParserError(
+                line,
+                "block header must be [name]",
+                ParserError::Type::EXPECT_CHAR
+        );
+    }
+    ConditionBlock block;
+    block.name = s.substr(b+1, e-b-1);
+    block.line = line;
+    const auto valid = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c))
+            || c == '_' || c == '-' || c == '.';
+    };
+    if (block.name.empty()
+            || !std::all_of(block.name.cbegin(), block.name.cend(), valid)) {
+        throw ParserError(
+                line,
+                "invalid block name " + block.name,
+                ParserError::Type::INVALID_TOKEN
+        );
+    }
+    buf.blocks.push_back(std::move(block));
+}
+
 void GllsParser::solveX(
-        const std::list<std::vector<std::pair<int, double>>>  &ls
-)
+        const ConditionSet &cs,
+        int line,
+        CondBuffer &buf
+) const
 {
-    if (ls.size() != 1) {
+    if (cs.size() != 1) {
         throw ParserError(
-                currentLine_-1,
+                line,
                 "this version do not accept multiple equation of variable "
                 + xVarName_ + " in one same line",
                 ParserError::Type::SEMANTIC_ERROR
         );
     }
     /* solve X */
-    if (ls.cbegin()->size() != 2
-        || (*ls.cbegin())[1].first != CondDict::ID_CONST) {
+    if (cs.rowEnd(0) - cs.rowBegin(0) != 1) {
         throw ParserError(
-                currentLine_-1,
+                line,
                 "this version only solves one "
                 + xVarName_ + " variable in one equation",
                 ParserError::Type::SEMANTIC_ERROR
         );
     }
-    const auto id = CondDict::ID_X_VAR_NEG_BASE-(*ls.cbegin())[0].first;
+    const auto id = CondDict::ID_X_VAR_NEG_BASE-cs.ids()[0];
     if (id >= xVarSize_) {
         throw ParserError(
-                currentLine_-1,
+                line,
                 "variable "
                 + xVarName_ + std::to_string(id) + " does not exist",
                 ParserError::Type::SEMANTIC_ERROR
         );
     }
-    xValues_.push_back(std::make_pair(
-            id,-(*ls.cbegin())[1].second/(*ls.cbegin())[0].second) );
+    buf.xs().push_back(std::make_pair(
+            id, -cs.constants()[0]/cs.coefs()[0]) );
+}
+
+/**
+    The rows in buf.line refer to the terms of buf.family. The indices are
+    checked once for the whole range, then a Y family is stored as template
+    rows for a lazy expansion, whereas an X family is solved for each value.
+*/
+void GllsParser::attachFamily(int line, CondBuffer &buf) const
+{
+    const CondFamily &fam = buf.family;
+    const ConditionSet &lineConds = buf.line;
+    bool hasX = false;
+    bool hasY = false;
+    for (const int t : lineConds.ids()) {
+        const auto &term = fam.terms[t];
+        const long long a = 1LL * term.scale * fam.first + term.offset;
+        const long long b = 1LL * term.scale * fam.last + term.offset;
+        const long long lo = std::min(a, b);
+        const long long hi = std::max(a, b);
+        if (lo < 0) {
+            throw ParserError(
+                    line,
+                    "negative index in the family",
+                    ParserError::Type::SEMANTIC_ERROR
+            );
+        }
+        if (term.id0 <= CondDict::ID_X_VAR_NEG_BASE) {
+            hasX = true;
+            if (hi >= xVarSize_) {
+                throw ParserError(
+                        line,
+                        "variable " + xVarName_ + std::to_string(hi)
+                        + " does not exist",
+                        ParserError::Type::SEMANTIC_ERROR
+                );
+            }
+        } else {
+            hasY = true;
+            if (term.id0 + hi * dict_->yStride() >= yVarSize_) {
+                throw ParserError(
+                        line,
+                        "too large index of the unknown",
+                        ParserError::Type::SEMANTIC_ERROR
+                );
+            }
+        }
+    }
+    if (hasX && hasY) {
+        throw ParserError(
+                line,
+                "can not mix X and Y parameters",
+                ParserError::Type::SEMANTIC_ERROR
+        );
+    }
+    if (!(hasX || hasY)) {
+        throw ParserError(
+                line,
+                "equation does not have any unknown",
+                ParserError::Type::SEMANTIC_ERROR
+        );
+    }
+    const auto &ids = lineConds.ids();
+    const auto &coefs = lineConds.coefs();
+    if (hasX) {
+        ConditionSet cs;
+        for (int i = fam.first; i <= fam.last; ++i) {
+            cs.clear();
+            for (std::size_t r = 0; r < lineConds.size(); ++r) {
+                for (auto k = lineConds.rowBegin(r);
+                        k != lineConds.rowEnd(r); ++k) {
+                    const auto &term = fam.terms[ids[k]];
+                    cs.addTerm(
+                            dict_->shiftID(
+                                    term.id0, term.scale * i + term.offset),
+                            coefs[k]);
+                }
+                cs.addConstant(lineConds.constants()[r]);
+                cs.endRow();
+            }
+            solveX(cs, line, buf);
+        }
+        return;
+    }
+    ConditionSet &ys = buf.ys();
+    ys.setLine(line);
+    for (std::size_t r = 0; r < lineConds.size(); ++r) {
+        for (auto k = lineConds.rowBegin(r); k != lineConds.rowEnd(r); ++k) {
+            const auto &term = fam.terms[ids[k]];
+            ys.addFamilyTerm(
+                    dict_->shiftID(
+                            term.id0, term.scale * fam.first + term.offset),
+                    term.scale * dict_->yStride(),
+                    coefs[k]);
+        }
+        ys.endFamilyRow(lineConds.constants()[r]);
+    }
+    ys.endFamily(fam.last - fam.first + 1);
 }
@@ -7,25 +7,128 @@
 
 #include "symbollist.h"
 #include "solveglls.h"
-#include <iosfwd>
+#include "conditionset.h"
+#include <ios>
 #include <vector>
-#include <list>
 #include <string>
+#include <memory>
+
+class CondDict;
+class ThreadPool;
+struct CondFamily;
+
+/**
+    @brief conditions following a block header `[name]`
+
+    The conditions in front of the first header are common to all blocks,
+    see GllsParser::setBlocksAllowed().
+*/
+struct ConditionBlock
+{
+    std::string name;
+    //! line number of the header
+    int line;
+    ConditionSet yConds;
+    std::vector<std::pair<int, double> > xValues;
+};
 
 class GllsParser
 {
 public:
     GllsParser(std::istream &stream_, bool homogeneous = true);
+    ~GllsParser();
+    /**
+        @brief number of threads for parsing the conditions
+
+        With more than one thread, the condition lines are read in batches,
+        which are parsed by `n` threads and assembled in the input order,
+        see setPool(). 0 stands for the hardware concurrency.
+    */
+    void setThreads(unsigned n);
+    /**
+        @brief parse the conditions on a shared pool instead of own threads
+
+        The same batches as with setThreads(), but read, parsed and
+        assembled by ThreadPool::parallelFor() on `pool`, so run() may be
+        called from a task of the pool. Overrides setThreads(). Null for
+        own threads.
+    */
+    void setPool(ThreadPool *pool) { pool_ = pool; }
+    /**
+        @brief load only the coefficient rows referenced by the conditions
+
+        The first pass over the stream records the positions of the
+        coefficient rows without parsing them, and parses the conditions.
+        The second pass seeks back and parses the referenced rows only, so
+        coef() holds the rows listed in coefRows(). Unreferenced rows are
+        not validated. A stream which can not seek is read as usual.
+    */
+    void setLazy(bool lazy) { lazy_ = lazy; }
+    /**
+        @brief reuse the coefficients parsed from the same input before
+
+        The coefficient rows of the stream are only counted, and run()
+        fails if their number does not fit `coef`.
+    */
+    void presetCoef(std::vector<double> coef);
+    /**
+        @brief whether the input must have condition lines, the default
+
+        Without, the input may end after the coefficients, and the
+        conditions are added with parseCondition() afterwards.
+    */
+    void setConditionsRequired(bool required)
+        { conditionsRequired_ = required; }
+    /**
+        @brief accept named condition blocks, not by default
+
+        A line `[name]` after the coefficients starts a block, which holds
+        the conditions up to the next header. The conditions in front of
+        the first header stay in yConds() and xValues(). Without, a header
+        is an error.
+    */
+    void setBlocksAllowed(bool allowed) { blocksAllowed_ = allowed; }
     GllsProblem run();
+    /**
+        @brief prepare parseCondition() without run(), for a matrix which
+               is not read from the stream
+
+        @param yVarSize the number of rows of M, a multiple of the number
+               of symbols
+        @throw std::invalid_argument for invalid or duplicated names
+    */
+    void define(
+            const std::string &xVarName,
+            const std::vector<std::string> &symbols,
+            int xVarSize,
+            int yVarSize
+    );
+    /**
+        @brief parse one more condition line after run()
+
+        The line is checked against the names and sizes read by run(), and
+        its conditions are appended to `ys` and `xs`.
+
+        @param line the line number reported by a ParserError
+    */
+    void parseCondition(
+            const std::string &s,
+            int line,
+            ConditionSet &ys,
+            std::vector<std::pair<int, double> > &xs
+    ) const;
     const std::string &xVarName() const { return xVarName_; }
     const SymbolList &symbols() const { return sym_; }
     int xVarSize() const { return xVarSize_; }
     int yVarSize() const { return yVarSize_; }
     const std::vector<double> &coef() const { return coef_; }
-    const std::list<std::vector<std::pair<int, double> > > &yConds() const
-        { return yConds_; }
+    //! rows of M held by coef() in lazy mode, empty if coef() holds all
+    const std::vector<int> &coefRows() const { return coefRows_; }
+    const ConditionSet &yConds() const { return yConds_; }
     const std::vector<std::pair<int, double> > &xValues() const
         { return xValues_; }
+    //! in input order, empty if the input has no block header
+    const std::vector<ConditionBlock> &blocks() const { return blocks_; }
 private:
     GllsParser(const GllsParser &) = delete;
     GllsParser &operator=(const GllsParser &) = delete;
@@ -40,21 +143,48 @@ private:
     */
     void readCoefWithCond();
     void attachCoef(const std::string &s);
-    void attachCond(const std::string &s);
+    void parseCoefRow(const std::string &s);
+    void loadReferencedRows();
+    /** parsed conditions of some lines, and scratch space of one line */
+    struct CondBuffer;
+    void readCond(const std::string &firstCond);
+    void readCondBatched(const std::string &firstCond, ThreadPool &);
+    void attachCond(const std::string &s, int line, CondBuffer &) const;
+    void attachBlock(const std::string &s, int line, CondBuffer &) const;
+    //! append the parsed lines in input order
+    void assemble(CondBuffer &);
+    void checkBlockNames() const;
     void guessXVarSize(const std::string &s);
     std::istream &stream_;
     const bool isHomogeneous_;
+    unsigned threads_;
+    ThreadPool *pool_;
+    bool lazy_;
+    bool hasPresetCoef_;
+    std::vector<double> presetCoef_;
+    bool conditionsRequired_;
+    bool blocksAllowed_;
     int currentLine_;
     int xVarSize_;
     int yVarSize_;
     std::string xVarName_;
     SymbolList sym_;
+    /** frozen after readYVarNames(), shared by all condition lines */
+    std::unique_ptr<const CondDict> dict_;
     std::vector<double> coef_;
+    std::vector<int> coefRows_;
+    /**
+        lazy mode: stream position and line number in front of every
+        COEF_BLOCK-th coefficient row
+    */
+    std::vector<std::pair<std::streampos, int> > coefBlocks_;
     /** the presentation of X_n = c, with n >= 0 in int and c in double */
     std::vector<std::pair<int, double> > xValues_;
-    /** list of zerofied polynomials */
-    std::list<std::vector<std::pair<int, double> > > yConds_;
-    void solveX(const std::list<std::vector<std::pair<int, double> > > &);
+    /** zerofied polynomials of Y */
+    ConditionSet yConds_;
+    std::vector<ConditionBlock> blocks_;
+    void solveX(const ConditionSet &, int line, CondBuffer &) const;
+    void attachFamily(int line, CondBuffer &) const;
 };
 
 
@@ -0,0 +1,354 @@
+#include "gllsprofile.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+std::atomic<GllsProfile *> GllsProfile::active_(nullptr);
+std::atomic<std::uint64_t> GllsProfile::allocatedBytes_(0);
+std::atomic<std::uint64_t> GllsProfile::allocations_(0);
+std::atomic<bool> GllsProfile::countingAllocations_(false);
+std::atomic<bool> GllsProfile::countingHardware_(false);
+
+//! bytes loaded from memory per last level cache miss
+static const double CACHE_LINE = 64;
+
+//! the perf_event_open() descriptors of the counters, -1 if not counted
+static int counterFds[GllsProfile::COUNTERS] = {-1, -1, -1, -1, -1};
+
+bool GllsProfile::setCountingHardware(bool on)
+{
+    for (int &fd : counterFds) {
+        if (fd >= 0) {
+#ifdef __linux__
+            close(fd);
+#endif
+            fd = -1;
+        }
+    }
+    bool any = false;
+#ifdef __linux__
+    const std::uint64_t configs[COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int c = 0; on && c < COUNTERS; ++c) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[c];
+        // the threads started afterwards, e.g. of a pool, add to the count
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // to scale the count if the events share the PMU
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counterFds[c] = static_cast<int>(
+                syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        any = any || counterFds[c] >= 0;
+    }
+#endif
+    countingHardware_ = any;
+    return any;
+}
+
+bool GllsProfile::hasCounter(Counter c)
+{
+    return counterFds[c] >= 0;
+}
+
+//! the current counts, scaled to the whole time if multiplexed
+static void readCounters(std::uint64_t *v)
+{
+    for (int c = 0; c < GllsProfile::COUNTERS; ++c) {
+        v[c] = 0;
+#ifdef __linux__
+        std::uint64_t r[3];
+        if (counterFds[c] >= 0
+                && read(counterFds[c], r, sizeof(r)) == sizeof(r)
+                && r[2] > 0) {
+            v[c] = r[2] < r[1]
+                ? static_cast<std::uint64_t>(double(r[0]) * r[1] / r[2])
+                : r[0];
+        }
+#endif
+    }
+}
+
+//! @return the peak resident set size of the process in bytes, 0 if unknown
+static std::size_t peakRss()
+{
+#ifdef __linux__
+    rusage u;
+    if (getrusage(RUSAGE_SELF, &u) == 0) {
+        return static_cast<std::size_t>(u.ru_maxrss) * 1024;
+    }
+#endif
+    return 0;
+}
+
+void GllsProfile::Span::begin()
+{
+    startBytes_ = allocatedBytes_.load();
+    startAllocations_ = allocations_.load();
+    if (countingHardware_) {
+        readCounters(startCounters_);
+    }
+    cpu_ = std::clock();
+    wall_ = std::chrono::steady_clock::now();
+}
+
+void GllsProfile::Span::end()
+{
+    Phase p;
+    p.wallSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - wall_).count();
+    p.cpuSeconds = double(std::clock() - cpu_) / CLOCKS_PER_SEC;
+    if (countingHardware_) {
+        readCounters(p.counters);
+        for (int c = 0; c < COUNTERS; ++c) {
+            p.counters[c] -= std::min(p.counters[c], startCounters_[c]);
+        }
+    } else {
+        std::fill(p.counters, p.counters + COUNTERS, 0);
+    }
+    p.name = phase_;
+    p.calls = 1;
+    p.allocatedBytes = allocatedBytes_.load() - startBytes_;
+    p.allocations = allocations_.load() - startAllocations_;
+    p.peakRss = peakRss();
+    p.rows = rows_;
+    p.bytes = bytes_;
+    p.flops = flops_;
+    profile_->add(p);
+}
+
+GllsProfile::GllsProfile()
+{
+}
+
+void GllsProfile::setActive(GllsProfile *p)
+{
+    active_ = p;
+}
+
+void GllsProfile::add(const Phase &p)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = std::find_if(phases_.begin(), phases_.end(),
+            [&p](const Phase &q) { return q.name == p.name; });
+    if (it == phases_.end()) {
+        phases_.push_back(p);
+        return;
+    }
+    it->calls += p.calls;
+    it->wallSeconds += p.wallSeconds;
+    it->cpuSeconds += p.cpuSeconds;
+    it->allocatedBytes += p.allocatedBytes;
+    it->allocations += p.allocations;
+    it->peakRss = std::max(it->peakRss, p.peakRss);
+    it->rows += p.rows;
+    it->bytes += p.bytes;
+    it->flops += p.flops;
+    for (int c = 0; c < COUNTERS; ++c) {
+        it->counters[c] += p.counters[c];
+    }
+}
+
+std::vector<GllsProfile::Phase> GllsProfile::phases() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return phases_;
+}
+
+void GllsProfile::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    phases_.clear();
+}
+
+static double perSecond(double n, double seconds)
+{
+    return seconds > 0 ? n / seconds : 0.0;
+}
+
+//! a column of millions of events, or "-" if the event is not counted
+static void writeMillions(
+        std::ostream &os, int width, const GllsProfile::Phase &p,
+        GllsProfile::Counter c)
+{
+    os << std::setw(width);
+    if (GllsProfile::hasCounter(c)) {
+        os << p.counters[c] / 1e6;
+    } else {
+        os << "-";
+    }
+}
+
+//! a column of the ratio of two events, or "-" if unknown
+static void writeRatio(
+        std::ostream &os, int width, const GllsProfile::Phase &p,
+        GllsProfile::Counter num, GllsProfile::Counter den, double scale)
+{
+    os << std::setw(width);
+    if (GllsProfile::hasCounter(num) && GllsProfile::hasCounter(den)
+            && p.counters[den] > 0) {
+        os << scale * p.counters[num] / p.counters[den];
+    } else {
+        os << "-";
+    }
+}
+
+static void writeCounters(
+        std::ostream &os, const std::vector<GllsProfile::Phase> &phases)
+{
+    typedef GllsProfile G;
+    os << '\n' << std::left << std::setw(18) << "phase" << std::right
+       << std::setw(11) << "Mcycles" << std::setw(11) << "Minstr"
+       << std::setw(7) << "IPC" << std::setw(10) << "LLC Mref"
+       << std::setw(8) << "miss %" << std::setw(10) << "Mbrmiss"
+       << std::setw(9) << "mem GB/s" << std::setw(9) << "GFLOP/s"
+       << std::setw(8) << "flop/B" << '\n';
+    for (const auto &p : phases) {
+        const double memBytes = p.counters[G::CACHE_MISSES] * CACHE_LINE;
+        os << std::left << std::setw(18) << p.name << std::right
+           << std::setprecision(1);
+        writeMillions(os, 11, p, G::CYCLES);
+        writeMillions(os, 11, p, G::INSTRUCTIONS);
+        os << std::setprecision(2);
+        writeRatio(os, 7, p, G::INSTRUCTIONS, G::CYCLES, 1);
+        os << std::setprecision(1);
+        writeMillions(os, 10, p, G::CACHE_REFERENCES);
+        writeRatio(os, 8, p, G::CACHE_MISSES, G::CACHE_REFERENCES, 100);
+        writeMillions(os, 10, p, G::BRANCH_MISSES);
+        os << std::setprecision(2) << std::setw(9);
+        if (G::hasCounter(G::CACHE_MISSES)) {
+            os << perSecond(memBytes / 1e9, p.wallSeconds);
+        } else {
+            os << "-";
+        }
+        os << std::setw(9);
+        if (p.flops) {
+            os << perSecond(p.flops / 1e9, p.wallSeconds);
+        } else {
+            os << "-";
+        }
+        os << std::setw(8);
+        if (p.flops && memBytes > 0) {
+            os << p.flops / memBytes;
+        } else {
+            os << "-";
+        }
+        os << '\n';
+    }
+}
+
+void GllsProfile::writeText(std::ostream &os) const
+{
+    const bool allocs = countingAllocations_;
+    const auto flags = os.flags();
+    os << std::left << std::setw(18) << "phase" << std::right
+       << std::setw(7) << "calls" << std::setw(11) << "wall ms"
+       << std::setw(11) << "cpu ms" << std::setw(11) << "alloc MB"
+       << std::setw(10) << "allocs" << std::setw(10) << "RSS MB"
+       << std::setw(11) << "rows" << std::setw(12) << "rows/s"
+       << std::setw(9) << "MB/s" << '\n'
+       << std::fixed;
+    for (const auto &p : phases()) {
+        os << std::left << std::setw(18) << p.name << std::right
+           << std::setw(7) << p.calls
+           << std::setprecision(2)
+           << std::setw(11) << p.wallSeconds * 1e3
+           << std::setw(11) << p.cpuSeconds * 1e3;
+        if (allocs) {
+            os << std::setw(11) << p.allocatedBytes / 1e6
+               << std::setw(10) << p.allocations;
+        } else {
+            os << std::setw(11) << "-" << std::setw(10) << "-";
+        }
+        os << std::setprecision(1) << std::setw(10) << p.peakRss / 1e6
+           << std::setw(11) << p.rows
+           << std::setprecision(0)
+           << std::setw(12) << perSecond(p.rows, p.wallSeconds)
+           << std::setprecision(1) << std::setw(9);
+        if (p.bytes) {
+            os << perSecond(p.bytes / 1e6, p.wallSeconds) << '\n';
+        } else {
+            os << "-" << '\n';
+        }
+    }
+    if (countingHardware_) {
+        writeCounters(os, phases());
+    }
+    os.flags(flags);
+}
+
+//! the counted events and the derived figures as members of an object
+static void writeCountersJson(std::ostream &os, const GllsProfile::Phase &p)
+{
+    typedef GllsProfile G;
+    const char *const names[G::COUNTERS] = {"cycles", "instructions",
+            "cache_references", "cache_misses", "branch_misses"};
+    for (int c = 0; c < G::COUNTERS; ++c) {
+        if (G::hasCounter(static_cast<G::Counter>(c))) {
+            os << ", \"" << names[c] << "\": " << p.counters[c];
+        }
+    }
+    if (G::hasCounter(G::CYCLES) && G::hasCounter(G::INSTRUCTIONS)
+            && p.counters[G::CYCLES] > 0) {
+        os << ", \"ipc\": "
+           << double(p.counters[G::INSTRUCTIONS]) / p.counters[G::CYCLES];
+    }
+    if (G::hasCounter(G::CACHE_MISSES)) {
+        os << ", \"mem_gb_per_s\": " << perSecond(
+                p.counters[G::CACHE_MISSES] * CACHE_LINE / 1e9, p.wallSeconds);
+    }
+}
+
+void GllsProfile::writeJson(std::ostream &os) const
+{
+    const bool allocs = countingAllocations_;
+    const auto precision = os.precision(9);
+    os << "{\"phases\": [";
+    bool first = true;
+    for (const auto &p : phases()) {
+        os << (first ? "" : ",") << "\n  {\"name\": \"" << p.name << '"'
+           << ", \"calls\": " << p.calls
+           << ", \"wall_s\": " << p.wallSeconds
+           << ", \"cpu_s\": " << p.cpuSeconds;
+        if (allocs) {
+            os << ", \"alloc_bytes\": " << p.allocatedBytes
+               << ", \"allocations\": " << p.allocations;
+        }
+        os << ", \"peak_rss_bytes\": " << p.peakRss
+           << ", \"rows\": " << p.rows
+           << ", \"bytes\": " << p.bytes
+           << ", \"rows_per_s\": " << perSecond(p.rows, p.wallSeconds)
+           << ", \"mb_per_s\": " << perSecond(p.bytes / 1e6, p.wallSeconds);
+        if (p.flops) {
+            os << ", \"flops\": " << p.flops
+               << ", \"gflop_per_s\": "
+               << perSecond(p.flops / 1e9, p.wallSeconds);
+        }
+        if (countingHardware_) {
+            writeCountersJson(os, p);
+        }
+        os << '}';
+        first = false;
+    }
+    os << "\n]}\n";
+    os.precision(precision);
+}
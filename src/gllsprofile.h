@@ -0,0 +1,167 @@
+/**
+*   @file gllsprofile.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSPROFILE_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSPROFILE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+    @brief time, memory and counts of the phases of a run
+
+    The phases are readCoefWithCond, attachCond, arrangeX, arrangeY, gram,
+    factorize and substitute. While a profile is active, see setActive(),
+    every thread records the phases it runs into it, and repeated or
+    concurrent runs of a phase add up.
+
+    CPU time, allocations and peak RSS are of the whole process during a
+    phase, so they include the helper threads of a pooled phase. The
+    allocations are only counted if the program forwards its global
+    operator new to countAllocation(), e.g. by linking gllsalloc.cc as the
+    glls executable does.
+
+    With setCountingHardware(), the phases also count the hardware events of
+    Counter, from which the instructions per cycle and the memory bandwidth
+    of the last level cache misses are derived, e.g. to tell whether
+    arrangeY is bound by memory and the factorization by computation.
+*/
+class GllsProfile
+{
+public:
+    //! hardware events counted with setCountingHardware()
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_REFERENCES,
+        //! misses of the last level cache, i.e. lines loaded from memory
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTERS
+    };
+
+    struct Phase
+    {
+        std::string name;
+        //! number of times the phase was run
+        std::uint64_t calls;
+        double wallSeconds;
+        double cpuSeconds;
+        std::uint64_t allocatedBytes;
+        std::uint64_t allocations;
+        //! the largest RSS of the process at the end of a run of the phase
+        std::size_t peakRss;
+        //! rows of M parsed, conditions parsed, or rows of the problem
+        std::uint64_t rows;
+        //! bytes of input, if known
+        std::uint64_t bytes;
+        //! nominal floating point operations, 0 if unknown
+        std::uint64_t flops;
+        //! the events of Counter, 0 if not counted, see hasCounter()
+        std::uint64_t counters[COUNTERS];
+    };
+
+    /**
+        @brief the scope of a run of a phase, costs one atomic load if no
+               profile is active
+    */
+    class Span
+    {
+    public:
+        explicit Span(const char *phase)
+            : profile_(active()), phase_(phase), rows_(0), bytes_(0),
+              flops_(0)
+        {
+            if (profile_) {
+                begin();
+            }
+        }
+        ~Span()
+        {
+            if (profile_) {
+                end();
+            }
+        }
+        void addRows(std::uint64_t n) { rows_ += n; }
+        void addBytes(std::uint64_t n) { bytes_ += n; }
+        void addFlops(std::uint64_t n) { flops_ += n; }
+    private:
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+        void begin();
+        void end();
+        GllsProfile *const profile_;
+        const char *const phase_;
+        std::uint64_t rows_;
+        std::uint64_t bytes_;
+        std::uint64_t flops_;
+        std::chrono::steady_clock::time_point wall_;
+        std::clock_t cpu_;
+        std::uint64_t startBytes_;
+        std::uint64_t startAllocations_;
+        std::uint64_t startCounters_[COUNTERS];
+    };
+
+    GllsProfile();
+    //! record the phases of all threads into `p` from now on, nullptr to stop
+    static void setActive(GllsProfile *p);
+    static GllsProfile *active()
+        { return active_.load(std::memory_order_relaxed); }
+    //! to be called by a replacement of the global operator new
+    static void countAllocation(std::size_t bytes)
+    {
+        if (active()) {
+            allocatedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+            allocations_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    //! whether countAllocation() is called, i.e. allocations are reported
+    static void setCountingAllocations(bool on) { countingAllocations_ = on; }
+    //! the allocations counted while any profile was active
+    static std::uint64_t allocations() { return allocations_.load(); }
+    /**
+        @brief count the events of Counter with perf_event_open() (Linux)
+               from now on, or stop counting
+
+        The events of the calling thread and of the threads it starts
+        afterwards are counted, so a pool is to be created afterwards. Not
+        to be called while a phase runs.
+
+        @return whether any event is counted, which needs a hardware PMU
+            and a perf_event_paranoid setting allowing it
+    */
+    static bool setCountingHardware(bool on);
+    static bool hasCounter(Counter c);
+    //! the phases in the order of their first run
+    std::vector<Phase> phases() const;
+    void clear();
+    /**
+        @brief a table of the phases with the rows/s and MB/s of the wall
+               time, and one of the counted events with IPC, GB/s of the
+               cache misses and GFLOP/s
+    */
+    void writeText(std::ostream &) const;
+    //! a JSON object with a "phases" array, see readme.md
+    void writeJson(std::ostream &) const;
+private:
+    GllsProfile(const GllsProfile &) = delete;
+    GllsProfile &operator=(const GllsProfile &) = delete;
+    void add(const Phase &);
+    mutable std::mutex mutex_;
+    std::vector<Phase> phases_;
+    static std::atomic<GllsProfile *> active_;
+    static std::atomic<std::uint64_t> allocatedBytes_;
+    static std::atomic<std::uint64_t> allocations_;
+    static std::atomic<bool> countingAllocations_;
+    static std::atomic<bool> countingHardware_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSPROFILE_H_
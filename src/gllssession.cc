@@ -0,0 +1,189 @@
+#include "gllssession.h"
+#include "gllscache.h"
+#include "gllsparser.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+//! @return whether the coefficients of two arranged problems are equal
+bool sameCoefficients(const GllsProblem &a, const GllsProblem &b)
+{
+    if (a.xSize != b.xSize || a.coef.size() != b.coef.size()
+            || a.reservedX.size() != b.reservedX.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.reservedX.size(); ++i) {
+        if (a.reservedX[i].first != b.reservedX[i].first) {
+            return false;
+        }
+    }
+    const std::size_t cols = a.xSize + 1;
+    for (std::size_t i = 0; i < a.coef.size(); ++i) {
+        if (i % cols != cols - 1 && a.coef[i] != b.coef[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+    Split [begin, end) into effective lines like nextLine(): comments are
+    removed, the end is trimmed and empty lines are skipped.
+
+    @param f callable as f(const std::string &line, int lineNumber)
+*/
+template<class F> void forEachLine(
+        const char *begin, const char *end, int firstLine, F &&f)
+{
+    int line = firstLine;
+    while (begin < end) {
+        const char *eol = std::find(begin, end, '\n');
+        const char *stop = std::find(begin, eol, '#');
+        while (stop != begin && std::isspace(static_cast<unsigned char>(stop[-1]))) {
+            --stop;
+        }
+        if (std::any_of(begin, stop,
+                [](char c) { return !std::isspace(static_cast<unsigned char>(c)); })) {
+            f(std::string(begin, stop), line);
+        }
+        begin = eol + 1;
+        ++line;
+    }
+}
+
+} // namespace
+
+GllsSession::GllsSession()
+    : coefHash_(0), coefLength_(0), hasFactors_(false),
+      parsedLines_(0), reused_(false)
+{
+}
+
+GllsSession::~GllsSession()
+{
+}
+
+void GllsSession::update(const std::string &text)
+{
+    const std::size_t split = GllsCache::condOffset(text);
+    const auto hash = GllsCache::hash(text.data(), split);
+    const int firstLine = 1 + static_cast<int>(
+            std::count(text.cbegin(), text.cbegin() + split, '\n'));
+    if (parser_ && hash == coefHash_ && split == coefLength_) {
+        updateConditions(text.substr(split), firstLine);
+        return;
+    }
+    std::unique_ptr<std::istringstream> stream(
+            new std::istringstream(text.substr(0, split)));
+    std::unique_ptr<GllsParser> parser(new GllsParser(*stream, true));
+    parser->setConditionsRequired(false);
+    GllsProblem g = parser->run();
+    std::unordered_map<std::string, Line> none;
+    Conditions c = parseConditions(
+            *parser, none, text.substr(split), firstLine);
+    stream_ = std::move(stream);
+    parser_ = std::move(parser);
+    problem_ = std::move(g);
+    coefHash_ = hash;
+    coefLength_ = split;
+    hasFactors_ = false;
+    commit(c);
+}
+
+void GllsSession::updateConditions(const std::string &text, int firstLine)
+{
+    assert(parser_);
+    Conditions c = parseConditions(*parser_, lines_, text, firstLine);
+    commit(c);
+}
+
+/**
+    Lines found in `cache` are moved into the result, and moved back if a
+    line fails to parse.
+*/
+GllsSession::Conditions GllsSession::parseConditions(
+        const GllsParser &parser,
+        std::unordered_map<std::string, Line> &cache,
+        const std::string &text,
+        int firstLine
+)
+{
+    Conditions c;
+    c.parsed = 0;
+    try {
+        forEachLine(text.data(), text.data() + text.size(), firstLine,
+                [&](const std::string &s, int line) {
+            auto it = c.lines.find(s);
+            if (it == c.lines.end()) {
+                const auto old = cache.find(s);
+                if (old != cache.end()) {
+                    it = c.lines.emplace(s, std::move(old->second)).first;
+                    cache.erase(old);
+                } else {
+                    Line l;
+                    parser.parseCondition(s, line, l.ys, l.xs);
+                    ++c.parsed;
+                    it = c.lines.emplace(s, std::move(l)).first;
+                }
+            }
+            // a cached line may have moved
+            c.ys.append(it->second.ys, line);
+            c.xs.insert(c.xs.end(),
+                    it->second.xs.cbegin(), it->second.xs.cend());
+        });
+    } catch (...) {
+        for (auto &l : c.lines) {
+            cache.emplace(l.first, std::move(l.second));
+        }
+        throw;
+    }
+    return c;
+}
+
+void GllsSession::commit(Conditions &c)
+{
+    lines_ = std::move(c.lines);
+    yConds_ = std::move(c.ys);
+    xValues_ = std::move(c.xs);
+    parsedLines_ = c.parsed;
+}
+
+std::size_t GllsSession::memoryUsage() const
+{
+    const auto conditionSize = [](const ConditionSet &cs) {
+        return cs.ids().size() * (sizeof(int) + sizeof(double))
+            + cs.familyIds().size() * (2*sizeof(int) + sizeof(double))
+            + (cs.size() + cs.familyConstants().size()) * 2 * sizeof(double);
+    };
+    std::size_t n = sizeof(*this);
+    n += (problem_.coef.size() + arranged_.coef.size()
+            + factors_.lu.size()) * sizeof(double);
+    n += conditionSize(yConds_);
+    for (const auto &l : lines_) {
+        n += l.first.size() + conditionSize(l.second.ys)
+            + l.second.xs.size() * sizeof(l.second.xs[0]);
+    }
+    return n;
+}
+
+std::vector<double> GllsSession::solve()
+{
+    assert(parser_);
+    if (yConds_.empty()) {
+        throw std::invalid_argument("no condition on the Y variables");
+    }
+    GllsProblem g = problem_;
+    arrangeX(g, xValues_);
+    arrangeY(g, yConds_);
+    reused_ = hasFactors_ && sameCoefficients(g, arranged_);
+    if (!reused_) {
+        factors_ = factorize(g);
+        hasFactors_ = true;
+    }
+    arranged_ = std::move(g);
+    return substitute(factors_, arranged_);
+}
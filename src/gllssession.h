@@ -0,0 +1,110 @@
+/**
+*   @file gllssession.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSSESSION_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSSESSION_H_
+
+#include "conditionset.h"
+#include "solveglls.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class GllsParser;
+
+/**
+    @brief an input kept in memory for repeated solving after edits
+
+    The parsed matrix and names stay in memory between updates. Condition
+    lines are parsed once per distinct text, so an update only parses the
+    lines which changed. If the arranged coefficients are equal to the
+    previous ones, i.e. only constants changed, the factorization is
+    reused and solve() only substitutes.
+*/
+class GllsSession
+{
+public:
+    GllsSession();
+    ~GllsSession();
+    /**
+        @brief take a complete input, see readme.md
+
+        The matrix is parsed again only if the coefficient section (up to
+        the first condition line) changed. The input may end after the
+        coefficients, see updateConditions(). On a ParserError the session
+        keeps its previous state.
+
+        @throw ParserError
+    */
+    void update(const std::string &text);
+    /**
+        @brief replace the condition lines, keeping the matrix
+
+        @param firstLine the line number of the first line of `text`
+        @throw ParserError, the session keeps its previous state then
+    */
+    void updateConditions(const std::string &text, int firstLine);
+    //! @return whether a matrix is loaded
+    bool loaded() const { return static_cast<bool>(parser_); }
+    /**
+        @return a full length `x` vector for the current conditions
+        @throw std::invalid_argument if there is no condition on Y
+    */
+    std::vector<double> solve();
+    //! @return approximate number of bytes held by the session
+    std::size_t memoryUsage() const;
+    //! @return the problem solved by the last solve(), after arrangeY()
+    const GllsProblem &arranged() const { return arranged_; }
+    const std::vector<std::pair<int, double> > &xValues() const
+        { return xValues_; }
+    const ConditionSet &yConds() const { return yConds_; }
+    const GllsParser &parser() const { return *parser_; }
+    //! number of condition lines parsed by the last update
+    std::size_t parsedLines() const { return parsedLines_; }
+    //! whether the last solve() reused the factorization
+    bool reusedFactorization() const { return reused_; }
+private:
+    GllsSession(const GllsSession &) = delete;
+    GllsSession &operator=(const GllsSession &) = delete;
+    struct Line
+    {
+        ConditionSet ys;
+        std::vector<std::pair<int, double> > xs;
+    };
+    struct Conditions
+    {
+        std::unordered_map<std::string, Line> lines;
+        ConditionSet ys;
+        std::vector<std::pair<int, double> > xs;
+        std::size_t parsed;
+    };
+    static Conditions parseConditions(
+            const GllsParser &,
+            std::unordered_map<std::string, Line> &cache,
+            const std::string &text,
+            int firstLine
+    );
+    void commit(Conditions &);
+    std::uint64_t coefHash_;
+    std::uint64_t coefLength_;
+    //! header and matrix read by parser_, which refers to the stream
+    std::unique_ptr<std::istringstream> stream_;
+    std::unique_ptr<GllsParser> parser_;
+    GllsProblem problem_;
+    //! parsed condition lines by their text
+    std::unordered_map<std::string, Line> lines_;
+    std::vector<std::pair<int, double> > xValues_;
+    ConditionSet yConds_;
+    GllsProblem arranged_;
+    GllsFactorization factors_;
+    bool hasFactors_;
+    std::size_t parsedLines_;
+    bool reused_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSSESSION_H_
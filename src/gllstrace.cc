@@ -0,0 +1,105 @@
+#include "gllstrace.h"
+
+#include <ostream>
+
+std::atomic<GllsTrace *> GllsTrace::active_(nullptr);
+
+namespace {
+
+std::atomic<std::uint64_t> nextSerial(1);
+std::atomic<int> nextTid(1);
+
+//! the buffer of the calling thread in the trace of `serial`
+struct CachedBuffer
+{
+    std::uint64_t serial;
+    void *buffer;
+};
+
+thread_local CachedBuffer cached = {0, nullptr};
+thread_local int tid = 0;
+
+} // namespace
+
+GllsTrace::GllsTrace()
+    : serial_(nextSerial++), origin_(std::chrono::steady_clock::now())
+{
+}
+
+GllsTrace::~GllsTrace()
+{
+    GllsTrace *self = this;
+    active_.compare_exchange_strong(self, nullptr);
+}
+
+void GllsTrace::setActive(GllsTrace *t)
+{
+    active_ = t;
+}
+
+GllsTrace::ThreadBuffer *GllsTrace::buffer()
+{
+    if (cached.serial == serial_) {
+        return static_cast<ThreadBuffer *>(cached.buffer);
+    }
+    if (!tid) {
+        tid = nextTid++;
+    }
+    std::unique_ptr<ThreadBuffer> b(new ThreadBuffer);
+    b->tid = tid;
+    ThreadBuffer *const p = b.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_.push_back(std::move(b));
+    }
+    cached.serial = serial_;
+    cached.buffer = p;
+    return p;
+}
+
+void GllsTrace::record(const Span &s)
+{
+    const auto end = std::chrono::steady_clock::now();
+    typedef std::chrono::duration<double, std::micro> Micro;
+    buffer()->events.push_back(Event{s.name_, s.argName_, s.arg_,
+            Micro(s.start_ - origin_).count(), Micro(end - s.start_).count()});
+}
+
+std::size_t GllsTrace::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t n = 0;
+    for (const auto &b : buffers_) {
+        n += b->events.size();
+    }
+    return n;
+}
+
+void GllsTrace::writeJson(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto precision = os.precision(3);
+    const auto flags = os.flags();
+    os << std::fixed << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto &b : buffers_) {
+        os << (first ? "" : ",")
+           << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+              "\"tid\": " << b->tid
+           << ", \"args\": {\"name\": \"thread " << b->tid << "\"}}";
+        first = false;
+        for (const auto &e : b->events) {
+            os << ",\n{\"name\": \"" << e.name
+               << "\", \"cat\": \"glls\", \"ph\": \"X\", \"pid\": 1, "
+                  "\"tid\": " << b->tid
+               << ", \"ts\": " << e.start << ", \"dur\": " << e.duration;
+            if (e.argName) {
+                os << ", \"args\": {\"" << e.argName << "\": " << e.arg << '}';
+            }
+            os << '}';
+        }
+    }
+    os << "\n]}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,101 @@
+/**
+*   @file gllstrace.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSTRACE_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSTRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+    @brief spans of the work of every thread in the Chrome trace event
+           format, e.g. for Perfetto or chrome://tracing
+
+    While a trace is active, see setActive(), every Span is recorded into
+    a buffer of its thread, without locking. The spans are the batches of
+    lines read with nextLine(), the condition batches and the calls of
+    CondParser::parse(), the chunks of arrangeY() and of the normal matrix,
+    and the LU factorization.
+*/
+class GllsTrace
+{
+public:
+    //! a span, costs one atomic load if no trace is active
+    class Span
+    {
+    public:
+        //! @param name a string literal, as the name is not copied
+        explicit Span(const char *name) : Span(name, nullptr, 0) {}
+        //! with one integer argument, e.g. the first row of a chunk
+        Span(const char *name, const char *argName, std::int64_t arg)
+            : trace_(active()), name_(name), argName_(argName), arg_(arg)
+        {
+            if (trace_) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+        ~Span()
+        {
+            if (trace_) {
+                trace_->record(*this);
+            }
+        }
+        void setArg(std::int64_t arg) { arg_ = arg; }
+    private:
+        friend class GllsTrace;
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+        GllsTrace *const trace_;
+        const char *const name_;
+        const char *const argName_;
+        std::int64_t arg_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    GllsTrace();
+    ~GllsTrace();
+    //! record the spans of all threads into `t` from now on, nullptr to stop
+    static void setActive(GllsTrace *t);
+    static GllsTrace *active()
+        { return active_.load(std::memory_order_relaxed); }
+    //! number of recorded spans
+    std::size_t size() const;
+    /**
+        @brief write a JSON object with the "traceEvents" array
+
+        The traced work must have finished, e.g. the pool waited for.
+    */
+    void writeJson(std::ostream &) const;
+private:
+    GllsTrace(const GllsTrace &) = delete;
+    GllsTrace &operator=(const GllsTrace &) = delete;
+    struct Event
+    {
+        const char *name;
+        const char *argName;
+        std::int64_t arg;
+        //! microseconds since the construction of the trace
+        double start;
+        double duration;
+    };
+    struct ThreadBuffer
+    {
+        int tid;
+        std::vector<Event> events;
+    };
+    void record(const Span &);
+    ThreadBuffer *buffer();
+    //! distinguishes the traces for the cached buffers of the threads
+    const std::uint64_t serial_;
+    const std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer> > buffers_;
+    static std::atomic<GllsTrace *> active_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSTRACE_H_
@@ -1,10 +1,461 @@
-#include "glls.h"
+#include "batch.h"
+#include "gllscache.h"
+#include "gllsparser.h"
+#include "gllsprofile.h"
+#include "gllstrace.h"
 #include "parsercommon.h"
+#include "threadpool.h"
+#include "watch.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-int main() {
+static void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [-j threads] [-v] [--lazy] [--cache dir] [--profile f]"
+                 " [--counters]\n"
+              << "       " << std::string(std::strlen(prog), ' ')
+              << " [--trace f] < input\n"
+              << "       " << prog << " --sweep K=first:last:count"
+                 " [-j threads] [--lazy] < input\n"
+              << "       " << prog << " --loo|--kfold K"
+                 " [-j threads] [--lazy] < input\n"
+              << "       " << prog << " --stddev [-j threads] [--lazy]"
+                 " < input\n"
+              << "       " << prog << " --watch file\n"
+              << "       " << prog << " --batch [-j threads] [--delimiter d]"
+                 " [file ...]\n"
+              << "  -j N        parse the conditions with N threads, "
+                 "0 for all cores\n"
+              << "  -v          print the residual norms, the worst input line,"
+                 " the rank of the\n"
+              << "              factorized matrix and the condition estimate"
+                 " to stderr\n"
+              << "  --lazy      parse only the referenced coefficient rows, "
+                 "the input must be seekable\n"
+              << "  --profile F print the time, memory and counts of every "
+                 "phase to stderr,\n"
+              << "              as F = text or json\n"
+              << "  --counters  add the hardware counters of every phase to "
+                 "the profile\n"
+              << "  --trace F   write the spans of all threads to F in the "
+                 "Chrome trace format\n"
+              << "  --cache DIR reuse parsed problems and factorizations "
+                 "stored in DIR\n"
+              << "  --sweep S   solve for count values of X value K from "
+                 "first to last,\n"
+              << "              one line of X per value\n"
+              << "  --loo       print the leverage and the residual of every "
+                 "condition line\n"
+              << "              when left out to stderr\n"
+              << "  --kfold K   the same for K folds of the condition rows\n"
+              << "  --stddev    print the standard deviation of every X value "
+                 "to stderr\n"
+              << "  --watch F   solve F again whenever it is saved\n"
+              << "  --batch     solve the files, or the problems on stdin "
+                 "separated by\n"
+              << "              delimiter lines (default ---), with N "
+                 "threads\n";
+}
+
+static int batch(
+        const std::vector<std::string> &files,
+        const std::string &delimiter,
+        unsigned threads
+)
+{
+    std::vector<std::string> problems;
+    if (files.empty()) {
+        problems = splitProblems(std::cin, delimiter);
+    }
+    const auto input = [&](std::size_t i) -> std::string {
+        if (files.empty()) {
+            return std::move(problems[i]);
+        }
+        std::ifstream is(files[i], std::ios::binary);
+        if (!is) {
+            throw std::runtime_error("failed to open " + files[i]);
+        }
+        return std::string(
+                (std::istreambuf_iterator<char>(is)),
+                std::istreambuf_iterator<char>());
+    };
+    const auto emit = [&](std::size_t i, const BatchResult &r) {
+        if (!r.error.empty()) {
+            std::cerr << (files.empty()
+                    ? "problem " + std::to_string(i+1) : files[i])
+                      << ": " << r.error << '\n';
+        }
+        for (const auto x : r.x) {
+            std::cout << x << ' ';
+        }
+        std::cout << '\n';
+    };
+    ThreadPool pool(threads);
+    solveBatch(files.empty() ? problems.size() : files.size(),
+            input, pool, emit);
+    return 0;
+}
+
+/**
+    solve the condition blocks of stdin, one labeled line per block, and
+    with `verbose` the diagnostics on stderr
+*/
+static int blocks(unsigned threads, bool lazy, bool verbose)
+{
+    ThreadPool pool(threads);
+    for (const auto &r : solveBlocks(std::cin, pool, lazy, verbose)) {
+        const std::string label = r.name.empty() ? "" : r.name + ": ";
+        if (!r.error.empty()) {
+            std::cerr << label << r.error << '\n';
+        } else if (verbose) {
+            const auto &d = r.diagnostics;
+            std::cerr << label << "residual 2-norm " << d.norm2
+                      << ", max-norm " << d.normInf
+                      << " on input line " << r.worstLine
+                      << ", factorized rank " << d.rank
+                      << ", condition ~" << d.conditionEstimate << '\n';
+        }
+        if (!r.name.empty()) {
+            std::cout << r.name << ": ";
+        }
+        for (const auto x : r.x) {
+            std::cout << x << ' ';
+        }
+        std::cout << '\n';
+    }
+    return 0;
+}
+
+//! @return whether `s` is a whole non-negative decimal number
+static bool parseCount(const char *s, unsigned &n)
+{
+    if (!std::isdigit(static_cast<unsigned char>(*s))) {
+        return false;
+    }
+    char *end;
+    errno = 0;
+    const unsigned long v = std::strtoul(s, &end, 10);
+    if (*end != '\0' || errno == ERANGE
+            || v > std::numeric_limits<unsigned>::max()) {
+        return false;
+    }
+    n = static_cast<unsigned>(v);
+    return true;
+}
+
+/**
+    parse `K=first:last:count`, K optionally prefixed with a name, into the
+    index and the evenly spaced values
+    @return false if malformed
+*/
+static bool parseSweep(
+        const std::string &spec, int &index, std::vector<double> &values)
+{
+    std::size_t i = 0;
+    while (i < spec.size() && std::isalpha(static_cast<unsigned char>(spec[i]))) {
+        ++i;
+    }
+    double first, last;
+    int count;
+    char eq, c1, c2;
+    std::istringstream ss(spec.substr(i));
+    if (!(ss >> index >> eq >> first >> c1 >> last >> c2 >> count)
+            || eq != '=' || c1 != ':' || c2 != ':' || count < 1
+            || ss.peek() != std::char_traits<char>::eof()) {
+        return false;
+    }
+    values.resize(count);
+    for (int k = 0; k < count; ++k) {
+        values[k] = count == 1 ? first : first + (last - first) * k / (count - 1);
+    }
+    return true;
+}
+
+/**
+    solve stdin for every value of X value `index`, factorized once, and
+    print a table with a header of the X names and one line per value
+*/
+static int sweep(
+        unsigned threads, bool lazy, int index,
+        const std::vector<double> &values)
+{
+    ThreadPool pool(threads);
+    try {
+        GllsParser gp(std::cin, true);
+        gp.setPool(&pool);
+        gp.setLazy(lazy);
+        GllsProblem g = gp.run();
+        // the swept value replaces one set by the input
+        auto xs = gp.xValues();
+        xs.erase(std::remove_if(xs.begin(), xs.end(),
+                [index](const std::pair<int, double> &x)
+                    { return x.first == index; }),
+                xs.end());
+        arrangeX(g, xs);
+        arrangeY(g, gp.yConds(), &pool);
+        const auto table = sweepX(g, index, values, &pool);
+        for (int i = 0; i < gp.xVarSize(); ++i) {
+            std::cout << gp.xVarName() << i << (i+1 < gp.xVarSize() ? ' ' : '\n');
+        }
+        for (const auto &x : table) {
+            for (const auto v : x) {
+                std::cout << v << ' ';
+            }
+            std::cout << '\n';
+        }
+    } catch (ParserError &e) {
+        std::cerr << "Error on input line " << e.line() << ": " << e.what()
+                  << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+    solve stdin, and print to stderr the residuals of every condition line
+    in the fit without it, or without its fold for `folds` > 0
+*/
+static int crossValidation(unsigned threads, bool lazy, std::size_t folds)
+{
+    ThreadPool pool(threads);
+    try {
+        GllsParser gp(std::cin, true);
+        gp.setPool(&pool);
+        gp.setLazy(lazy);
+        GllsProblem g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds(), &pool);
+        const auto f = factorize(g, &pool);
+        const auto &ys = gp.yConds();
+        const auto cv = crossValidate(f, g, folds
+                ? foldGroups(ys.expandedSize(), folds) : lineGroups(ys),
+                &pool);
+        for (const auto x : substitute(f, g)) {
+            std::cout << x << ' ';
+        }
+        std::cout << '\n';
+        const auto fit = residualByLine(cv.residual, ys);
+        const auto left = residualByLine(cv.left, ys);
+        std::cerr << "line leverage residual left-out\n";
+        std::size_t row = 0;
+        for (std::size_t i = 0; i < fit.size(); ++i) {
+            // the largest leverage of the rows of the line
+            double leverage = 0.0;
+            for (; row < cv.leverage.size() && ys.lineOf(row) == fit[i].first;
+                    ++row) {
+                leverage = std::max(leverage, cv.leverage[row]);
+            }
+            std::cerr << fit[i].first << ' ' << leverage << ' '
+                      << fit[i].second << ' ' << left[i].second << '\n';
+        }
+        std::cerr << "PRESS " << cv.press << ", RMS "
+                  << std::sqrt(cv.press / cv.left.size()) << std::endl;
+    } catch (ParserError &e) {
+        std::cerr << "Error on input line " << e.line() << ": " << e.what()
+                  << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+    solve stdin, and print to stderr the standard deviations of X from the
+    diagonal of its covariance
+*/
+static int standardDeviations(unsigned threads, bool lazy)
+{
+    ThreadPool pool(threads);
+    try {
+        GllsParser gp(std::cin, true);
+        gp.setPool(&pool);
+        gp.setLazy(lazy);
+        GllsProblem g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds(), &pool);
+        GllsCovariance cov;
+        for (const auto x : solve(g, cov, {}, &pool, true)) {
+            std::cout << x << ' ';
+        }
+        std::cout << '\n';
+        for (const auto d : cov.diagonal) {
+            std::cerr << std::sqrt(cov.sigma2 * d) << ' ';
+        }
+        std::cerr << '\n';
+    } catch (ParserError &e) {
+        std::cerr << "Error on input line " << e.line() << ": " << e.what()
+                  << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+//! writes the trace of the run to a file when it ends
+class TraceReport
+{
+public:
+    explicit TraceReport(const std::string &path) : path_(path)
+    {
+        if (!path_.empty()) {
+            GllsTrace::setActive(&trace_);
+        }
+    }
+    ~TraceReport()
+    {
+        if (path_.empty()) {
+            return;
+        }
+        GllsTrace::setActive(nullptr);
+        std::ofstream os(path_);
+        trace_.writeJson(os);
+        if (!os) {
+            std::cerr << "failed to write " << path_ << std::endl;
+        }
+    }
+private:
+    const std::string path_;
+    GllsTrace trace_;
+};
+
+//! writes the profile of the run to stderr when it ends
+class ProfileReport
+{
+public:
+    ProfileReport(const std::string &format, bool counters)
+        : format_(format)
+    {
+        if (format_.empty()) {
+            return;
+        }
+        if (counters && !GllsProfile::setCountingHardware(true)) {
+            std::cerr << "hardware counters are not available" << std::endl;
+        }
+        GllsProfile::setActive(&profile_);
+    }
+    ~ProfileReport()
+    {
+        if (format_.empty()) {
+            return;
+        }
+        GllsProfile::setActive(nullptr);
+        if (format_ == "json") {
+            profile_.writeJson(std::cerr);
+        } else {
+            profile_.writeText(std::cerr);
+        }
+        GllsProfile::setCountingHardware(false);
+    }
+private:
+    const std::string format_;
+    GllsProfile profile_;
+};
+
+int main(int argc, char *argv[]) {
+    unsigned threads = 1;
+    bool lazy = false;
+    bool isBatch = false;
+    bool verbose = false;
+    std::string cacheDir;
+    std::string profileFormat;
+    bool counters = false;
+    std::string tracePath;
+    std::string watchPath;
+    int sweepIndex = -1;
+    bool crossValidating = false;
+    bool stddev = false;
+    unsigned folds = 0;
+    std::vector<double> sweepValues;
+    std::string delimiter = "---";
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-j") == 0 && i+1 < argc
+                && parseCount(argv[i+1], threads)) {
+            ++i;
+        } else if (std::strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (std::strcmp(argv[i], "--lazy") == 0) {
+            lazy = true;
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i+1 < argc
+                && (std::strcmp(argv[i+1], "text") == 0
+                    || std::strcmp(argv[i+1], "json") == 0)) {
+            profileFormat = argv[++i];
+        } else if (std::strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i+1 < argc) {
+            cacheDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--sweep") == 0 && i+1 < argc
+                && parseSweep(argv[i+1], sweepIndex, sweepValues)) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--stddev") == 0) {
+            stddev = true;
+        } else if (std::strcmp(argv[i], "--loo") == 0) {
+            crossValidating = true;
+        } else if (std::strcmp(argv[i], "--kfold") == 0 && i+1 < argc
+                && parseCount(argv[i+1], folds) && folds > 0) {
+            crossValidating = true;
+            ++i;
+        } else if (std::strcmp(argv[i], "--watch") == 0 && i+1 < argc) {
+            watchPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--batch") == 0) {
+            isBatch = true;
+        } else if (std::strcmp(argv[i], "--delimiter") == 0 && i+1 < argc) {
+            delimiter = argv[++i];
+        } else if (isBatch && argv[i][0] != '-') {
+            files.push_back(argv[i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (counters && profileFormat.empty()) {
+        profileFormat = "text";
+    }
+    const ProfileReport report(profileFormat, counters);
+    const TraceReport trace(tracePath);
+    if (!watchPath.empty()) {
+        return watchInput(watchPath, std::cout, std::cerr);
+    }
+    if (isBatch) {
+        return batch(files, delimiter, threads);
+    }
+    if (sweepIndex >= 0) {
+        return sweep(threads, lazy, sweepIndex, sweepValues);
+    }
+    if (crossValidating) {
+        return crossValidation(threads, lazy, folds);
+    }
+    if (stddev) {
+        return standardDeviations(threads, lazy);
+    }
     try {
-        for (const auto x : glls(std::cin)) {
+        if (cacheDir.empty()) {
+            return blocks(threads, lazy, verbose);
+        }
+        GllsCache cache(cacheDir);
+        for (const auto x : cache.solve(std::cin, threads)) {
             std::cout << x << ' ';
         }
     } catch (ParserError &e){
@@ -14,4 +465,4 @@ int main() {
     }
     std::cout << '\n';
     return 0;
-}
\ No newline at end of file
+}
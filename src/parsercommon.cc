@@ -6,6 +6,9 @@
 #include <algorithm>
 #include <functional>
 #include <cctype>
+#include <cstdint>
+#include <locale>
+#include <sstream>
 
 // for the compatibility with libstdc++ 4.8, no std::regex is used
 std::pair<int, std::string> nextLine(std::istream &stm)
@@ -37,6 +40,91 @@ std::pair<int, std::string> nextLine(std::istream &stm)
     return std::make_pair(counter, std::move(s));
 }
 
+static inline bool isDigit(char c)
+{
+    return static_cast<unsigned>(c - '0') < 10u;
+}
+
+const char *parseNumber(const char *p, const char *end, double &v)
+{
+    // exactly representable powers of ten
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22
+    };
+    const char *const begin = p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p == end || !isDigit(*p)) {
+        return begin;
+    }
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for (; p != end && isDigit(*p); ++p) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+            if (mantissa) {
+                ++digits;
+            }
+        } else {
+            ++digits;
+            ++exponent;
+        }
+    }
+    if (p != end && *p == '.') {
+        for (++p; p != end && isDigit(*p); ++p) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+                if (mantissa) {
+                    ++digits;
+                }
+                --exponent;
+            } else {
+                ++digits;
+            }
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool expNegative = false;
+        if (q != end && (*q == '-' || *q == '+')) {
+            expNegative = (*q == '-');
+            ++q;
+        }
+        if (q != end && isDigit(*q)) {
+            int e = 0;
+            for (; q != end && isDigit(*q); ++q) {
+                if (e < 100000) {
+                    e = e * 10 + (*q - '0');
+                }
+            }
+            exponent += expNegative ? -e : e;
+            p = q;
+        }
+    }
+    if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+        // both operands are exact, hence the result is correctly rounded
+        v = static_cast<double>(mantissa);
+        v = exponent < 0 ? v / pow10[-exponent] : v * pow10[exponent];
+    } else if (mantissa == 0) {
+        v = 0.0;
+    } else {
+        std::istringstream ss(std::string(begin, p));
+        ss.imbue(std::locale::classic());
+        ss >> v;
+        return p;
+    }
+    if (negative) {
+        v = -v;
+    }
+    return p;
+}
+
 const char *ParserError::what() const noexcept
 {
     return msg_.c_str();
@@ -19,6 +19,19 @@
 */
 std::pair<int, std::string> nextLine(std::istream &);
 
+/**
+*   @brief locale independent parsing of a decimal number
+*          `[-+]? [0-9]+ (\.[0-9]*)? ([eE][-+]?[0-9]+)?` at the beginning
+*          of [p, end)
+*
+*   An exponent marker without digits is not consumed. Numbers with at most
+*   15 significant digits and a moderate exponent are converted exactly
+*   without any allocation, others fall back to the standard library.
+*
+*   @return the pointer past the number, or p if there is no number
+*/
+const char *parseNumber(const char *p, const char *end, double &v);
+
 class ParserError : public std::exception
 {
 public:
@@ -1,7 +1,15 @@
 #include "solveglls.h"
 #include "condparser.h"
+#include "gllsprofile.h"
+#include "gllstrace.h"
+#include "threadpool.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
 #include <cassert>
 #include <utility>
 #include <vector>
@@ -23,6 +31,8 @@ void arrangeX(
     const int origCols = g.xSize + 1;
     const int cols = origCols - rxs.size();
     const int rows = g.coef.size()/origCols;
+    GllsProfile::Span span("arrangeX");
+    span.addRows(rows);
     std::vector<double> coef(rows*cols);
     g.reservedX.resize(rxs.size());
     auto xs = rxs;
@@ -58,80 +68,106 @@ void arrangeX(
     g.xSize -= g.reservedX.size();
 }
 
-void arrangeY(
-        GllsProblem &g,
-        const std::list<std::vector<std::pair<int, double> > > &ys
-)
+/**
+    One output row per expanded row of `ys` with xSize+1 columns. The first
+    `n` columns of a row of M are at rowAt(id), `step` elements apart, n is
+    xSize+1 with and xSize without a constant column.
+*/
+template<class RowAt> static void
+combineRows(const ConditionSet &ys, std::size_t first, std::size_t last,
+        int xSize, int n, RowAt rowAt, std::size_t step, double *c)
 {
-    assert(g.xSize > 0);
-    assert(g.coef.size() % (g.xSize+1) == 0);
-    assert(ys.size() > 0);
-    const int cols = g.xSize + 1;
-    const int rows = ys.size();
-    std::vector<double> coef;
-    coef.reserve(rows*cols);
-    for (const auto &eq : ys) {
-        std::vector<double> c(cols);
-        for (const auto &y : eq) {
-            if (y.first == CondDict::ID_CONST) {
-                c[cols-1] += y.second;
-            } else {
-                assert(y.first >= 0);
-                for (int i = 0; i < cols; ++i) {
-                    c[i] += y.second * g.coef[y.first*cols + i];
+    GllsTrace::Span span("arrangeY chunk", "first", first);
+    const int cols = xSize + 1;
+    std::vector<double> acc(n);
+    ys.forEachRow(first, last, [&](const ConditionSet::RowView &r) {
+        c[cols-1] = r.constant;
+        for (std::size_t k = 0; k < r.size; ++k) {
+            assert(r.ids[k] >= 0);
+            const double *const src = rowAt(r.ids[k]);
+            const double f = r.coefs[k];
+            for (int i = 0; i < n; ++i) {
+                c[i] += f * src[i*step];
+            }
+        }
+        // fused row sum, scaled once per range
+        for (std::size_t k = 0; k < r.rangeCount; ++k) {
+            const auto &range = r.ranges[k];
+            assert(range.first >= 0);
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int m = 0; m < range.count; ++m) {
+                const double *const src = rowAt(range.first + m * range.stride);
+                for (int i = 0; i < n; ++i) {
+                    acc[i] += src[i*step];
                 }
             }
+            for (int i = 0; i < n; ++i) {
+                c[i] += range.coef * acc[i];
+            }
         }
-        std::copy(c.cbegin(), c.cend(), std::back_inserter(coef));
-    }
-    g.coef = coef;
+        c += cols;
+    });
 }
 
-boost::numeric::ublas::vector<double>
-solveLeastSquare(
-        const boost::numeric::ublas::matrix<double> &m,
-        const boost::numeric::ublas::vector<double> &b
-    )
+//! number of output rows per task of combineRows()
+static const std::size_t ROW_CHUNK = 256;
+
+template<class RowAt> static std::vector<double>
+combineRows(const ConditionSet &ys, int xSize, int n, RowAt rowAt,
+        std::size_t step, ThreadPool *pool)
 {
-    using namespace boost::numeric::ublas;
-    const auto tm = trans(m);
-    vector<double> x = prod(tm, b);
-    matrix<double> a = prod(tm, m);
-    permutation_matrix<std::size_t> pm(a.size1());
-    lu_factorize(a, pm);
-    lu_substitute(a, pm, x);
-    return x;
+    assert(!ys.empty());
+    const std::size_t cols = xSize + 1;
+    const std::size_t rows = ys.expandedSize();
+    std::vector<double> coef(rows*cols);
+    if (!pool || rows <= ROW_CHUNK) {
+        combineRows(ys, 0, rows, xSize, n, rowAt, step, coef.data());
+        return coef;
+    }
+    pool->parallelFor((rows + ROW_CHUNK - 1) / ROW_CHUNK, [&](std::size_t i) {
+        const std::size_t first = i * ROW_CHUNK;
+        combineRows(ys, first, std::min(rows, first + ROW_CHUNK),
+                xSize, n, rowAt, step, coef.data() + first*cols);
+    });
+    return coef;
 }
 
-boost::numeric::ublas::vector<double>
-solveMinX2Norm(
-        const boost::numeric::ublas::matrix<double> &m,
-        const boost::numeric::ublas::vector<double> &b
-)
+void arrangeY(GllsProblem &g, const ConditionSet &ys, ThreadPool *pool)
 {
-    using namespace boost::numeric::ublas;
-    const matrix<double> mt = trans(m);
-    matrix<double> a = prod(m, mt);
-    vector<double> w = b;
-    permutation_matrix<std::size_t> pm(a.size1());
-    lu_factorize(a, pm);
-    lu_substitute(a, pm, w);
-    return prod(mt, w);
+    assert(g.xSize > 0);
+    assert(g.coef.size() % (g.xSize+1) == 0);
+    const int cols = g.xSize + 1;
+    GllsProfile::Span span("arrangeY");
+    span.addRows(ys.expandedSize());
+    // position of the row `id` of M in g.coef
+    const auto rowOf = [&g](int id) -> std::size_t {
+        if (g.rows.empty()) {
+            return static_cast<std::size_t>(id);
+        }
+        const auto it = std::lower_bound(g.rows.cbegin(), g.rows.cend(), id);
+        assert(it != g.rows.cend() && *it == id);
+        return static_cast<std::size_t>(it - g.rows.cbegin());
+    };
+    g.coef = combineRows(ys, g.xSize, cols,
+            [&](int id) { return &g.coef[rowOf(id)*cols]; }, 1, pool);
+    g.rows.clear();
 }
 
-boost::numeric::ublas::vector<double>
-solveExact(
-        const boost::numeric::ublas::matrix<double> &m,
-        const boost::numeric::ublas::vector<double> &b
-)
+GllsProblem arrangeY(
+        const GllsMatrixView &m, const ConditionSet &ys, ThreadPool *pool)
 {
-    using namespace boost::numeric::ublas;
-    auto a = m;
-    auto x = b;
-    permutation_matrix<std::size_t> pm(a.size1());
-    lu_factorize(a, pm);
-    lu_substitute(a, pm, x);
-    return x;
+    assert(m.cols > 0);
+    assert(m.rowStride > 0 && m.colStride > 0);
+    GllsProfile::Span span("arrangeY");
+    span.addRows(ys.expandedSize());
+    GllsProblem g;
+    g.xSize = m.cols;
+    g.coef = combineRows(ys, m.cols, m.cols + m.hasConstant,
+            [&m](int id) {
+                assert(id < m.rows);
+                return m.data + m.rowStride * static_cast<std::size_t>(id);
+            }, m.colStride, pool);
+    return g;
 }
 
 template<class IT> std::vector<double>
@@ -153,7 +189,117 @@ fullX(IT it, GllsProblem const &g)
     return v;
 }
 
-std::vector<double> solve(GllsProblem const &g)
+namespace {
+
+typedef boost::numeric::ublas::matrix<double> Matrix;
+typedef boost::numeric::ublas::vector<double> Vector;
+typedef boost::numeric::ublas::permutation_matrix<std::size_t> Permutation;
+
+Matrix toMatrix(const std::vector<double> &v, int rows, int cols)
+{
+    Matrix m(rows, cols);
+    std::copy(v.cbegin(), v.cend(), m.data().begin());
+    return m;
+}
+
+std::vector<double> fromMatrix(const Matrix &m)
+{
+    return std::vector<double>(m.data().begin(), m.data().end());
+}
+
+/**
+    A^T*v for the A of an arranged problem, i.e. its coefficients without
+    the constant column, read in place row by row
+*/
+Vector transposedTimes(const GllsProblem &g, const Vector &v)
+{
+    const std::size_t cols = g.xSize + 1;
+    assert(v.size() * cols == g.coef.size());
+    Vector x(g.xSize);
+    std::fill(x.begin(), x.end(), 0.0);
+    for (std::size_t row = 0; row < v.size(); ++row) {
+        const double *const a = &g.coef[row*cols];
+        const double f = v(row);
+        for (int col = 0; col < g.xSize; ++col) {
+            x(col) += f * a[col];
+        }
+    }
+    return x;
+}
+
+//! rows of A per task of the normal matrix
+const int GRAM_CHUNK = 512;
+
+/**
+    A^T*A as sums over chunks of rows on the pool, each task adds its rows
+    into its own n*n matrix, which are summed up at the end.
+*/
+Matrix gramColumns(const Matrix &m, ThreadPool &pool)
+{
+    const int rows = m.size1();
+    const int n = m.size2();
+    const int chunks = (rows + GRAM_CHUNK - 1) / GRAM_CHUNK;
+    std::vector<std::vector<double> > parts(chunks);
+    const double *const a = &m.data()[0];
+    pool.parallelFor(chunks, [&](std::size_t c) {
+        GllsTrace::Span span("gram chunk", "first", c * GRAM_CHUNK);
+        std::vector<double> &p = parts[c];
+        p.assign(static_cast<std::size_t>(n)*n, 0.0);
+        const int last = std::min<int>(rows, (c+1) * GRAM_CHUNK);
+        for (int r = c * GRAM_CHUNK; r < last; ++r) {
+            const double *const row = a + static_cast<std::size_t>(r)*n;
+            for (int i = 0; i < n; ++i) {
+                const double v = row[i];
+                double *const out = &p[static_cast<std::size_t>(i)*n];
+                for (int j = i; j < n; ++j) {
+                    out[j] += v * row[j];
+                }
+            }
+        }
+    });
+    Matrix g(n, n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = i; j < n; ++j) {
+            double v = 0;
+            for (const auto &p : parts) {
+                v += p[static_cast<std::size_t>(i)*n + j];
+            }
+            g(i, j) = v;
+            g(j, i) = v;
+        }
+    }
+    return g;
+}
+
+//! A*A^T, one task per chunk of rows of the result
+Matrix gramRows(const Matrix &m, ThreadPool &pool)
+{
+    const int rows = m.size1();
+    const int n = m.size2();
+    Matrix g(rows, rows);
+    const double *const a = &m.data()[0];
+    const int chunk = 64;
+    pool.parallelFor((rows + chunk - 1) / chunk, [&](std::size_t c) {
+        GllsTrace::Span span("gram chunk", "first", c * chunk);
+        const int last = std::min<int>(rows, (c+1) * chunk);
+        for (int i = c * chunk; i < last; ++i) {
+            const double *const ri = a + static_cast<std::size_t>(i)*n;
+            for (int j = 0; j < rows; ++j) {
+                const double *const rj = a + static_cast<std::size_t>(j)*n;
+                double v = 0;
+                for (int k = 0; k < n; ++k) {
+                    v += ri[k] * rj[k];
+                }
+                g(i, j) = v;
+            }
+        }
+    });
+    return g;
+}
+
+} // namespace
+
+GllsFactorization factorize(const GllsProblem &g, ThreadPool *pool)
 {
     using namespace boost::numeric::ublas;
 
@@ -161,24 +307,850 @@ std::vector<double> solve(GllsProblem const &g)
     assert(g.coef.size() % (g.xSize + 1) == 0);
     const int cols = g.xSize + 1;
     const int rows = g.coef.size() / (g.xSize + 1);
-    matrix<double> m(rows, g.xSize);
+    Matrix m(rows, g.xSize);
     for (int row = 0; row < rows; ++row) {
         for (int col = 0; col < g.xSize; ++col) {
             m(row, col) = g.coef[row*cols + col];
         }
     }
-    vector<double> b(rows);
-    for (int row = 0; row < rows; ++row) {
-            b(row) = -g.coef[(row+1)*cols - 1];
-    }
-    vector<double> x;
+    GllsFactorization f;
+    f.rows = rows;
+    f.cols = g.xSize;
+    Matrix a;
     if (rows > g.xSize) {
-        x = solveLeastSquare(m, b);
+        f.kind = GllsFactorization::Kind::LEAST_SQUARES;
+        GllsProfile::Span span("gram");
+        GllsTrace::Span trace("gram", "rows", rows);
+        span.addRows(rows);
+        span.addFlops(2.0 * rows * g.xSize * g.xSize);
+        a = pool ? gramColumns(m, *pool) : Matrix(prod(trans(m), m));
     } else if (rows < g.xSize) {
-        x = solveMinX2Norm(m, b);
+        f.kind = GllsFactorization::Kind::MIN_NORM;
+        GllsProfile::Span span("gram");
+        GllsTrace::Span trace("gram", "rows", rows);
+        span.addRows(rows);
+        span.addFlops(2.0 * rows * rows * g.xSize);
+        a = pool ? gramRows(m, *pool) : Matrix(prod(m, trans(m)));
     } else {
-        x = solveExact(m, b);
+        f.kind = GllsFactorization::Kind::EXACT;
+        a = m;
+    }
+    GllsProfile::Span span("factorize");
+    GllsTrace::Span trace("lu_factorize", "n", a.size1());
+    span.addRows(a.size1());
+    span.addFlops(2.0 / 3 * a.size1() * a.size1() * a.size1());
+    Permutation pm(a.size1());
+    lu_factorize(a, pm);
+    f.lu = fromMatrix(a);
+    f.pivots.assign(pm.begin(), pm.end());
+    return f;
+}
+
+std::vector<double> substitute(const GllsFactorization &f, const GllsProblem &g)
+{
+    using namespace boost::numeric::ublas;
+
+    const int cols = g.xSize + 1;
+    assert(g.xSize == f.cols);
+    assert(g.coef.size() == static_cast<std::size_t>(f.rows) * cols);
+    GllsProfile::Span span("substitute");
+    GllsTrace::Span trace("substitute", "rows", f.rows);
+    span.addRows(f.rows);
+    Vector b(f.rows);
+    for (int row = 0; row < f.rows; ++row) {
+        b(row) = -g.coef[(row+1)*cols - 1];
+    }
+    const int n = f.pivots.size();
+    span.addFlops(2.0 * n * n + (f.kind == GllsFactorization::Kind::EXACT
+            ? 0 : 2.0 * f.rows * f.cols));
+    const Matrix lu = toMatrix(f.lu, n, n);
+    Permutation pm(n);
+    std::copy(f.pivots.cbegin(), f.pivots.cend(), pm.begin());
+    Vector x;
+    switch (f.kind) {
+    case GllsFactorization::Kind::LEAST_SQUARES:
+        x = transposedTimes(g, b);
+        lu_substitute(lu, pm, x);
+        break;
+    case GllsFactorization::Kind::MIN_NORM:
+        lu_substitute(lu, pm, b);
+        x = transposedTimes(g, b);
+        break;
+    case GllsFactorization::Kind::EXACT:
+        x = b;
+        lu_substitute(lu, pm, x);
+        break;
     }
     return fullX(x.begin(), g);
 }
 
+std::vector<double> solve(GllsProblem const &g, ThreadPool *pool)
+{
+    return substitute(factorize(g, pool), g);
+}
+
+std::vector<std::vector<double> > sweepX(
+        const GllsProblem &g,
+        int index,
+        const std::vector<double> &values,
+        ThreadPool *pool
+)
+{
+    using namespace boost::numeric::ublas;
+
+    const int fullSize = g.xSize + g.reservedX.size();
+    if (index < 0 || index >= fullSize) {
+        throw std::invalid_argument("sweep: no X value " + std::to_string(index));
+    }
+    // the column of `index` among the free ones
+    int col = index;
+    for (const auto &x : g.reservedX) {
+        if (x.first == index) {
+            throw std::invalid_argument("sweep: X value "
+                    + std::to_string(index) + " is fixed");
+        }
+        col -= x.first < index;
+    }
+    if (g.xSize < 2) {
+        throw std::invalid_argument("sweep: no other X value to solve for");
+    }
+
+    // the problem without the column, which is kept apart
+    const int cols = g.xSize + 1;
+    const int rows = g.coef.size() / cols;
+    GllsProblem r;
+    r.xSize = g.xSize - 1;
+    r.reservedX = g.reservedX;
+    r.reservedX.insert(std::lower_bound(r.reservedX.begin(),
+            r.reservedX.end(), std::make_pair(index, 0.0)),
+            std::make_pair(index, 0.0));
+    r.coef.reserve(rows * (cols-1));
+    Vector column(rows);
+    for (int row = 0; row < rows; ++row) {
+        const double *const c = &g.coef[row*cols];
+        r.coef.insert(r.coef.end(), c, c + col);
+        r.coef.insert(r.coef.end(), c + col + 1, c + cols);
+        column(row) = -c[col];
+    }
+    const GllsFactorization f = factorize(r, pool);
+
+    GllsProfile::Span span("substitute");
+    GllsTrace::Span trace("sweep", "values", values.size());
+    span.addRows(values.size());
+    const int n = f.pivots.size();
+    const Matrix lu = toMatrix(f.lu, n, n);
+    Permutation pm(n);
+    std::copy(f.pivots.cbegin(), f.pivots.cend(), pm.begin());
+    Vector base(rows);
+    for (int row = 0; row < rows; ++row) {
+        base(row) = -r.coef[(row+1)*(cols-1) - 1];
+    }
+    if (f.kind == GllsFactorization::Kind::LEAST_SQUARES) {
+        // the right-hand side A^T*b is linear in the value, too
+        base = transposedTimes(r, base);
+        column = transposedTimes(r, column);
+    }
+    span.addFlops(values.size() * (2.0 * n * n
+            + (f.kind == GllsFactorization::Kind::MIN_NORM
+                ? 2.0 * f.rows * f.cols : 0)));
+
+    std::vector<std::vector<double> > xs(values.size());
+    const auto point = [&](std::size_t i) {
+        Vector x = base + values[i] * column;
+        lu_substitute(lu, pm, x);
+        if (f.kind == GllsFactorization::Kind::MIN_NORM) {
+            x = transposedTimes(r, x);
+        }
+        xs[i] = fullX(x.begin(), r);
+        xs[i][index] = values[i];
+    };
+    if (pool) {
+        pool->parallelFor(values.size(), point);
+    } else {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            point(i);
+        }
+    }
+    return xs;
+}
+
+namespace {
+
+//! rows per task of the residual
+const std::size_t RESIDUAL_CHUNK = 1024;
+
+struct ResidualPart
+{
+    double sumSquares;
+    double maxAbs;
+    std::size_t worstRow;
+};
+
+/**
+    r = A*free + c for rows [first, last) of a row-major A with `stride`,
+    with the constants in column `cols`-1 of g.coef
+*/
+ResidualPart residualRows(
+        const double *a, std::size_t stride, const GllsProblem &g,
+        const std::vector<double> &free, std::size_t first, std::size_t last,
+        double *r)
+{
+    const std::size_t cols = g.xSize + 1;
+    ResidualPart p = {0.0, -1.0, first};
+    for (std::size_t row = first; row < last; ++row) {
+        const double *const c = a + row*stride;
+        double v = g.coef[row*cols + cols-1];
+        for (int col = 0; col < g.xSize; ++col) {
+            v += c[col] * free[col];
+        }
+        r[row] = v;
+        p.sumSquares += v*v;
+        if (std::abs(v) > p.maxAbs) {
+            p.maxAbs = std::abs(v);
+            p.worstRow = row;
+        }
+    }
+    return p;
+}
+
+//! the entries of a full length `x` not reserved by g, in column order
+std::vector<double> freeX(const GllsProblem &g, const std::vector<double> &x)
+{
+    std::vector<double> free;
+    free.reserve(g.xSize);
+    auto reserved = g.reservedX.cbegin();
+    for (int i = 0; i < static_cast<int>(x.size()); ++i) {
+        if (reserved != g.reservedX.cend() && reserved->first == i) {
+            ++reserved;
+        } else {
+            free.push_back(x[i]);
+        }
+    }
+    return free;
+}
+
+/**
+    Hager's estimate of the 1-norm of a matrix B given by products with B
+    and B^T, as in LAPACK's condition estimators.
+*/
+template<class Apply, class ApplyT>
+double normEstimate(std::size_t n, Apply apply, ApplyT applyT)
+{
+    std::vector<double> x(n, 1.0 / n);
+    std::vector<double> y;
+    double estimate = 0.0;
+    for (int iteration = 0; iteration < 5; ++iteration) {
+        y = x;
+        apply(y);
+        estimate = 0.0;
+        for (auto &v : y) {
+            estimate += std::abs(v);
+            v = v < 0 ? -1.0 : 1.0;
+        }
+        applyT(y);
+        std::size_t j = 0;
+        double dot = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (std::abs(y[i]) > std::abs(y[j])) {
+                j = i;
+            }
+            dot += y[i] * x[i];
+        }
+        if (std::abs(y[j]) <= dot) {
+            break;
+        }
+        std::fill(x.begin(), x.end(), 0.0);
+        x[j] = 1.0;
+    }
+    return estimate;
+}
+
+//! v = B^-1*v for the factors P*B = L*U of `f`, in O(n^2)
+void luSolve(const GllsFactorization &f, double *v)
+{
+    const std::size_t n = f.pivots.size();
+    const double *const lu = f.lu.data();
+    for (std::size_t i = 0; i < n; ++i) {
+        std::swap(v[i], v[f.pivots[i]]);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t k = 0; k < i; ++k) {
+            v[i] -= lu[i*n + k] * v[k];
+        }
+    }
+    for (std::size_t i = n; i-- > 0;) {
+        for (std::size_t k = i+1; k < n; ++k) {
+            v[i] -= lu[i*n + k] * v[k];
+        }
+        v[i] /= lu[i*n + i];
+    }
+}
+
+/**
+    the 1-norm condition number of the factorized matrix B, with P*B = L*U,
+    estimated with O(n^2) work per product
+*/
+double conditionEstimate(const GllsFactorization &f)
+{
+    const std::size_t n = f.pivots.size();
+    const double *const lu = f.lu.data();
+    const auto &pm = f.pivots;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (lu[i*n + i] == 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+    }
+    const auto permute = [&](std::vector<double> &v) {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::swap(v[i], v[pm[i]]);
+        }
+    };
+    const auto unpermute = [&](std::vector<double> &v) {
+        for (std::size_t i = n; i-- > 0;) {
+            std::swap(v[i], v[pm[i]]);
+        }
+    };
+    // B*v = P^T*L*U*v
+    const auto times = [&](std::vector<double> &v) {
+        for (std::size_t i = 0; i < n; ++i) {
+            double s = 0.0;
+            for (std::size_t k = i; k < n; ++k) {
+                s += lu[i*n + k] * v[k];
+            }
+            v[i] = s;
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            for (std::size_t k = 0; k < i; ++k) {
+                v[i] += lu[i*n + k] * v[k];
+            }
+        }
+        unpermute(v);
+    };
+    // B^T*v = U^T*L^T*P*v
+    const auto timesT = [&](std::vector<double> &v) {
+        permute(v);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t k = i+1; k < n; ++k) {
+                v[i] += lu[k*n + i] * v[k];
+            }
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            double s = 0.0;
+            for (std::size_t k = 0; k <= i; ++k) {
+                s += lu[k*n + i] * v[k];
+            }
+            v[i] = s;
+        }
+    };
+    const auto solve = [&](std::vector<double> &v) { luSolve(f, v.data()); };
+    const auto solveT = [&](std::vector<double> &v) {
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t k = 0; k < i; ++k) {
+                v[i] -= lu[k*n + i] * v[k];
+            }
+            v[i] /= lu[i*n + i];
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            for (std::size_t k = i+1; k < n; ++k) {
+                v[i] -= lu[k*n + i] * v[k];
+            }
+        }
+        unpermute(v);
+    };
+    return normEstimate(n, times, timesT) * normEstimate(n, solve, solveT);
+}
+
+} // namespace
+
+std::vector<double> substitute(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        GllsDiagnostics &d,
+        ThreadPool *pool
+)
+{
+    auto x = substitute(f, g);
+    const std::vector<double> free = freeX(g, x);
+    const double *const a = g.coef.data();
+    const std::size_t stride = f.cols + 1;
+    const std::size_t rows = f.rows;
+    d.residual.assign(rows, 0.0);
+    const std::size_t chunks = (rows + RESIDUAL_CHUNK - 1) / RESIDUAL_CHUNK;
+    std::vector<ResidualPart> parts(chunks);
+    const auto work = [&](std::size_t i) {
+        const std::size_t first = i * RESIDUAL_CHUNK;
+        GllsTrace::Span span("residual chunk", "first", first);
+        parts[i] = residualRows(a, stride, g, free, first,
+                std::min(rows, first + RESIDUAL_CHUNK), d.residual.data());
+    };
+    if (pool && chunks > 1) {
+        pool->parallelFor(chunks, work);
+    } else {
+        for (std::size_t i = 0; i < chunks; ++i) {
+            work(i);
+        }
+    }
+    double sumSquares = 0.0;
+    d.normInf = 0.0;
+    d.worstRow = 0;
+    for (const auto &p : parts) {
+        sumSquares += p.sumSquares;
+        if (p.maxAbs > d.normInf) {
+            d.normInf = p.maxAbs;
+            d.worstRow = p.worstRow;
+        }
+    }
+    d.norm2 = std::sqrt(sumSquares);
+    // the pivots of the LU factors, of A or of its Gram matrix
+    const std::size_t n = f.pivots.size();
+    double maxPivot = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        maxPivot = std::max(maxPivot, std::abs(f.lu[i*n + i]));
+    }
+    const double tolerance =
+            maxPivot * n * std::numeric_limits<double>::epsilon();
+    d.rank = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (std::abs(f.lu[i*n + i]) > tolerance) {
+            ++d.rank;
+        }
+    }
+    d.conditionEstimate = conditionEstimate(f);
+    if (f.kind != GllsFactorization::Kind::EXACT) {
+        // the condition number of A^T*A or A*A^T is the square of A's
+        d.conditionEstimate = std::sqrt(d.conditionEstimate);
+    }
+    return x;
+}
+
+std::vector<double> solve(
+        const GllsProblem &g, GllsDiagnostics &d, ThreadPool *pool)
+{
+    return substitute(factorize(g, pool), g, d, pool);
+}
+
+std::vector<std::pair<int, double> > residualByLine(
+        const GllsDiagnostics &d, const ConditionSet &ys)
+{
+    return residualByLine(d.residual, ys);
+}
+
+std::vector<std::pair<int, double> > residualByLine(
+        const std::vector<double> &r, const ConditionSet &ys)
+{
+    assert(r.size() == ys.expandedSize());
+    std::vector<std::pair<int, double> > result;
+    const auto &lines = ys.lines();
+    const auto add = [&](int line, std::size_t first, std::size_t last) {
+        double sum = 0.0;
+        for (std::size_t row = first; row < last; ++row) {
+            sum += r[row] * r[row];
+        }
+        if (first < last) {
+            result.push_back(std::make_pair(line, std::sqrt(sum)));
+        }
+    };
+    const std::size_t rows = r.size();
+    add(0, 0, lines.empty() ? rows : std::min(rows, lines[0].first));
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        const std::size_t last = i+1 < lines.size() ? lines[i+1].first : rows;
+        add(lines[i].second, lines[i].first, std::min(rows, last));
+    }
+    return result;
+}
+
+std::vector<double> residual(const GllsProblem &g, const std::vector<double> &x)
+{
+    assert(x.size() == g.xSize + g.reservedX.size());
+    const std::size_t cols = g.xSize + 1;
+    const std::size_t rows = g.coef.size() / cols;
+    std::vector<double> r(rows);
+    residualRows(g.coef.data(), cols, g, freeX(g, x), 0, rows, r.data());
+    return r;
+}
+
+namespace {
+
+/**
+    a pivot below this times the largest absolute entry of the matrix makes
+    solveDense() give up
+*/
+const double SINGULAR = 1e-10;
+
+/**
+    solve the s*s system m*x = b in place by Gaussian elimination with
+    partial pivoting
+    @return false if m is singular to working precision, relative to its
+            largest entry
+*/
+bool solveDense(std::vector<double> &m, std::vector<double> &b)
+{
+    const std::size_t s = b.size();
+    double scale = 0.0;
+    for (const double v : m) {
+        scale = std::max(scale, std::abs(v));
+    }
+    for (std::size_t k = 0; k < s; ++k) {
+        std::size_t p = k;
+        for (std::size_t i = k+1; i < s; ++i) {
+            if (std::abs(m[i*s + k]) > std::abs(m[p*s + k])) {
+                p = i;
+            }
+        }
+        if (!(std::abs(m[p*s + k]) > SINGULAR * scale)) {
+            return false;
+        }
+        if (p != k) {
+            std::swap_ranges(m.begin() + k*s, m.begin() + (k+1)*s,
+                    m.begin() + p*s);
+            std::swap(b[k], b[p]);
+        }
+        for (std::size_t i = k+1; i < s; ++i) {
+            const double l = m[i*s + k] / m[k*s + k];
+            for (std::size_t j = k; j < s; ++j) {
+                m[i*s + j] -= l * m[k*s + j];
+            }
+            b[i] -= l * b[k];
+        }
+    }
+    for (std::size_t k = s; k-- > 0;) {
+        for (std::size_t j = k+1; j < s; ++j) {
+            b[k] -= m[k*s + j] * b[j];
+        }
+        b[k] /= m[k*s + k];
+    }
+    return true;
+}
+
+} // namespace
+
+GllsCrossValidation crossValidate(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        const std::vector<std::size_t> &groups,
+        ThreadPool *pool
+)
+{
+    if (f.kind != GllsFactorization::Kind::LEAST_SQUARES) {
+        throw std::invalid_argument(
+                "cross validation needs more conditions than unknowns");
+    }
+    const std::size_t rows = f.rows;
+    const std::size_t n = f.cols;
+    if (!groups.empty() && groups.size() != rows) {
+        throw std::invalid_argument("cross validation: one group per row");
+    }
+    GllsTrace::Span trace("crossValidate", "rows", rows);
+    // the rows of every group
+    std::vector<std::vector<std::size_t> > members;
+    if (groups.empty()) {
+        members.resize(rows);
+        for (std::size_t row = 0; row < rows; ++row) {
+            members[row].push_back(row);
+        }
+    } else {
+        members.resize(*std::max_element(groups.cbegin(), groups.cend()) + 1);
+        for (std::size_t row = 0; row < rows; ++row) {
+            members[groups[row]].push_back(row);
+        }
+    }
+
+    GllsCrossValidation cv;
+    cv.residual = residual(g, substitute(f, g));
+    cv.leverage.assign(rows, 0.0);
+    cv.left.assign(rows, 0.0);
+    // A in place in the arranged coefficients, c in its last column
+    const double *const a = g.coef.data();
+    const std::size_t stride = n + 1;
+    // A^T*A and A^T*c for the groups of more rows than unknowns
+    std::vector<double> gram, atc;
+    for (const auto &rs : members) {
+        if (rs.size() > n) {
+            gram.assign(n * n, 0.0);
+            atc.assign(n, 0.0);
+            for (std::size_t row = 0; row < rows; ++row) {
+                const double *const ar = a + row*stride;
+                for (std::size_t i = 0; i < n; ++i) {
+                    for (std::size_t j = i; j < n; ++j) {
+                        gram[i*n + j] += ar[i] * ar[j];
+                    }
+                    atc[i] += ar[i] * ar[n];
+                }
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < i; ++j) {
+                    gram[i*n + j] = gram[j*n + i];
+                }
+            }
+            break;
+        }
+    }
+    // with more rows than unknowns, the n*n system of the other rows is
+    // smaller than I - H_SS: x = -(A^T*A - A_S^T*A_S)^-1 * (A^T*c - A_S^T*c_S)
+    const auto downdate = [&](const std::vector<std::size_t> &rs) {
+        std::vector<double> z(n);
+        for (const std::size_t row : rs) {
+            const double *const ar = a + row*stride;
+            std::copy(ar, ar + n, z.begin());
+            luSolve(f, z.data());
+            double h = 0.0;
+            for (std::size_t c = 0; c < n; ++c) {
+                h += ar[c] * z[c];
+            }
+            cv.leverage[row] = h;
+        }
+        std::vector<double> m(gram);
+        std::vector<double> x(atc);
+        for (const std::size_t row : rs) {
+            const double *const ar = a + row*stride;
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < n; ++j) {
+                    m[i*n + j] -= ar[i] * ar[j];
+                }
+                x[i] -= ar[i] * ar[n];
+            }
+        }
+        const bool determined = solveDense(m, x);
+        for (const std::size_t row : rs) {
+            const double *const ar = a + row*stride;
+            double e = ar[n];
+            for (std::size_t c = 0; c < n; ++c) {
+                e -= ar[c] * x[c];
+            }
+            cv.left[row] = determined
+                ? e : std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+    // e_S without S is (I - H_SS)^-1 * e_S, H_SS = A_S * (A^T*A)^-1 * A_S^T
+    const auto leaveOut = [&](std::size_t k) {
+        const auto &rs = members[k];
+        const std::size_t s = rs.size();
+        if (s > n) {
+            downdate(rs);
+            return;
+        }
+        std::vector<double> z(s * n);
+        for (std::size_t j = 0; j < s; ++j) {
+            std::copy(a + rs[j]*stride, a + rs[j]*stride + n, z.begin() + j*n);
+            luSolve(f, &z[j*n]);
+        }
+        std::vector<double> m(s * s);
+        std::vector<double> e(s);
+        for (std::size_t i = 0; i < s; ++i) {
+            const double *const ai = a + rs[i]*stride;
+            for (std::size_t j = 0; j < s; ++j) {
+                double h = 0.0;
+                for (std::size_t c = 0; c < n; ++c) {
+                    h += ai[c] * z[j*n + c];
+                }
+                m[i*s + j] = (i == j) - h;
+            }
+            cv.leverage[rs[i]] = 1.0 - m[i*s + i];
+            e[i] = cv.residual[rs[i]];
+        }
+        if (!solveDense(m, e)) {
+            // the other rows do not determine X
+            std::fill(e.begin(), e.end(),
+                    std::numeric_limits<double>::quiet_NaN());
+        }
+        for (std::size_t i = 0; i < s; ++i) {
+            cv.left[rs[i]] = e[i];
+        }
+    };
+    if (pool && members.size() > 1) {
+        pool->parallelFor(members.size(), leaveOut);
+    } else {
+        for (std::size_t k = 0; k < members.size(); ++k) {
+            leaveOut(k);
+        }
+    }
+    cv.press = 0.0;
+    for (const double e : cv.left) {
+        cv.press += e * e;
+    }
+    return cv;
+}
+
+std::vector<std::size_t> foldGroups(std::size_t rows, std::size_t k)
+{
+    assert(k > 0);
+    std::vector<std::size_t> groups(rows);
+    for (std::size_t row = 0; row < rows; ++row) {
+        groups[row] = row % k;
+    }
+    return groups;
+}
+
+std::vector<std::size_t> lineGroups(const ConditionSet &ys)
+{
+    const std::size_t rows = ys.expandedSize();
+    const auto &lines = ys.lines();
+    std::vector<std::size_t> groups(rows, 0);
+    // rows in front of the first line, if any, form group 0
+    const std::size_t offset = lines.empty() || lines[0].first > 0;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        const std::size_t last = i+1 < lines.size() ? lines[i+1].first : rows;
+        for (std::size_t row = lines[i].first; row < std::min(rows, last);
+                ++row) {
+            groups[row] = i + offset;
+        }
+    }
+    return groups;
+}
+
+namespace {
+
+//! covariance() for the solution `x` of `g`, which gives sigma2
+GllsCovariance covarianceOf(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        const std::vector<double> &x,
+        const std::vector<std::pair<int, int> > &entries,
+        bool withDiagonal
+)
+{
+    if (f.kind != GllsFactorization::Kind::LEAST_SQUARES) {
+        throw std::invalid_argument(
+                "covariance needs more conditions than unknowns");
+    }
+    const std::size_t n = f.pivots.size();
+    const int fullSize = g.xSize + g.reservedX.size();
+    // the free column of every X value, -1 if reserved
+    std::vector<int> column(fullSize);
+    {
+        auto reserved = g.reservedX.cbegin();
+        int col = 0;
+        for (int i = 0; i < fullSize; ++i) {
+            if (reserved != g.reservedX.cend() && reserved->first == i) {
+                column[i] = -1;
+                ++reserved;
+            } else {
+                column[i] = col++;
+            }
+        }
+    }
+    for (const auto &e : entries) {
+        if (e.first < 0 || e.first >= fullSize
+                || e.second < 0 || e.second >= fullSize) {
+            throw std::invalid_argument("covariance: no X value "
+                    + std::to_string(e.first < 0 || e.first >= fullSize
+                        ? e.first : e.second));
+        }
+    }
+    GllsTrace::Span trace("covariance", "n", n);
+
+    const double *const lu = f.lu.data();
+    // row i of U^-1, zero in front of i
+    const auto upperRow = [&](std::size_t i, std::vector<double> &y) {
+        y.assign(n, 0.0);
+        y[i] = 1.0 / lu[i*n + i];
+        for (std::size_t k = i+1; k < n; ++k) {
+            double v = 0.0;
+            for (std::size_t j = i; j < k; ++j) {
+                v += y[j] * lu[j*n + k];
+            }
+            y[k] = -v / lu[k*n + k];
+        }
+    };
+    // column c of L^-1, zero in front of c, with the unit diagonal of L
+    const auto lowerColumn = [&](std::size_t c, std::vector<double> &z) {
+        z.assign(n, 0.0);
+        z[c] = 1.0;
+        for (std::size_t k = c+1; k < n; ++k) {
+            double v = 0.0;
+            for (std::size_t j = c; j < k; ++j) {
+                v += lu[k*n + j] * z[j];
+            }
+            z[k] = -v;
+        }
+    };
+    // P*e_j = e_position[j]
+    std::vector<std::size_t> row(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        row[i] = i;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        std::swap(row[i], row[f.pivots[i]]);
+    }
+    std::vector<std::size_t> position(n);
+    for (std::size_t r = 0; r < n; ++r) {
+        position[row[r]] = r;
+    }
+    // (U^-1 * L^-1 * P)(a, b), both are zero in front of max(a, position[b])
+    const auto dot = [&](std::size_t a, std::size_t b,
+            const std::vector<double> &y, const std::vector<double> &z) {
+        double v = 0.0;
+        for (std::size_t k = std::max(a, position[b]); k < n; ++k) {
+            v += y[k] * z[k];
+        }
+        return v;
+    };
+
+    GllsCovariance cov;
+    if (withDiagonal) {
+        cov.diagonal.assign(fullSize, 0.0);
+        std::vector<double> y, z;
+        for (int i = 0; i < fullSize; ++i) {
+            if (column[i] >= 0) {
+                const std::size_t a = column[i];
+                upperRow(a, y);
+                lowerColumn(position[a], z);
+                cov.diagonal[i] = dot(a, a, y, z);
+            }
+        }
+    }
+    // the rows of U^-1 and columns of L^-1 of the distinct indices only
+    std::map<std::size_t, std::vector<double> > upperRows, lowerColumns;
+    cov.entries.reserve(entries.size());
+    for (const auto &e : entries) {
+        const int a = column[e.first];
+        const int b = column[e.second];
+        if (a < 0 || b < 0) {
+            cov.entries.push_back(0.0);
+            continue;
+        }
+        auto y = upperRows.find(a);
+        if (y == upperRows.end()) {
+            y = upperRows.emplace(a, std::vector<double>()).first;
+            upperRow(a, y->second);
+        }
+        auto z = lowerColumns.find(b);
+        if (z == lowerColumns.end()) {
+            z = lowerColumns.emplace(b, std::vector<double>()).first;
+            lowerColumn(position[b], z->second);
+        }
+        cov.entries.push_back(dot(a, b, y->second, z->second));
+    }
+    double sumSquares = 0.0;
+    for (const double r : residual(g, x)) {
+        sumSquares += r * r;
+    }
+    cov.sigma2 = sumSquares / (f.rows - f.cols);
+    return cov;
+}
+
+} // namespace
+
+GllsCovariance covariance(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        const std::vector<std::pair<int, int> > &entries,
+        bool withDiagonal
+)
+{
+    return covarianceOf(f, g, substitute(f, g), entries, withDiagonal);
+}
+
+std::vector<double> solve(
+        const GllsProblem &g,
+        GllsCovariance &cov,
+        const std::vector<std::pair<int, int> > &entries,
+        ThreadPool *pool,
+        bool withDiagonal
+)
+{
+    const auto f = factorize(g, pool);
+    auto x = substitute(f, g);
+    cov = covarianceOf(f, g, x, entries, withDiagonal);
+    return x;
+}
@@ -5,15 +5,25 @@
 #ifndef GENERAL_LINEAR_LEAST_SQUARES_SOLVE_GLLS_H
 #define GENERAL_LINEAR_LEAST_SQUARES_SOLVE_GLLS_H
 
+#include "conditionset.h"
+
+#include <cstddef>
 #include <vector>
-#include <list>
 #include <utility>
 
+class ThreadPool;
+
 struct GllsProblem
 {
     int xSize;
     std::vector<std::pair<int, double> > reservedX;
     std::vector<double> coef;
+    /**
+        row indices of M held by `coef` in ascending order, if only a subset
+        of M is loaded, see GllsParser::setLazy(); empty if `coef` holds all
+        rows. arrangeY() looks the Y IDs up here.
+    */
+    std::vector<int> rows;
 };
 
 void arrangeX(
@@ -21,15 +31,283 @@ void arrangeX(
         const std::vector<std::pair<int, double> > &xs
 );
 
-void arrangeY(
-        GllsProblem &,
-        const std::list<std::vector<std::pair<int, double> > > &ys
+/**
+    @param pool combine chunks of rows in parallel on the pool, if given
+*/
+void arrangeY(GllsProblem &, const ConditionSet &ys, ThreadPool *pool = nullptr);
+
+/**
+    @brief a borrowed M, e.g. a buffer of the caller, with element (r, c) at
+           data[r*rowStride + c*colStride]
+
+    colStride is 1 for a row-major and rowStride is 1 for a column-major
+    matrix, e.g. a Fortran array with a leading dimension of colStride.
+*/
+struct GllsMatrixView
+{
+    const double *data;
+    int rows;
+    //! number of X columns
+    int cols;
+    //! distance in elements between two rows
+    std::size_t rowStride;
+    //! distance in elements between two columns
+    std::size_t colStride;
+    //! whether column `cols` holds the constant of each row
+    bool hasConstant;
+};
+
+/**
+    @brief arrangeY() reading M in place
+
+    Only the referenced rows of `m` are read. arrangeX() may follow, as
+    both only form linear combinations.
+*/
+GllsProblem arrangeY(
+        const GllsMatrixView &m,
+        const ConditionSet &ys,
+        ThreadPool *pool = nullptr
 );
 
+/**
+    @brief LU factors of the normal equations of an arranged problem
+
+    With A the arranged coefficients without the constant column, the
+    factors are of A^T*A for an overdetermined, of A*A^T for an
+    underdetermined and of A itself for a square problem. They depend on
+    A only, so they are reused for any constants with substitute(), which
+    reads A from the coefficients of the problem.
+*/
+struct GllsFactorization
+{
+    enum class Kind { LEAST_SQUARES, MIN_NORM, EXACT };
+    Kind kind;
+    int rows;
+    int cols;
+    //! the n*n LU factors in row-major order
+    std::vector<double> lu;
+    //! row permutation of the LU factorization
+    std::vector<std::size_t> pivots;
+};
+
+/**
+    @param pool form the normal matrix in parallel on the pool, if given
+*/
+GllsFactorization factorize(const GllsProblem &, ThreadPool *pool = nullptr);
+
+/**
+    @param g the problem `f` was factorized from, or one with the same
+           coefficients and other constants
+    @return a full length `x` vector
+*/
+std::vector<double> substitute(const GllsFactorization &f, const GllsProblem &g);
+
 /**
     @return a full length `x` vector
 */
-std::vector<double> solve(const GllsProblem &);
+std::vector<double> solve(const GllsProblem &, ThreadPool *pool = nullptr);
+
+/**
+    @brief solutions for many values of one X value, factorized once
+
+    Fixing X value `index` to v only adds v times its column of A to the
+    constants, so the A without that column is factorized once, and each
+    value only forms its right-hand side and substitutes: O(n^2) per value
+    instead of a new arrangement and factorization.
+
+    @param g an arranged problem in which `index` is not reserved, i.e. it
+           was left out of the values given to arrangeX()
+    @param pool substitute the values in parallel on the pool, if given
+    @return the full length `x` vector for each of `values`
+    @throw std::invalid_argument if `index` is out of range or reserved, or
+           the only X value left
+*/
+std::vector<std::vector<double> > sweepX(
+        const GllsProblem &g,
+        int index,
+        const std::vector<double> &values,
+        ThreadPool *pool = nullptr
+);
+
+/**
+    @brief quality of a solution, see substitute()
+*/
+struct GllsDiagnostics
+{
+    //! residual of every row of the arranged problem, i.e. of every condition
+    std::vector<double> residual;
+    double norm2;
+    double normInf;
+    //! the row with the largest absolute residual
+    std::size_t worstRow;
+    /**
+        numerical rank of the factorized matrix, i.e. of A^T*A or A*A^T
+        unless the problem is square, from the pivots of its LU factors with
+        a tolerance of n*eps relative to the largest. As the normal matrix
+        squares the condition number of A, this is below the rank of A once
+        cond(A) exceeds about 1/sqrt(n*eps), even though the solution still
+        uses all columns.
+    */
+    int rank;
+    /**
+        the 1-norm condition number of A, from Hager's estimate for the
+        factorized matrix; the square root of it for A^T*A and A*A^T
+    */
+    double conditionEstimate;
+};
+
+/**
+    @brief substitute() and the diagnostics of the solution
+
+    The residual needs the solution, so after the substitution it takes
+    one more O(m*n) pass over the coefficients of `g`, on the pool if
+    given. The rank and the condition estimate only read the factors,
+    O(n^2).
+*/
+std::vector<double> substitute(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        GllsDiagnostics &d,
+        ThreadPool *pool = nullptr
+);
+
+//! solve() with diagnostics, see substitute()
+std::vector<double> solve(
+        const GllsProblem &, GllsDiagnostics &, ThreadPool *pool = nullptr);
+
+/**
+    @param ys the conditions the problem was arranged with, with lines
+    @return pairs of an input line and the 2-norm of the residuals of its
+            rows in the order of `ys`, line 0 for rows without a line, see
+            ConditionSet::setLine()
+*/
+std::vector<std::pair<int, double> > residualByLine(
+        const GllsDiagnostics &d, const ConditionSet &ys);
+
+/**
+    @brief selected entries of (A^T*A)^-1 of a least squares problem, which
+           times `sigma2` is the covariance of the solution
+*/
+struct GllsCovariance
+{
+    /**
+        the diagonal, of full length, 0 for the reserved X values; empty
+        unless requested
+    */
+    std::vector<double> diagonal;
+    //! the requested entries in the order of the request
+    std::vector<double> entries;
+    //! the variance of a condition estimated from the residual, |r|^2/(m-n)
+    double sigma2;
+};
+
+/**
+    @brief the diagonal and selected entries of (A^T*A)^-1 from the factors
+
+    With P*A^T*A = L*U, (A^T*A)^-1 = U^-1*L^-1*P, and entry (a, b) is the
+    product of row a of U^-1 and column b of L^-1*P. Each is one triangular
+    solve, which skips the zeros in front of its index, O(n^2) at most.
+    The entries take only the rows and columns of their distinct indices,
+    so k of them cost O(k*n^2) and O(k*n) memory. The diagonal needs every
+    row and column, about 2*n^3/3 flops like inverting both factors, but
+    one at a time in O(n) scratch.
+
+    @param f factors of Kind::LEAST_SQUARES
+    @param g the problem `f` was factorized from
+    @param entries pairs of indices of the full length `x`; entries of a
+           reserved X value are 0
+    @param withDiagonal whether to compute the diagonal as well
+    @return the entries and sigma2, which takes one substitute() and
+            residual(); see solve() to substitute only once
+    @throw std::invalid_argument if `f` is not of a least squares problem,
+           or an index is out of range
+*/
+GllsCovariance covariance(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        const std::vector<std::pair<int, int> > &entries
+                = std::vector<std::pair<int, int> >(),
+        bool withDiagonal = false
+);
+
+/**
+    @brief solve() with the covariance, see covariance(); sigma2 is taken
+           from the returned solution
+*/
+std::vector<double> solve(
+        const GllsProblem &,
+        GllsCovariance &,
+        const std::vector<std::pair<int, int> > &entries
+                = std::vector<std::pair<int, int> >(),
+        ThreadPool *pool = nullptr,
+        bool withDiagonal = false
+);
+
+//! residualByLine() of any values, one per row, e.g. GllsCrossValidation::left
+std::vector<std::pair<int, double> > residualByLine(
+        const std::vector<double> &r, const ConditionSet &ys);
+
+//! the influence of every row of a least squares problem, without refits
+struct GllsCrossValidation
+{
+    //! the residual of every row of the arranged problem, as residual()
+    std::vector<double> residual;
+    //! the diagonal of the hat matrix A*(A^T*A)^-1*A^T
+    std::vector<double> leverage;
+    /**
+        the residual of every row in the fit without its group, NaN if the
+        other rows do not determine X
+    */
+    std::vector<double> left;
+    //! the sum of the squares of `left`, i.e. PRESS
+    double press;
+};
+
+/**
+    @brief leave-one-out or grouped cross validation from the factors
+
+    The residuals e_S of the rows S of a group in the fit without them are
+    (I - H_SS)^-1 * e_S, with e the residuals of the full fit and
+    H_SS = A_S*(A^T*A)^-1*A_S^T, a downdate of rank |S| instead of a refit.
+    For single rows that is e_i / (1 - h_ii). The products (A^T*A)^-1*a_i
+    with the existing factors cost O(m*n^2) in total, and a group
+    O(|S|^2*n + |S|^3) more. A group of more rows than unknowns instead
+    solves the n*n normal equations of the other rows, A^T*A downdated by
+    A_S^T*A_S, in O(|S|*n^2 + n^3), after A^T*A is formed once in O(m*n^2).
+    Either system counts as singular with a pivot below 1e-10 times its
+    largest entry, which makes the residuals of the group NaN.
+
+    @param f factors of Kind::LEAST_SQUARES
+    @param g the problem `f` was factorized from
+    @param groups the group 0, 1, ... of every row, the rows of a group are
+           left out together, e.g. foldGroups() or lineGroups(); empty to
+           leave out every row alone
+    @param pool work on the groups in parallel on the pool, if given
+    @throw std::invalid_argument if `f` is not of a least squares problem,
+           or `groups` does not match the rows
+*/
+GllsCrossValidation crossValidate(
+        const GllsFactorization &f,
+        const GllsProblem &g,
+        const std::vector<std::size_t> &groups = std::vector<std::size_t>(),
+        ThreadPool *pool = nullptr
+);
+
+//! the groups of k-fold cross validation, row i in fold i % k
+std::vector<std::size_t> foldGroups(std::size_t rows, std::size_t k);
+
+/**
+    @brief one group per input line of the conditions, i.e. leaving out a
+           condition line with all its rows, see ConditionSet::setLine()
+*/
+std::vector<std::size_t> lineGroups(const ConditionSet &ys);
+
+/**
+    @param g an arranged problem, see arrangeY()
+    @param x a full length `x` vector, e.g. from solve()
+    @return the residual of every row of `g`, i.e. of every condition
+*/
+std::vector<double> residual(const GllsProblem &g, const std::vector<double> &x);
 
 #endif
 
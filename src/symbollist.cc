@@ -2,6 +2,7 @@
 #include <string>
 #include <map>
 #include <cassert>
+#include <cstdint>
 
 bool SymbolList::insert(const std::string &s)
 {
@@ -26,3 +27,51 @@ int SymbolList::query(const std::string &s) const
     }
     return it->second;
 }
+
+static std::uint32_t hashSymbol(const char *s, std::size_t len)
+{
+    // FNV-1a with a final avalanche
+    std::uint32_t h = 2166136261u;
+    for (std::size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+FrozenSymbolList::FrozenSymbolList(const SymbolList &sl)
+    : size_(sl.size()), mask_(0)
+{
+    // at least half of the slots stay empty, which ends every probe
+    std::size_t cap = 1;
+    while (cap < 2 * size_ + 1) {
+        cap <<= 1;
+    }
+    mask_ = cap - 1;
+    slots_.assign(cap, Slot{0, 0, 0, -1});
+    for (const auto &p : sl) {
+        const std::uint32_t h = hashSymbol(p.first.data(), p.first.size());
+        std::size_t i = h & mask_;
+        while (slots_[i].id >= 0) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i] = Slot{names_.size(), p.first.size(), h, p.second};
+        names_ += p.first;
+    }
+}
+
+int FrozenSymbolList::query(const char *s, std::size_t len) const
+{
+    const std::uint32_t h = hashSymbol(s, len);
+    for (std::size_t i = h & mask_; slots_[i].id >= 0; i = (i + 1) & mask_) {
+        const Slot &slot = slots_[i];
+        if (slot.hash == h && slot.len == len
+                && names_.compare(slot.offset, len, s, len) == 0) {
+            return slot.id;
+        }
+    }
+    return -1;
+}
@@ -7,6 +7,9 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 /**
 * @brief A case sensitive symbol list, which count the symbols as their
@@ -23,10 +26,46 @@ public:
     std::string query_id(int) const = delete;
     void clear() { map_.clear(); nextID_ = 0; }
     size_t size() const { return map_.size(); }
+    typedef std::map<std::string, int>::const_iterator const_iterator;
+    const_iterator begin() const { return map_.cbegin(); }
+    const_iterator end() const { return map_.cend(); }
 private:
     int nextID_;
     std::map<std::string, int> map_;
 };
 
+/**
+* @brief An immutable snapshot of a SymbolList for the lookup of symbols
+*        given as raw character ranges.
+*
+* The symbols are stored in an open addressing table with linear probing,
+* filled to at most half, so the table is O(n) and built in O(n). A query
+* costs one hash and a short probe, and only a slot with the same hash and
+* length is compared as a string.
+*/
+class FrozenSymbolList
+{
+public:
+    explicit FrozenSymbolList(const SymbolList &);
+    //! @return non-negative id if found, otherwise negative
+    int query(const char *s, std::size_t len) const;
+    int query(const std::string &s) const { return query(s.data(), s.size()); }
+    size_t size() const { return size_; }
+private:
+    struct Slot
+    {
+        std::size_t offset;
+        std::size_t len;
+        std::uint32_t hash;
+        //! negative for an empty slot
+        int id;
+    };
+    std::size_t size_;
+    std::size_t mask_;
+    //! the concatenated symbol names, referred by the slots
+    std::string names_;
+    std::vector<Slot> slots_;
+};
+
 
 #endif //_GENERAL_LINEAR_LEAST_SQUARES_SYMBOLLIST_H_
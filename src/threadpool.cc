@@ -0,0 +1,206 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace {
+
+//! the pool and the index of the worker running on this thread
+thread_local const void *currentPool = nullptr;
+thread_local unsigned currentIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads)
+    : queued_(0), highQueued_(0), pending_(0), next_(0), stop_(false)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.emplace_back(new Queue);
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        threads_.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this]{ return pending_ == 0; });
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task, Priority priority)
+{
+    Queue *target = priority == Priority::HIGH ? &high_ : &low_;
+    if (priority == Priority::NORMAL) {
+        const unsigned index = currentPool == this
+                ? currentIndex
+                : next_.fetch_add(1) % queues_.size();
+        target = queues_[index].get();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++pending_;
+    }
+    {
+        Queue &q = *target;
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    if (priority == Priority::HIGH) {
+        ++highQueued_;
+    }
+    ++queued_;
+    {
+        // pairs with the predicate check of a worker going to sleep
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]{ return pending_ == 0; });
+    if (error_) {
+        std::exception_ptr e;
+        std::swap(e, error_);
+        std::rethrow_exception(e);
+    }
+}
+
+static bool popFront(std::mutex &mutex,
+        std::deque<std::function<void()> > &tasks, std::function<void()> &task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) {
+        return false;
+    }
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::pop(unsigned index, std::function<void()> &task)
+{
+    // spare the shared lock while there is no high priority task
+    if (highQueued_ > 0 && popFront(high_.mutex, high_.tasks, task)) {
+        --highQueued_;
+        return true;
+    }
+    {
+        Queue &q = *queues_[index];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t k = 1; k < queues_.size(); ++k) {
+        Queue &q = *queues_[(index + k) % queues_.size()];
+        if (popFront(q.mutex, q.tasks, task)) {
+            return true;
+        }
+    }
+    return popFront(low_.mutex, low_.tasks, task);
+}
+
+namespace {
+
+struct ForState
+{
+    const std::function<void(std::size_t)> *f;
+    std::size_t n;
+    std::atomic<std::size_t> next;
+    std::atomic<std::size_t> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+};
+
+//! take indices until none is left
+void forWork(ForState &s)
+{
+    std::size_t i;
+    while ((i = s.next++) < s.n) {
+        try {
+            (*s.f)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (!s.error) {
+                s.error = std::current_exception();
+            }
+        }
+        if (++s.done == s.n) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.finished.notify_all();
+        }
+    }
+}
+
+} // namespace
+
+void ThreadPool::parallelFor(
+        std::size_t n, const std::function<void(std::size_t)> &f)
+{
+    if (n == 0) {
+        return;
+    }
+    // helpers may start after the return, they find no index left then
+    const auto s = std::make_shared<ForState>();
+    s->f = &f;
+    s->n = n;
+    s->next = 0;
+    s->done = 0;
+    const std::size_t helpers = std::min<std::size_t>(n - 1, size());
+    for (std::size_t k = 0; k < helpers; ++k) {
+        submit([s]() { forWork(*s); });
+    }
+    forWork(*s);
+    std::unique_lock<std::mutex> lock(s->mutex);
+    s->finished.wait(lock, [&s]{ return s->done == s->n; });
+    if (s->error) {
+        std::rethrow_exception(s->error);
+    }
+}
+
+void ThreadPool::run(unsigned index)
+{
+    currentPool = this;
+    currentIndex = index;
+    std::function<void()> task;
+    while (true) {
+        if (!pop(index, task)) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]{ return stop_ || queued_ > 0; });
+            if (stop_ && queued_ == 0) {
+                return;
+            }
+            continue;
+        }
+        --queued_;
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        task = nullptr;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_) {
+            error_ = error;
+        }
+        if (--pending_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
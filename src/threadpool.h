@@ -0,0 +1,85 @@
+/**
+*   @file threadpool.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_THREADPOOL_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+    @brief work-stealing thread pool
+
+    Every worker owns a queue. A task submitted from a worker goes to the
+    back of its own queue and is taken from there first (LIFO, cache warm),
+    other tasks are distributed round robin. An idle worker steals from the
+    front of the other queues before it sleeps.
+
+    Tasks of high or low priority go to shared queues instead. A worker
+    takes a high priority task before any other, and a low priority task
+    only when there is nothing else to do.
+*/
+class ThreadPool
+{
+public:
+    enum class Priority { LOW, NORMAL, HIGH };
+    //! @param threads number of workers, 0 for the hardware concurrency
+    explicit ThreadPool(unsigned threads = 0);
+    //! waits for all submitted tasks
+    ~ThreadPool();
+    void submit(std::function<void()> task, Priority priority = Priority::NORMAL);
+    /**
+        @brief run f(0), ..., f(n-1) on the pool and the calling thread
+
+        The calling thread takes indices as well, so a task of the pool may
+        call this without waiting for a free worker. Returns when all calls
+        returned, the first exception is rethrown.
+    */
+    void parallelFor(std::size_t n, const std::function<void(std::size_t)> &f);
+    /**
+        @brief wait until all submitted tasks finished
+
+        Must not be called from a task. The first exception thrown by a
+        task since the last wait() is rethrown.
+    */
+    void wait();
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+private:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+    void run(unsigned index);
+    bool pop(unsigned index, std::function<void()> &task);
+    std::vector<std::unique_ptr<Queue> > queues_;
+    Queue high_;
+    Queue low_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    //! signalled when a task is queued or the pool stops
+    std::condition_variable wake_;
+    //! signalled when the last pending task finished
+    std::condition_variable idle_;
+    //! tasks in the queues
+    std::atomic<std::size_t> queued_;
+    //! tasks in high_
+    std::atomic<std::size_t> highQueued_;
+    //! tasks submitted and not finished, guarded by mutex_
+    std::size_t pending_;
+    std::atomic<unsigned> next_;
+    bool stop_;
+    std::exception_ptr error_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_THREADPOOL_H_
@@ -0,0 +1,108 @@
+#include "watch.h"
+#include "gllssession.h"
+#include "parsercommon.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void solveFile(
+        GllsSession &session,
+        const std::string &path,
+        std::ostream &out,
+        std::ostream &log
+)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        log << "failed to open " << path << std::endl;
+        return;
+    }
+    const std::string text(
+            (std::istreambuf_iterator<char>(is)),
+            std::istreambuf_iterator<char>());
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        session.update(text);
+        const auto xs = session.solve();
+        const std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+        for (const auto x : xs) {
+            out << x << ' ';
+        }
+        out << std::endl;
+        log << session.parsedLines() << " condition lines parsed, "
+            << (session.reusedFactorization() ? "factorization reused, "
+                                              : "factorized, ")
+            << elapsed.count() << " ms" << std::endl;
+    } catch (ParserError &e) {
+        log << "Error on input line "
+            << e.line() << ": " << e.what()
+            << std::endl;
+    }
+}
+
+} // namespace
+
+#ifdef __linux__
+
+int watchInput(const std::string &path, std::ostream &out, std::ostream &log)
+{
+    // editors often save by renaming a new file, so watch the directory
+    const auto slash = path.rfind('/');
+    const std::string dir =
+            slash == path.npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    const std::string name =
+            slash == path.npos ? path : path.substr(slash + 1);
+    const int fd = inotify_init();
+    if (fd < 0 || inotify_add_watch(
+            fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log << "failed to watch " << dir << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    GllsSession session;
+    solveFile(session, path, out, log);
+    std::vector<char> buf(64 * 1024);
+    while (true) {
+        const ssize_t n = read(fd, buf.data(), buf.size());
+        if (n <= 0) {
+            break;
+        }
+        bool changed = false;
+        for (ssize_t i = 0; i < n; ) {
+            const auto *e = reinterpret_cast<const inotify_event *>(&buf[i]);
+            if (e->len > 0 && name == e->name) {
+                changed = true;
+            }
+            i += sizeof(inotify_event) + e->len;
+        }
+        if (changed) {
+            solveFile(session, path, out, log);
+        }
+    }
+    close(fd);
+    return 1;
+}
+
+#else
+
+int watchInput(const std::string &, std::ostream &, std::ostream &log)
+{
+    log << "watching files is not supported on this platform" << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,21 @@
+/**
+*   @file watch.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_WATCH_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_WATCH_H_
+
+#include <iosfwd>
+#include <string>
+
+/**
+    @brief solve the input file, and solve it again whenever it is saved
+
+    The file is kept in a GllsSession, so only changed condition lines are
+    parsed again. Each solution is printed as one line to `out`, errors and
+    timings go to `log`. Runs until interrupted. Needs inotify (Linux).
+
+    @return the exit status if watching is not possible
+*/
+int watchInput(const std::string &path, std::ostream &out, std::ostream &log);
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_WATCH_H_
@@ -0,0 +1,127 @@
+#include "../src/batch.h"
+#include "../src/glls.h"
+#include "../src/threadpool.h"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Batch
+#endif
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Split) {
+        std::istringstream ss(
+                "x\ny\n1 2\ny0=1\n---\n\n  ---  \nx\ny\n3 4\n y0=2\n---\n");
+        const auto p = splitProblems(ss, "---");
+        BOOST_REQUIRE_EQUAL(p.size(), 2);
+        BOOST_CHECK_EQUAL(p[0], "x\ny\n1 2\ny0=1\n");
+        BOOST_CHECK_EQUAL(p[1], "x\ny\n3 4\n y0=2\n");
+    }
+
+    BOOST_AUTO_TEST_CASE(InOrder) {
+        std::vector<std::string> inputs;
+        for (int i = 0; i < 200; ++i) {
+            std::ostringstream os;
+            os << "x\ny\n1 2\n 3 4\n 5 6\n y0 = y1 = " << i << " = y2\n";
+            if (i % 7 == 3) {
+                os << "y9 = 0\n";
+            }
+            inputs.push_back(os.str());
+        }
+        ThreadPool pool(4);
+        std::size_t next = 0;
+        solveBatch(inputs.size(),
+                [&](std::size_t i) {
+                    if (i == 5) {
+                        throw std::runtime_error("failed to open");
+                    }
+                    return inputs[i];
+                },
+                pool,
+                [&](std::size_t i, const BatchResult &r) {
+                    BOOST_REQUIRE_EQUAL(i, next++);
+                    if (i == 5) {
+                        BOOST_CHECK_EQUAL(r.error, "failed to open");
+                    } else if (i % 7 == 3) {
+                        BOOST_CHECK(r.x.empty());
+                        BOOST_CHECK_EQUAL(r.error.find("Error on input line 7"), 0);
+                    } else {
+                        std::istringstream ss(inputs[i]);
+                        const auto x = glls(ss);
+                        BOOST_CHECK(r.error.empty());
+                        BOOST_REQUIRE_EQUAL(r.x.size(), x.size());
+                        for (std::size_t k = 0; k < x.size(); ++k) {
+                            BOOST_CHECK_CLOSE(r.x[k], x[k], 1e-9);
+                        }
+                    }
+                });
+        BOOST_CHECK_EQUAL(next, inputs.size());
+    }
+
+    BOOST_AUTO_TEST_CASE(Blocks) {
+        const std::string m = "x\ny\n1 2 1\n 3 4 2\n 5 6 4\n";
+        std::istringstream ss(m + "y0 = 1\n"
+                "[a]\ny1 = 2\n[none]\nx1 = 0\n[b]\nx0 = 3\ny2 = 0\n");
+        ThreadPool pool(3);
+        const auto r = solveBlocks(ss, pool);
+        BOOST_REQUIRE_EQUAL(r.size(), 3);
+        const char *const names[] = {"a", "none", "b"};
+        const char *const single[] = {
+            "y0 = 1\ny1 = 2\n", "y0 = 1\nx1 = 0\n", "y0 = 1\nx0 = 3\ny2 = 0\n"
+        };
+        for (int i = 0; i < 3; ++i) {
+            BOOST_CHECK_EQUAL(r[i].name, names[i]);
+            BOOST_CHECK(r[i].error.empty());
+            std::istringstream one(m + single[i]);
+            const auto x = glls(one);
+            BOOST_REQUIRE_EQUAL(r[i].x.size(), x.size());
+            for (std::size_t k = 0; k < x.size(); ++k) {
+                BOOST_CHECK_CLOSE(r[i].x[k], x[k], 1e-9);
+            }
+        }
+        {
+            // a block value of X replaces the common one
+            std::istringstream s2(m + "x0 = 1\ny0 = 1\n[a]\nx0 = 2\n");
+            const auto r2 = solveBlocks(s2, pool);
+            BOOST_REQUIRE_EQUAL(r2.size(), 1);
+            BOOST_REQUIRE_EQUAL(r2[0].x.size(), 3);
+            BOOST_CHECK_EQUAL(r2[0].x[0], 2);
+        }
+        {
+            std::istringstream s3(m + "[a]\nx0 = 1\n[b]\ny0 = 1\n");
+            const auto r3 = solveBlocks(s3, pool);
+            BOOST_REQUIRE_EQUAL(r3.size(), 2);
+            BOOST_CHECK(r3[0].x.empty());
+            BOOST_CHECK(!r3[0].error.empty());
+            BOOST_CHECK(r3[1].error.empty());
+        }
+        {
+            std::istringstream s4(m + "y0 = 1\n");
+            const auto r4 = solveBlocks(s4, pool);
+            BOOST_REQUIRE_EQUAL(r4.size(), 1);
+            BOOST_CHECK(r4[0].name.empty());
+            BOOST_CHECK_EQUAL(r4[0].x.size(), 3);
+        }
+        {
+            // from a task of a shared pool, leaving the error of another
+            // task to its own wait()
+            ThreadPool shared(1);
+            shared.submit([]() { throw std::runtime_error("other"); });
+            std::vector<BlockResult> r5;
+            shared.parallelFor(1, [&](std::size_t) {
+                std::istringstream s5(
+                        m + "y0 = 1\n[a]\ny1 = 2\n[b]\nx0 = 1\n");
+                r5 = solveBlocks(s5, shared);
+            });
+            BOOST_REQUIRE_EQUAL(r5.size(), 2);
+            BOOST_CHECK(r5[0].error.empty());
+            BOOST_CHECK(r5[1].error.empty());
+            BOOST_CHECK_THROW(shared.wait(), std::runtime_error);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
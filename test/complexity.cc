@@ -0,0 +1,188 @@
+#include "../src/gllsparser.h"
+#include "../src/gllsprofile.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Complexity
+#endif
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+//! an input of one X value, `rows` rows of M and the given conditions
+std::string withRows(int rows, const std::string &conditions)
+{
+    std::string s = "x\ny\n";
+    for (int r = 0; r < rows; ++r) {
+        s += "1\n";
+    }
+    return s + conditions + '\n';
+}
+
+//! y0 = 2*(y1 + 2*(y2 + ... 2*(yn)...))
+std::string deepProducts(int n)
+{
+    std::string c = "y0 = ";
+    for (int i = 1; i < n; ++i) {
+        c += "2*(y" + std::to_string(i) + " + ";
+    }
+    c += "y" + std::to_string(n) + std::string(n - 1, ')');
+    return withRows(n + 1, c);
+}
+
+//! 3*(y1 + y2 + ... + yn) = y0
+std::string productOfSum(int n)
+{
+    std::string c = "3*(y1";
+    for (int i = 2; i <= n; ++i) {
+        c += " + y" + std::to_string(i);
+    }
+    return withRows(n + 1, c + ") = y0");
+}
+
+//! y0 + 1 = y1 = y2 = ... = yn
+std::string longChain(int n)
+{
+    std::string c = "y0 + 1";
+    for (int i = 1; i <= n; ++i) {
+        c += " = y" + std::to_string(i);
+    }
+    return withRows(n + 1, c);
+}
+
+//! y0 + y1 - y2 + ... = 1
+std::string longSum(int n)
+{
+    std::string c = "y0";
+    for (int i = 1; i <= n; ++i) {
+        c += (i % 2 ? " + y" : " - y") + std::to_string(i);
+    }
+    return withRows(n + 1, c + " = 1");
+}
+
+//! one row of M with n coefficients
+std::string wideRow(int n)
+{
+    std::string s = "x\ny\n";
+    for (int i = 0; i < n; ++i) {
+        s += std::to_string(i % 97) + ".5 ";
+    }
+    return s + "\ny0 = 1\n";
+}
+
+struct Sample
+{
+    double n;
+    double seconds;
+    double allocations;
+};
+
+/**
+    @brief parse the inputs of the sizes n0, 2*n0, ... and collect the
+           fastest of a few runs and the allocations of each size
+
+    The time is the CPU time of the process, which other processes, e.g.
+    the tests of a parallel ctest, do not add to as they do to the wall time.
+*/
+std::vector<Sample> measure(
+        const std::function<std::string(int)> &input, int n0, int steps)
+{
+    // the allocations are counted by gllsalloc.cc while a profile is active
+    GllsProfile profile;
+    GllsProfile::setActive(&profile);
+    std::vector<Sample> samples;
+    for (int k = 0, n = n0; k < steps; ++k, n *= 2) {
+        const std::string s = input(n);
+        Sample sample = {double(n), 1e300, 0};
+        for (int rep = 0; rep < 3; ++rep) {
+            std::istringstream ss(s);
+            const auto a0 = GllsProfile::allocations();
+            const std::clock_t t0 = std::clock();
+            GllsParser(ss).run();
+            const double t = double(std::clock() - t0) / CLOCKS_PER_SEC;
+            sample.seconds = std::min(sample.seconds, t);
+            sample.allocations = double(GllsProfile::allocations() - a0);
+        }
+        samples.push_back(sample);
+    }
+    GllsProfile::setActive(nullptr);
+    return samples;
+}
+
+//! the slope of the least squares line through (log n, log f(n))
+double exponent(const std::vector<Sample> &samples, double Sample::*f)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto &s : samples) {
+        const double x = std::log(s.n);
+        const double y = std::log(s.*f);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    const double m = double(samples.size());
+    return (m * sxy - sx * sy) / (m * sxx - sx * sx);
+}
+
+/**
+    @brief check the empirical exponents of the time and of the allocations
+
+    The smallest size takes several milliseconds, well above the resolution
+    of std::clock(), and the bound of the time is loose, as the caches are
+    still shared with concurrent tests.
+*/
+void checkScaling(
+        const char *name,
+        const std::function<std::string(int)> &input,
+        int n0,
+        double maxTime,
+        double maxAllocations)
+{
+    const auto samples = measure(input, n0, 4);
+    const double t = exponent(samples, &Sample::seconds);
+    const double a = exponent(samples, &Sample::allocations);
+    BOOST_TEST_MESSAGE(name << ": time ~ n^" << t
+            << ", allocations ~ n^" << a << ", "
+            << samples[0].seconds * 1e3 << " ms at n = " << n0);
+    BOOST_CHECK_MESSAGE(t < maxTime,
+            name << ": time grows as n^" << t << ", expected below n^"
+            << maxTime);
+    BOOST_CHECK_MESSAGE(a < maxAllocations,
+            name << ": allocations grow as n^" << a << ", expected below n^"
+            << maxAllocations);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(DeepProducts) {
+        // a number times a sum stays unexpanded until the terms are listed,
+        // so every factor only multiplies the number in front of the sum
+        checkScaling("deep products", deepProducts, 2000, 1.5, 1.2);
+    }
+
+    BOOST_AUTO_TEST_CASE(ProductOfSum) {
+        checkScaling("product of a sum", productOfSum, 2000, 1.5, 1.2);
+    }
+
+    BOOST_AUTO_TEST_CASE(LongChain) {
+        checkScaling("long chain", longChain, 2000, 1.5, 1.2);
+    }
+
+    BOOST_AUTO_TEST_CASE(LongSum) {
+        checkScaling("long sum", longSum, 2000, 1.5, 1.2);
+    }
+
+    BOOST_AUTO_TEST_CASE(WideRow) {
+        checkScaling("wide row", wideRow, 8000, 1.5, 1.2);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,211 @@
+#include "../src/conditionset.h"
+#include <sstream>
+#include <string>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ConditionSet
+#endif
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(ctor) {
+        ConditionSet cs;
+        BOOST_CHECK(cs.empty());
+        BOOST_CHECK_EQUAL(cs.size(), 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(SortAndMerge) {
+        ConditionSet cs;
+        cs.addTerm(5, 1.0);
+        cs.addConstant(2.0);
+        cs.addTerm(1, 3.0);
+        cs.addTerm(5, -0.5);
+        cs.addConstant(1.0);
+        cs.endRow();
+        BOOST_REQUIRE_EQUAL(cs.size(), 1);
+        BOOST_REQUIRE_EQUAL(cs.rowEnd(0) - cs.rowBegin(0), 2);
+        BOOST_CHECK_EQUAL(cs.ids()[0], 1);
+        BOOST_CHECK_EQUAL(cs.coefs()[0], 3.0);
+        BOOST_CHECK_EQUAL(cs.ids()[1], 5);
+        BOOST_CHECK_EQUAL(cs.coefs()[1], 0.5);
+        BOOST_CHECK_EQUAL(cs.constants()[0], 3.0);
+    }
+
+    BOOST_AUTO_TEST_CASE(Rows) {
+        ConditionSet cs;
+        cs.addTerm(0, 1.0);
+        cs.endRow();
+        cs.endRow();
+        cs.addTerm(2, 1.0);
+        cs.addTerm(3, 1.0);
+        cs.addConstant(-1.0);
+        cs.endRow();
+        BOOST_REQUIRE_EQUAL(cs.size(), 3);
+        BOOST_CHECK_EQUAL(cs.rowBegin(1), cs.rowEnd(1));
+        BOOST_CHECK_EQUAL(cs.rowBegin(2), 1);
+        BOOST_CHECK_EQUAL(cs.rowEnd(2), 3);
+        BOOST_CHECK_EQUAL(cs.constants()[1], 0.0);
+        BOOST_CHECK_EQUAL(cs.constants()[2], -1.0);
+    }
+
+    BOOST_AUTO_TEST_CASE(AppendAndClear) {
+        ConditionSet a, b;
+        a.addTerm(1, 1.0);
+        a.endRow();
+        b.addTerm(7, 2.0);
+        b.addTerm(8, 3.0);
+        b.addConstant(4.0);
+        b.endRow();
+        b.addTerm(9, 5.0);
+        b.endRow();
+        a.append(b);
+        BOOST_REQUIRE_EQUAL(a.size(), 3);
+        BOOST_CHECK_EQUAL(a.rowBegin(1), 1);
+        BOOST_CHECK_EQUAL(a.rowEnd(1), 3);
+        BOOST_CHECK_EQUAL(a.rowEnd(2), 4);
+        BOOST_CHECK_EQUAL(a.ids()[3], 9);
+        BOOST_CHECK_EQUAL(a.constants()[1], 4.0);
+        a.clear();
+        BOOST_CHECK(a.empty());
+        a.addTerm(3, 1.0);
+        a.endRow();
+        BOOST_CHECK_EQUAL(a.rowBegin(0), 0);
+        BOOST_CHECK_EQUAL(a.rowEnd(0), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(Family) {
+        ConditionSet a, b;
+        a.addTerm(1, 1.0);
+        a.endRow();
+        b.addTerm(0, 1.0);
+        b.endRow();
+        b.addFamilyTerm(4, 2, 1.0);
+        b.addFamilyTerm(1, 0, -1.0);
+        b.endFamilyRow(0.5);
+        b.endFamily(3);
+        b.addTerm(9, 1.0);
+        b.endRow();
+        a.append(b);
+        BOOST_CHECK_EQUAL(a.size(), 3);
+        BOOST_CHECK_EQUAL(a.expandedSize(), 6);
+        BOOST_REQUIRE_EQUAL(a.families().size(), 1);
+        BOOST_CHECK_EQUAL(a.families()[0].position, 2);
+        std::vector<int> firstIds;
+        std::vector<double> constants;
+        a.forEachRow([&](const ConditionSet::RowView &r) {
+            BOOST_REQUIRE(r.size > 0);
+            firstIds.push_back(r.ids[0]);
+            constants.push_back(r.constant);
+        });
+        const std::vector<int> expected = {1, 0, 4, 6, 8, 9};
+        BOOST_CHECK_EQUAL_COLLECTIONS(firstIds.begin(), firstIds.end(),
+                expected.begin(), expected.end());
+        BOOST_CHECK_EQUAL(constants[3], 0.5);
+        a.clear();
+        BOOST_CHECK(a.empty());
+        BOOST_CHECK_EQUAL(a.expandedSize(), 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(Ranges) {
+        ConditionSet a, b;
+        a.addRange(0, 10, 3, 0.1);
+        a.endRow();
+        b.addTerm(1, 1.0);
+        b.endRow();
+        b.addRange(2, 5, 1, 1.0);
+        b.addRange(4, 2, 2, -1.0);
+        b.endRow();
+        a.append(b);
+        BOOST_REQUIRE_EQUAL(a.size(), 3);
+        BOOST_CHECK_EQUAL(a.rangeEnd(0) - a.rangeBegin(0), 1);
+        BOOST_CHECK_EQUAL(a.rangeEnd(1) - a.rangeBegin(1), 0);
+        BOOST_CHECK_EQUAL(a.rangeBegin(2), 1);
+        BOOST_CHECK_EQUAL(a.rangeEnd(2), 3);
+        BOOST_CHECK_EQUAL(a.ranges()[2].stride, 2);
+        std::size_t total = 0;
+        a.forEachRow([&](const ConditionSet::RowView &r) {
+            total += r.rangeCount;
+        });
+        BOOST_CHECK_EQUAL(total, 3);
+    }
+
+    BOOST_AUTO_TEST_CASE(WriteAndRead) {
+        ConditionSet a, b;
+        a.setLine(7);
+        a.addTerm(3, 2.0);
+        a.addRange(0, 4, 2, 0.25);
+        a.addConstant(-1.0);
+        a.endRow();
+        a.addFamilyTerm(4, 2, 1.0);
+        a.endFamilyRow(0.5);
+        a.setLine(9);
+        a.endFamily(3);
+        std::stringstream ss;
+        a.write(ss);
+        // the family reaches row 8 of M
+        std::istringstream stale(ss.str());
+        BOOST_CHECK(!b.read(stale, 8));
+        BOOST_CHECK(b.empty());
+        BOOST_REQUIRE(b.read(ss, 9));
+        BOOST_CHECK_EQUAL(b.size(), 1);
+        BOOST_CHECK_EQUAL(b.expandedSize(), 4);
+        BOOST_CHECK(b.ids() == a.ids());
+        BOOST_CHECK(b.coefs() == a.coefs());
+        BOOST_CHECK(b.constants() == a.constants());
+        BOOST_REQUIRE_EQUAL(b.ranges().size(), 1);
+        BOOST_CHECK_EQUAL(b.ranges()[0].stride, 2);
+        BOOST_CHECK(b.familyIds() == a.familyIds());
+        BOOST_CHECK(b.familyConstants() == a.familyConstants());
+        BOOST_CHECK(b.lines() == a.lines());
+        BOOST_CHECK_EQUAL(b.lineOf(0), 7);
+        // appending after a read keeps the family offsets
+        b.append(a);
+        BOOST_CHECK_EQUAL(b.expandedSize(), 8);
+        const std::string data = ss.str();
+        std::istringstream truncated(data.substr(0, data.size() / 2));
+        BOOST_CHECK(!b.read(truncated, 9));
+        BOOST_CHECK(b.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(Lines) {
+        ConditionSet a;
+        a.addTerm(0, 1.0);
+        a.endRow();
+        a.setLine(5);
+        a.addTerm(1, 1.0);
+        a.endRow();
+        a.addTerm(2, 1.0);
+        a.endRow();
+        a.setLine(6);
+        a.setLine(7);
+        a.addFamilyTerm(4, 2, 1.0);
+        a.endFamilyRow(0.0);
+        a.endFamily(3);
+        BOOST_CHECK_EQUAL(a.expandedSize(), 6);
+        const int expected[] = {0, 5, 5, 7, 7, 7};
+        for (std::size_t r = 0; r < 6; ++r) {
+            BOOST_CHECK_EQUAL(a.lineOf(r), expected[r]);
+        }
+        ConditionSet b;
+        b.setLine(1);
+        b.addTerm(0, 1.0);
+        b.endRow();
+        b.append(a);
+        BOOST_CHECK_EQUAL(b.expandedSize(), 7);
+        BOOST_CHECK_EQUAL(b.lineOf(0), 1);
+        BOOST_CHECK_EQUAL(b.lineOf(1), 1);
+        BOOST_CHECK_EQUAL(b.lineOf(2), 5);
+        BOOST_CHECK_EQUAL(b.lineOf(6), 7);
+        // the lines of `a` are replaced
+        b.append(a, 9);
+        BOOST_CHECK_EQUAL(b.expandedSize(), 13);
+        BOOST_CHECK_EQUAL(b.lineOf(6), 7);
+        BOOST_CHECK_EQUAL(b.lineOf(7), 9);
+        BOOST_CHECK_EQUAL(b.lineOf(12), 9);
+        b.clear();
+        BOOST_CHECK_EQUAL(b.expandedSize(), 0);
+        BOOST_CHECK(b.lines().empty());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 #include "../src/condparser.h"
 #include "../src/condtree.h"
 #include <sstream>
+#include <cstring>
 
 #ifndef BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE GllsParser
@@ -278,6 +279,96 @@ BOOST_AUTO_TEST_SUITE(TestCondLexer)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(TestRange) {
+        const std::string s = "  br0*-2.5e1 = (phi2)z0";
+        auto sl = SymbolList();
+        sl.insert("bz");
+        sl.insert("br");
+        sl.insert("phi");
+        // stop before the last symbol
+        CondLexer lexer(s.data(), s.data() + s.size() - 2, CondDict(sl, "x"));
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_ID);
+        BOOST_CHECK_EQUAL(lexer.symbol(), 1);
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_OP);
+        BOOST_CHECK_EQUAL(lexer.symbol(), '*');
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_OP);
+        BOOST_CHECK_EQUAL(lexer.symbol(), '-');
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_NUM);
+        BOOST_CHECK_EQUAL(lexer.num(), 25.0);
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_OP);
+        BOOST_CHECK_EQUAL(lexer.symbol(), '=');
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_OP);
+        BOOST_CHECK_EQUAL(lexer.symbol(), '(');
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_ID);
+        BOOST_CHECK_EQUAL(lexer.symbol(), 8);
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_OP);
+        BOOST_CHECK_EQUAL(lexer.symbol(), ')');
+        BOOST_CHECK(lexer.token() == CondLexer::Token::TK_EOF);
+    }
+
+    BOOST_AUTO_TEST_CASE(TestFamily) {
+        const std::string s = "for k in 2..10 : y{k} z{2*k-1} y{ 3 } x4 y7";
+        auto sl = SymbolList();
+        sl.insert("y");
+        sl.insert("z");
+        CondLexer lexer(s.data(), s.data() + s.size(), CondDict(sl, "x"));
+        BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_FOR);
+        BOOST_REQUIRE(lexer.isFamily());
+        const auto &f = lexer.family();
+        BOOST_CHECK_EQUAL(f.var, "k");
+        BOOST_CHECK_EQUAL(f.first, 2);
+        BOOST_CHECK_EQUAL(f.last, 10);
+        for (int i = 0; i < 5; ++i) {
+            BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_ID);
+            BOOST_CHECK_EQUAL(lexer.symbol(), i);
+        }
+        BOOST_CHECK(lexer.token() == CondLexer::Token::TK_EOF);
+        BOOST_REQUIRE_EQUAL(f.terms.size(), 5);
+        BOOST_CHECK_EQUAL(f.terms[0].id0, 0);
+        BOOST_CHECK_EQUAL(f.terms[0].scale, 1);
+        BOOST_CHECK_EQUAL(f.terms[0].offset, 0);
+        BOOST_CHECK_EQUAL(f.terms[1].id0, 1);
+        BOOST_CHECK_EQUAL(f.terms[1].scale, 2);
+        BOOST_CHECK_EQUAL(f.terms[1].offset, -1);
+        BOOST_CHECK_EQUAL(f.terms[2].scale, 0);
+        BOOST_CHECK_EQUAL(f.terms[2].offset, 3);
+        BOOST_CHECK_EQUAL(
+                f.terms[3].id0, static_cast<int>(CondDict::ID_X_VAR_NEG_BASE));
+        BOOST_CHECK_EQUAL(f.terms[3].offset, 4);
+        BOOST_CHECK_EQUAL(f.terms[4].offset, 7);
+    }
+
+    BOOST_AUTO_TEST_CASE(TestFamily_Invalid) {
+        const char *buf[] = {
+                "for 0..2: y{i}",
+                "for i 0..2: y{i}",
+                "for i in 0.2: y{i}",
+                "for i in 0..2 y{i}",
+                "for i in 3..2: y{i}",
+                "y{0}",
+        };
+        auto sl = SymbolList();
+        sl.insert("y");
+        for (const auto s : buf) {
+            BOOST_TEST_CHECKPOINT("lexing " << s);
+            CondLexer lexer(s, s + std::strlen(s), CondDict(sl, "x"));
+            BOOST_CHECK(lexer.token() == CondLexer::Token::TK_INVALID);
+        }
+        const char *body[] = {
+                "for i in 0..2: y{j}",
+                "for i in 0..2: y{i+}",
+                "for i in 0..2: y{2*}",
+                "for i in 0..2: y{i",
+                "for i in 0..2: w{i}",
+        };
+        for (const auto s : body) {
+            BOOST_TEST_CHECKPOINT("lexing " << s);
+            CondLexer lexer(s, s + std::strlen(s), CondDict(sl, "x"));
+            BOOST_REQUIRE(lexer.token() == CondLexer::Token::TK_FOR);
+            BOOST_CHECK(lexer.token() == CondLexer::Token::TK_INVALID);
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(TestCondParser)
@@ -429,4 +520,29 @@ BOOST_AUTO_TEST_SUITE(TestCondParser)
             );
     }
 
+    BOOST_AUTO_TEST_CASE(Family) {
+        const std::string s = "for i in 0..3: y{i} = 2*y{i+1} = 5";
+        auto sl = SymbolList();
+        sl.insert("y");
+        CondParser p(s.data(), s.data() + s.size(), CondDict(sl, "x"));
+        const auto t = p.parse();
+        BOOST_CHECK_EQUAL(t.size(), 2);
+        BOOST_REQUIRE(p.isFamily());
+        BOOST_CHECK_EQUAL(p.family().terms.size(), 2);
+    }
+
+    BOOST_AUTO_TEST_CASE(InvalidCase_FamilyInside) {
+            auto sl = SymbolList();
+            sl.insert("y");
+            char s[] = "y0 = for i in 0..2: y{i}";
+            std::istringstream ss(s);
+            BOOST_CHECK_EXCEPTION(
+                CondParser(ss, sl, "x").parse(),
+                ParserError,
+                [](const ParserError &e) {
+                    return e.type() == ParserError::Type::UNEXPECTED_CHAR;
+                }
+            );
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
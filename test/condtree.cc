@@ -238,4 +238,65 @@ BOOST_AUTO_TEST_SUITE(TestValidForm)
         BOOST_CHECK(isEqual(toList(xs[0]), toList(xs[1])));
     }
 
+    BOOST_AUTO_TEST_CASE(TestEqual_ScaledSum) {
+        std::istringstream ss(
+                "z0 = 2*(y0 + 3*(y1 + sum(y2..y3)) - 1)*4"
+                "   = 8*y0 + 24*y1 + 24*y2 + 24*y3 - 8"
+        );
+        auto sl = SymbolList();
+        sl.insert("y");
+        sl.insert("z");
+        auto xs = CondParser(ss, sl, "x").parse();
+        BOOST_REQUIRE_EQUAL(xs.size(), 2);
+        BOOST_CHECK(finalizeTree(xs[0]) == FinalizationStatus::SUCCESS);
+        BOOST_CHECK(finalizeTree(xs[1]) == FinalizationStatus::SUCCESS);
+        BOOST_CHECK(isFinalForm(xs[0]));
+        BOOST_CHECK(isEqual(toList(xs[0]), toList(xs[1])));
+    }
+
+    BOOST_AUTO_TEST_CASE(TestScaledSum_Product) {
+        // a scaled sum times a symbol or another sum is still rejected
+        for (const char *c : {"z0 = y1*(2*(y0 + 1))",
+                "z0 = (2*(y0 + 1))*(3*(y1 + 1))"}) {
+            std::istringstream ss(c);
+            auto sl = SymbolList();
+            sl.insert("y");
+            sl.insert("z");
+            auto xs = CondParser(ss, sl, "x").parse();
+            BOOST_CHECK(finalizeTree(xs[0]) != FinalizationStatus::SUCCESS);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(TestRange) {
+        std::istringstream ss(
+                "z0 = 2*sum(y0..y2)/4 - y1 = mean(y0..y3) + 1"
+        );
+        auto sl = SymbolList();
+        sl.insert("y");
+        sl.insert("z");
+        auto xs = CondParser(ss, sl, "x").parse();
+        BOOST_REQUIRE_EQUAL(xs.size(), 2);
+        BOOST_REQUIRE(finalizeTree(xs[0]) == FinalizationStatus::SUCCESS);
+        BOOST_REQUIRE(finalizeTree(xs[1]) == FinalizationStatus::SUCCESS);
+        BOOST_CHECK(isFinalForm(xs[0]));
+        // z0 - 0.5*(y0+y1+y2) + y1
+        const std::vector<std::pair<int, double> > l0 =
+            {{0, -0.5}, {1, 1.0}, {2, 0.5}, {4, -0.5}};
+        BOOST_CHECK(isEqual(toList(xs[0]), l0));
+        // z0 - 0.25*(y0+y1+y2+y3) - 1
+        const std::vector<std::pair<int, double> > l1 =
+            {{-1, -1.0}, {0, -0.25}, {1, 1.0}, {2, -0.25}, {4, -0.25},
+             {6, -0.25}};
+        BOOST_CHECK(isEqual(toList(xs[1]), l1));
+    }
+
+    BOOST_AUTO_TEST_CASE(TestRange_HighOrder) {
+        std::istringstream ss("z0 = sum(y0..y2)*y1");
+        auto sl = SymbolList();
+        sl.insert("y");
+        sl.insert("z");
+        auto xs = CondParser(ss, sl, "x").parse();
+        BOOST_CHECK(finalizeTree(xs[0]) == FinalizationStatus::HIGH_ORDER);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+#include "../tools/generator.h"
+#include "../src/glls.h"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Generator
+#endif
+#include <boost/test/unit_test.hpp>
+
+static void checkPlanted(const GeneratorOptions &o)
+{
+    std::stringstream ss;
+    const auto planted = generateInput(ss, o);
+    BOOST_REQUIRE_EQUAL(planted.size(), o.xSize);
+    const auto x = glls(ss);
+    BOOST_REQUIRE_EQUAL(x.size(), planted.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        BOOST_CHECK_SMALL(x[i] - planted[i], 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Tall) {
+        GeneratorOptions o;
+        o.xSize = 8;
+        o.rows = 200;
+        o.conditions = 20;
+        checkPlanted(o);
+        o.seed = 7;
+        o.names = 1;
+        o.fixed = 3;
+        o.depth = 5;
+        checkPlanted(o);
+    }
+
+    BOOST_AUTO_TEST_CASE(Wide) {
+        GeneratorOptions o;
+        // the rank is at most rows + fixed
+        o.xSize = 30;
+        o.rows = 12;
+        o.names = 4;
+        o.conditions = 40;
+        o.fixed = 18;
+        checkPlanted(o);
+    }
+
+    BOOST_AUTO_TEST_CASE(Sparse) {
+        GeneratorOptions o;
+        o.xSize = 10;
+        o.rows = 500;
+        o.density = 0.2;
+        o.conditions = 60;
+        o.plain = 0;
+        o.aggregate = 0;
+        checkPlanted(o);
+    }
+
+    BOOST_AUTO_TEST_CASE(Deterministic) {
+        GeneratorOptions o;
+        o.rows = 30;
+        std::ostringstream a, b;
+        generateInput(a, o);
+        generateInput(b, o);
+        BOOST_CHECK(a.str() == b.str());
+        o.seed = 2;
+        std::ostringstream c;
+        generateInput(c, o);
+        BOOST_CHECK(a.str() != c.str());
+    }
+
+    BOOST_AUTO_TEST_CASE(InvalidOptions) {
+        std::ostringstream os;
+        GeneratorOptions o;
+        o.density = 0;
+        BOOST_CHECK_THROW(generateInput(os, o), std::invalid_argument);
+        o = GeneratorOptions();
+        o.fixed = o.xSize + 1;
+        BOOST_CHECK_THROW(generateInput(os, o), std::invalid_argument);
+        o = GeneratorOptions();
+        o.plain = o.nested = o.chained = o.aggregate = 0;
+        BOOST_CHECK_THROW(generateInput(os, o), std::invalid_argument);
+        BOOST_CHECK(os.str().empty());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,7 +5,12 @@
 #include "../src/solveglls.h"
 #include "../src/gllsparser.h"
 #include "../src/glls.h"
+#include "../src/threadpool.h"
+#include <cmath>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #ifndef BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE Glls
@@ -37,7 +42,7 @@ BOOST_AUTO_TEST_SUITE()
         );
         GllsParser gp(ss, true);
         GllsProblem g;;
-        BOOST_REQUIRE_NO_THROW(g = gp.run())
+        BOOST_REQUIRE_NO_THROW(g = gp.run());
         arrangeX(g, gp.xValues());
         BOOST_CHECK_CLOSE(g.coef[2], -7.0, 1e-9);
         BOOST_CHECK_CLOSE(g.coef[5], -12.0, 1e-9);
@@ -58,6 +63,230 @@ BOOST_AUTO_TEST_SUITE()
         BOOST_CHECK_CLOSE(g.coef[4], 0.0, 1e-9);
     }
 
+    BOOST_AUTO_TEST_CASE(Sweep) {
+        const std::string m =
+                "x\ny\n1 2 3 1\n 2 -1 4 0\n 3 1 1 2\n 0 2 5 1\n 1 1 1 3\n";
+        // least squares, exact and minimum norm without x1
+        const char *const conds[] = {
+            "x3 = 0.5\n y0 = 1\n y1 = 2\n y2 = -1\n y3 = 4\n y4 = 0\n",
+            "x3 = 0.5\n y0 = 1\n y1 + y4 = 2\n",
+            "y2 - y3 = 3\n",
+        };
+        const std::vector<double> values = {-2, 0, 0.25, 3};
+        ThreadPool pool(2);
+        for (const char *c : conds) {
+            std::istringstream ss(m + c);
+            GllsParser gp(ss, true);
+            auto g = gp.run();
+            arrangeX(g, gp.xValues());
+            arrangeY(g, gp.yConds());
+            for (ThreadPool *p : {static_cast<ThreadPool *>(nullptr), &pool}) {
+                const auto xs = sweepX(g, 1, values, p);
+                BOOST_REQUIRE_EQUAL(xs.size(), values.size());
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    std::istringstream again(m + c);
+                    GllsParser direct(again, true);
+                    auto h = direct.run();
+                    auto fixed = direct.xValues();
+                    fixed.emplace_back(1, values[i]);
+                    arrangeX(h, fixed);
+                    arrangeY(h, direct.yConds());
+                    const auto x = solve(h);
+                    BOOST_REQUIRE_EQUAL(xs[i].size(), x.size());
+                    for (std::size_t k = 0; k < x.size(); ++k) {
+                        BOOST_CHECK_SMALL(xs[i][k] - x[k], 1e-9);
+                    }
+                    BOOST_CHECK_EQUAL(xs[i][1], values[i]);
+                }
+            }
+        }
+
+        std::istringstream ss(m + conds[0]);
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        BOOST_CHECK_THROW(sweepX(g, 3, values), std::invalid_argument);
+        BOOST_CHECK_THROW(sweepX(g, 4, values), std::invalid_argument);
+        BOOST_CHECK(sweepX(g, 0, {}).empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(CrossValidation) {
+        std::istringstream ss(
+                "x\ny\n1 2 1\n 2 -1 0\n 3 1 2\n 0 2 1\n 1 1 3\n 2 0 1\n"
+                " y0 = 1\n y1 = 2 = y2 - 1\n y3 = 4\n y4 = 0\n"
+                " for i in 0..0: y{i+5} = -1\n");
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        const std::size_t rows = 6;
+        const std::size_t cols = g.xSize + 1;
+        BOOST_REQUIRE_EQUAL(g.coef.size(), rows * cols);
+        const auto f = factorize(g);
+        // the residuals of the rows of `out` in a refit without them
+        const auto refit = [&](const std::vector<std::size_t> &groups,
+                std::size_t group) {
+            GllsProblem h;
+            h.xSize = g.xSize;
+            for (std::size_t row = 0; row < rows; ++row) {
+                if (groups[row] != group) {
+                    h.coef.insert(h.coef.end(), g.coef.begin() + row*cols,
+                            g.coef.begin() + (row+1)*cols);
+                }
+            }
+            return residual(g, solve(h));
+        };
+        const auto check = [&](const std::vector<std::size_t> &groups) {
+            ThreadPool pool(2);
+            const auto cv = crossValidate(f, g, groups, &pool);
+            std::vector<std::size_t> single(rows);
+            for (std::size_t row = 0; row < rows; ++row) {
+                single[row] = row;
+            }
+            const auto &gs = groups.empty() ? single : groups;
+            double press = 0;
+            for (std::size_t row = 0; row < rows; ++row) {
+                const double e = refit(gs, gs[row])[row];
+                BOOST_CHECK_CLOSE(cv.left[row], e, 1e-6);
+                press += e * e;
+            }
+            BOOST_CHECK_CLOSE(cv.press, press, 1e-6);
+            return cv;
+        };
+        const auto loo = check({});
+        double trace = 0;
+        for (std::size_t row = 0; row < rows; ++row) {
+            BOOST_CHECK_CLOSE(loo.left[row],
+                    loo.residual[row] / (1 - loo.leverage[row]), 1e-9);
+            trace += loo.leverage[row];
+        }
+        // the trace of the hat matrix is the number of free X values
+        BOOST_CHECK_CLOSE(trace, g.xSize, 1e-9);
+        check(foldGroups(rows, 3));
+
+        // y1 = 2 = y2 - 1 has two rows, left out together
+        const auto lines = lineGroups(gp.yConds());
+        const std::vector<std::size_t> expected = {0, 1, 1, 2, 3, 4};
+        BOOST_CHECK_EQUAL_COLLECTIONS(lines.begin(), lines.end(),
+                expected.begin(), expected.end());
+        const auto cv = check(lines);
+        const auto byLine = residualByLine(cv.left, gp.yConds());
+        BOOST_REQUIRE_EQUAL(byLine.size(), 5);
+        BOOST_CHECK_EQUAL(byLine[1].first, 10);
+        BOOST_CHECK_CLOSE(byLine[1].second,
+                std::hypot(cv.left[1], cv.left[2]), 1e-9);
+
+        // the other rows do not determine X
+        const auto few = crossValidate(f, g, {0, 0, 0, 0, 0, 1});
+        BOOST_CHECK(std::isnan(few.left[0]));
+        BOOST_CHECK(!std::isnan(few.left[5]));
+        BOOST_CHECK_THROW(crossValidate(f, g, {0, 1}), std::invalid_argument);
+    }
+
+    BOOST_AUTO_TEST_CASE(CrossValidation_Downdate) {
+        // folds of five rows of two unknowns, from the downdated normal matrix
+        GllsProblem g;
+        g.xSize = 2;
+        const std::size_t rows = 10;
+        for (std::size_t row = 0; row < rows; ++row) {
+            g.coef.insert(g.coef.end(),
+                    {1.0 + row % 3, 2.0 - row * 0.5, std::sin(row + 1.0)});
+        }
+        const auto groups = foldGroups(rows, 2);
+        const auto cv = crossValidate(factorize(g), g, groups);
+        for (std::size_t fold = 0; fold < 2; ++fold) {
+            GllsProblem h;
+            h.xSize = g.xSize;
+            for (std::size_t row = 0; row < rows; ++row) {
+                if (groups[row] != fold) {
+                    h.coef.insert(h.coef.end(), g.coef.begin() + row*3,
+                            g.coef.begin() + (row+1)*3);
+                }
+            }
+            const auto r = residual(g, solve(h));
+            for (std::size_t row = fold; row < rows; row += 2) {
+                BOOST_CHECK_CLOSE(cv.left[row], r[row], 1e-6);
+            }
+        }
+        const auto loo = crossValidate(factorize(g), g);
+        for (std::size_t row = 0; row < rows; ++row) {
+            BOOST_CHECK_CLOSE(cv.leverage[row], loo.leverage[row], 1e-9);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(Covariance) {
+        // the columns are scaled such that the LU factors pivot
+        std::istringstream ss(
+                "x\ny\n1 20 3 1\n 2 -10 4 0\n 3 10 1 2\n 0 20 5 1\n"
+                " 1 10 1 3\n 2 0 1 1\n x2 = 0.5\n y0 = 0\n y1 = 1\n y2 = 2\n"
+                " y3 = 3\n y4 = 4\n y5 = 5\n");
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        const std::size_t rows = 6;
+        const std::size_t n = g.xSize;
+        const std::size_t cols = n + 1;
+        std::vector<std::pair<int, int> > entries;
+        const int free[] = {0, 1, 3};
+        for (const int i : free) {
+            for (const int j : free) {
+                entries.emplace_back(i, j);
+            }
+        }
+        entries.emplace_back(2, 1);
+        GllsCovariance cov;
+        const auto x = solve(g, cov, entries, nullptr, true);
+        const auto f = factorize(g);
+        bool pivoted = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            pivoted = pivoted || f.pivots[i] != i;
+        }
+        BOOST_CHECK(pivoted);
+
+        // A^T*A times the entries is the identity
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                double v = 0;
+                for (std::size_t k = 0; k < n; ++k) {
+                    double gram = 0;
+                    for (std::size_t r = 0; r < rows; ++r) {
+                        gram += g.coef[r*cols + i] * g.coef[r*cols + k];
+                    }
+                    v += gram * cov.entries[k*n + j];
+                }
+                BOOST_CHECK_SMALL(v - (i == j), 1e-9);
+            }
+        }
+        BOOST_REQUIRE_EQUAL(cov.diagonal.size(), 4);
+        BOOST_CHECK_EQUAL(cov.diagonal[2], 0.0);
+        BOOST_CHECK_EQUAL(cov.entries.back(), 0.0);
+        for (std::size_t i = 0; i < n; ++i) {
+            BOOST_CHECK_CLOSE(cov.diagonal[free[i]], cov.entries[i*n + i],
+                    1e-9);
+            BOOST_CHECK_GT(cov.diagonal[free[i]], 0.0);
+        }
+        double sumSquares = 0;
+        for (const double r : residual(g, x)) {
+            sumSquares += r * r;
+        }
+        BOOST_CHECK_CLOSE(cov.sigma2, sumSquares / (rows - n), 1e-9);
+        // the entries alone, from their rows and columns only
+        const auto some = covariance(f, g, {{3, 1}, {0, 0}, {2, 0}});
+        BOOST_CHECK(some.diagonal.empty());
+        BOOST_REQUIRE_EQUAL(some.entries.size(), 3);
+        BOOST_CHECK_CLOSE(some.entries[0], cov.entries[2*n + 1], 1e-9);
+        BOOST_CHECK_CLOSE(some.entries[1], cov.diagonal[0], 1e-9);
+        BOOST_CHECK_EQUAL(some.entries[2], 0.0);
+        GllsCovariance only;
+        solve(g, only, {{0, 0}});
+        BOOST_CHECK(only.diagonal.empty());
+        BOOST_CHECK_CLOSE(only.entries[0], cov.diagonal[0], 1e-9);
+        BOOST_CHECK_CLOSE(only.sigma2, cov.sigma2, 1e-9);
+        BOOST_CHECK_THROW(covariance(f, g, {{0, 4}}), std::invalid_argument);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(TestSystem)
@@ -105,5 +334,106 @@ BOOST_AUTO_TEST_SUITE(TestSystem)
         BOOST_CHECK_CLOSE(x[1], 2, 1e-9);
     }
 
+    BOOST_AUTO_TEST_CASE(Glls_Family) {
+        const std::string head =
+                "x\ny z\n1 2 3\n 3 4 1\n 5 6 2\n 7 8 -1\n 2 1 1\n 0 4 2\n"
+                "2 2 7\n 1 9 3\n";
+        std::istringstream plain(head +
+                "y0 = 1\n y1 = z0 = 2\n y2 = z1 = 2\n y3 = z2 = 2\n"
+                "x1 = 0.5\n z3 = 1");
+        std::istringstream family(head +
+                "y0 = 1\n for i in 1..3 : y{i} = z{i-1} = 2\n"
+                "for n in 0..0: x{n+1} = 0.5\n z3 = 1");
+        const auto a = glls(plain);
+        const auto b = glls(family);
+        BOOST_REQUIRE_EQUAL(a.size(), 3);
+        BOOST_REQUIRE_EQUAL(b.size(), 3);
+        for (int i = 0; i < 3; ++i) {
+            BOOST_CHECK_CLOSE(a[i], b[i], 1e-9);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(Glls_Aggregate) {
+        const std::string head =
+                "x\ny z\n1 2 3\n 3 4 1\n 5 6 2\n 7 8 -1\n 2 1 1\n 0 4 2\n"
+                "2 2 7\n 1 9 3\n";
+        std::istringstream plain(head +
+                "y0 + y1 + y2 + y3 = 4\n (z0 + z1 + z2)/3 = 1\n z3 = y2");
+        std::istringstream aggregate(head +
+                "sum(y0..y3) = 4\n mean(z0..z2) = 1\n z3 = y2");
+        const auto a = glls(plain);
+        const auto b = glls(aggregate);
+        BOOST_REQUIRE_EQUAL(a.size(), 3);
+        BOOST_REQUIRE_EQUAL(b.size(), 3);
+        for (int i = 0; i < 3; ++i) {
+            BOOST_CHECK_CLOSE(a[i], b[i], 1e-9);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(Glls_Lazy) {
+        const char *input =
+                "x\ny\n1 2 0\n 3 4 1\n 5 6 0\n 7 8 1\n 9 1 0\n"
+                "x2 = 1\n y1 = y3 + 1 = 2\n mean(y0..y4) = 0.5";
+        std::istringstream ss1(input);
+        std::istringstream ss2(input);
+        const auto x1 = glls(ss1);
+        const auto x2 = glls(ss2, 1, true);
+        BOOST_REQUIRE_EQUAL(x1.size(), x2.size());
+        for (std::size_t i = 0; i < x1.size(); ++i) {
+            BOOST_CHECK_CLOSE(x1[i], x2[i], 1e-9);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(Diagnostics) {
+        std::istringstream ss(
+                "x\ny\n1 2\n 3 4.5\n 5 6\n 7 8\n"
+                "y0 = 1\n\ny1 = 2\nfor i in 2..3: y{i} = 10\n");
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        GllsDiagnostics d;
+        const auto x = solve(g, d);
+        const auto x0 = solve(g);
+        BOOST_REQUIRE_EQUAL(x.size(), x0.size());
+        const auto r = residual(g, x);
+        BOOST_REQUIRE_EQUAL(d.residual.size(), 4);
+        double sum = 0;
+        std::size_t worst = 0;
+        for (std::size_t i = 0; i < r.size(); ++i) {
+            BOOST_CHECK_CLOSE(d.residual[i], r[i], 1e-9);
+            sum += r[i] * r[i];
+            if (std::abs(r[i]) > std::abs(r[worst])) {
+                worst = i;
+            }
+        }
+        BOOST_CHECK_CLOSE(d.norm2, std::sqrt(sum), 1e-9);
+        BOOST_CHECK_CLOSE(d.normInf, std::abs(r[worst]), 1e-9);
+        BOOST_CHECK_EQUAL(d.worstRow, worst);
+        BOOST_CHECK_EQUAL(d.rank, 2);
+        BOOST_CHECK(d.conditionEstimate >= 1.0);
+        const auto byLine = residualByLine(d, gp.yConds());
+        BOOST_REQUIRE_EQUAL(byLine.size(), 3);
+        BOOST_CHECK_EQUAL(byLine[0].first, 7);
+        BOOST_CHECK_EQUAL(byLine[1].first, 9);
+        BOOST_CHECK_EQUAL(byLine[2].first, 10);
+        BOOST_CHECK_CLOSE(byLine[2].second,
+                std::sqrt(r[2]*r[2] + r[3]*r[3]), 1e-9);
+    }
+
+    BOOST_AUTO_TEST_CASE(Diagnostics_IllConditioned) {
+        // the second column is almost twice the first
+        std::istringstream ss(
+                "x\ny\n1 2 1\n 2 4.000001 0\n 3 6 1\n 4 8 0\n y0 = 1\n"
+                " y1 = 2\n y2 = 3\n y3 = 4\n");
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        GllsDiagnostics d;
+        solve(g, d);
+        BOOST_CHECK_GT(d.conditionEstimate, 1e5);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 
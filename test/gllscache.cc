@@ -0,0 +1,129 @@
+#include "../src/gllscache.h"
+#include "../src/glls.h"
+#include "../src/parsercommon.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsCache
+#endif
+#include <boost/test/unit_test.hpp>
+
+struct CacheDir
+{
+    CacheDir() {
+        char tmpl[] = "/tmp/glls_cache_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(tmpl));
+        path = tmpl;
+    }
+    ~CacheDir() {
+        std::system(("rm -rf " + path).c_str());
+    }
+    std::string path;
+};
+
+static std::vector<double> solveDirect(const std::string &s)
+{
+    std::istringstream ss(s);
+    return glls(ss);
+}
+
+static std::vector<double> solveCached(GllsCache &cache, const std::string &s)
+{
+    std::istringstream ss(s);
+    return cache.solve(ss);
+}
+
+static void checkClose(
+        const std::vector<double> &a, const std::vector<double> &b)
+{
+    BOOST_REQUIRE_EQUAL(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        BOOST_CHECK_CLOSE(a[i], b[i], 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(CondOffset) {
+        BOOST_CHECK_EQUAL(GllsCache::condOffset("x\ny\n1 2\ny0 = 1\n"), 8);
+        BOOST_CHECK_EQUAL(GllsCache::condOffset("x\n# a=b\n1 2\ny0=1"), 12);
+        BOOST_CHECK_EQUAL(GllsCache::condOffset("x\ny\n1 2\n"), 8);
+    }
+
+    BOOST_AUTO_TEST_CASE(Hash) {
+        const std::string a = "x\ny\n1 2 3 4\n 8 7 6 5\n";
+        std::string b = a;
+        b[10] = '5';
+        BOOST_CHECK_EQUAL(
+                GllsCache::hash(a.data(), a.size()),
+                GllsCache::hash(a.data(), a.size()));
+        BOOST_CHECK(GllsCache::hash(a.data(), a.size())
+                != GllsCache::hash(b.data(), b.size()));
+        BOOST_CHECK(GllsCache::hash(a.data(), 3)
+                != GllsCache::hash(a.data(), 4));
+    }
+
+    BOOST_AUTO_TEST_CASE(Reuse) {
+        CacheDir dir;
+        GllsCache cache(dir.path);
+        const std::string coef = "x\ny\n1 2\n 3 4\n 5 6\n";
+        const std::string in1 = coef + "y0 = y1 = 1 = y2\n";
+        const std::string in2 = coef + "y0 = 2\n y1 = 1 = y2\n";
+        checkClose(solveCached(cache, in1), solveDirect(in1));
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::NONE);
+        checkClose(solveCached(cache, in1), solveDirect(in1));
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::PROBLEM);
+        BOOST_CHECK_EQUAL(cache.yConds().size(), 3);
+        checkClose(solveCached(cache, in2), solveDirect(in2));
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::COEF);
+        const std::string in3 = "x\ny\n1 2\n 3 4\n 5 7\n y0 = 2\n y1 = 1 = y2\n";
+        checkClose(solveCached(cache, in3), solveDirect(in3));
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::NONE);
+        // a new cache object on the same directory
+        GllsCache other(dir.path);
+        checkClose(solveCached(other, in2), solveDirect(in2));
+        BOOST_CHECK(other.lastHit() == GllsCache::Hit::PROBLEM);
+    }
+
+    BOOST_AUTO_TEST_CASE(Corrupted) {
+        CacheDir dir;
+        GllsCache cache(dir.path);
+        const std::string in =
+                "x\ny\n1 2 3 4 \n 8 7 6 5\n x0=2\n x2=-1\ny0=6\ny1=9";
+        const auto x = solveCached(cache, in);
+        const std::size_t split = GllsCache::condOffset(in);
+        std::ostringstream name;
+        name << std::hex << std::setfill('0')
+             << dir.path << '/'
+             << std::setw(16) << GllsCache::hash(in.data(), split) << '-'
+             << std::setw(16)
+             << GllsCache::hash(in.data() + split, in.size() - split)
+             << ".prob";
+        {
+            std::ofstream os(name.str(), std::ios::binary | std::ios::trunc);
+            BOOST_REQUIRE(os);
+            os << "GLLSPRB1 garbage";
+        }
+        checkClose(solveCached(cache, in), x);
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::COEF);
+        checkClose(solveCached(cache, in), x);
+        BOOST_CHECK(cache.lastHit() == GllsCache::Hit::PROBLEM);
+    }
+
+    BOOST_AUTO_TEST_CASE(Errors) {
+        CacheDir dir;
+        GllsCache cache(dir.path);
+        std::istringstream ss("x\ny\n1 2\n 3 4\n y0 = 1\n");
+        BOOST_CHECK_NO_THROW(cache.solve(ss));
+        // the cached M is reused, errors of the conditions are still found
+        std::istringstream ss2("x\ny\n1 2\n 3 4\n y0 = 1\n y1 = x5\n");
+        BOOST_CHECK_EXCEPTION(cache.solve(ss2), ParserError,
+                [](const ParserError &e) { return e.line() == 6; });
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+#include "../src/gllsexecutor.h"
+#include "../src/glls.h"
+#include "../src/parsercommon.h"
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsExecutor
+#endif
+#include <boost/test/unit_test.hpp>
+#include "testutil.h"
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Submit) {
+        GllsExecutor ex(4);
+        std::vector<std::string> inputs;
+        std::vector<std::future<std::vector<double> > > results;
+        for (int i = 0; i < 8; ++i) {
+            inputs.push_back(largeInput(2000 + 500 * i));
+            results.push_back(ex.submit(inputs.back(),
+                    i % 2 ? GllsExecutor::Priority::HIGH
+                          : GllsExecutor::Priority::NORMAL));
+        }
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            std::istringstream ss(inputs[i]);
+            checkClose(results[i].get(), glls(ss), 1e-6);
+        }
+        auto bad = ex.submit(std::string("x\ny\n1 2\n3 4\ny0 = 1\ny7 = 0\n"));
+        BOOST_CHECK_EXCEPTION(bad.get(), ParserError,
+                [](const ParserError &e) { return e.line() == 6; });
+    }
+
+    BOOST_AUTO_TEST_CASE(Arranged) {
+        GllsExecutor ex(2);
+        const std::string input = largeInput(1000);
+        std::istringstream ss(input);
+        GllsParser gp(ss, true);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds());
+        checkClose(ex.submit(g).get(), solve(g), 1e-6);
+    }
+
+    BOOST_AUTO_TEST_CASE(Cancel) {
+        // one worker, blocked until the problems are queued
+        GllsExecutor ex(1);
+        std::mutex mutex;
+        std::unique_lock<std::mutex> block(mutex);
+        std::atomic<bool> started(false);
+        ex.pool().submit([&mutex, &started]() {
+            started = true;
+            std::lock_guard<std::mutex> l(mutex);
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        GllsCancelToken token;
+        auto cancelled = ex.submit(largeInput(100),
+                GllsExecutor::Priority::NORMAL, token);
+        auto kept = ex.submit(largeInput(100));
+        token.cancel();
+        block.unlock();
+        BOOST_CHECK_THROW(cancelled.get(), GllsCancelled);
+        BOOST_CHECK_EQUAL(kept.get().size(), 3);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
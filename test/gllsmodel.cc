@@ -0,0 +1,167 @@
+#include "../src/gllsmodel.h"
+#include "../src/gllsc.h"
+#include "../src/glls.h"
+#include "../src/parsercommon.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsModel
+#endif
+#include <boost/test/unit_test.hpp>
+#include "testutil.h"
+
+namespace {
+
+// 4 rows of 3 X columns, padded to a stride of 5
+const double padded[] = {
+    1, 2, 0,   -1, -1,
+    3, 4, 1,   -1, -1,
+    5, 6, 2,   -1, -1,
+    7, 9, 4,   -1, -1,
+};
+
+const char *const text = "x\ny\n1 2 0\n3 4 1\n5 6 2\n7 9 4\n";
+
+std::vector<double> reference(const std::string &conds)
+{
+    std::istringstream ss(text + conds);
+    return glls(ss);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Text) {
+        const std::string conds = "y0 = 1\ny1 + y2 = 3\ny3 = 2*y0 # x\nx2 = 1\n";
+        GllsModel m(padded, 4, 3, 5);
+        m.addConditions(conds);
+        checkClose(m.solve(), reference(conds));
+        double x[3];
+        m.solve(x);
+        checkClose(std::vector<double>(x, x + 3), reference(conds));
+        m.clearConditions();
+        BOOST_CHECK_THROW(m.solve(), std::invalid_argument);
+    }
+
+    BOOST_AUTO_TEST_CASE(Triplets) {
+        const std::string conds = "y0 = 1\ny1 + y2 = 3\n2*y0 = y3\n";
+        GllsModel m(padded, 4, 3, 5);
+        // condition 1 first, condition 2 is 2*y0 - y3 = 0
+        const int c[] = {1, 0, 2, 1, 2};
+        const int r[] = {1, 0, 0, 2, 3};
+        const double v[] = {1, 1, 2, 1, -1};
+        const double k[] = {-1, -3, 0};
+        m.addConditions(3, 5, c, r, v, k);
+        checkClose(m.solve(), reference(conds));
+        const int bad[] = {3};
+        BOOST_CHECK_THROW(m.addConditions(3, 1, bad, r, v, k),
+                std::invalid_argument);
+        const int badRow[] = {4};
+        BOOST_CHECK_THROW(m.addConditions(3, 1, c, badRow, v, k),
+                std::invalid_argument);
+        // a failed call keeps nothing
+        BOOST_CHECK_EQUAL(m.yConds().size(), 3);
+        const int i[] = {1};
+        const double x1[] = {0.5};
+        m.fixX(1, i, x1);
+        checkClose(m.solve(), reference(conds + "x1 = 0.5\n"));
+        BOOST_CHECK_THROW(m.fixX(1, bad, x1), std::invalid_argument);
+    }
+
+    BOOST_AUTO_TEST_CASE(Storage) {
+        std::vector<double> data(padded, padded + 20);
+        GllsModel borrowed(data.data(), 4, 3, 5, true);
+        GllsModel copied(data.data(), 4, 3, 5, true, GllsModel::Storage::COPY);
+        const std::string conds = "y0 = 1\ny1 + y2 = 3\ny3 = 0\n";
+        borrowed.addConditions(conds);
+        copied.addConditions(conds);
+        // the constant column is -1, i.e. y = M x - 1
+        const auto x = reference("y0 = 2\ny1 + y2 = 5\ny3 = 1\n");
+        checkClose(borrowed.solve(), x);
+        checkClose(copied.solve(), x);
+        std::fill(data.begin(), data.end(), 0.0);
+        checkClose(copied.solve(), x);
+        BOOST_CHECK_THROW(GllsModel(padded, 4, 3, 3, true),
+                std::invalid_argument);
+    }
+
+    BOOST_AUTO_TEST_CASE(Names) {
+        GllsModel m(padded, 4, 3, 5);
+        m.setNames("I", {"Bz", "Br"});
+        m.addConditions("Bz0 = 1\nBr0 + Bz1 = 3\nBr1 = 2*Bz0\nI2 = 1\n");
+        checkClose(m.solve(), reference("y0 = 1\ny1 + y2 = 3\ny3 = 2*y0\nx2 = 1\n"));
+        BOOST_CHECK_THROW(m.setNames("I", {"Bz", "Br", "Psi"}),
+                std::invalid_argument);
+        BOOST_CHECK_THROW(m.setNames("I", {"Bz", "Bz"}), std::invalid_argument);
+        BOOST_CHECK_EXCEPTION(m.addConditions("Bz0 = 0\n\nBz2 = 1\n", 10),
+                ParserError,
+                [](const ParserError &e) { return e.line() == 12; });
+        BOOST_CHECK_EQUAL(m.yConds().size(), 3);
+    }
+
+    BOOST_AUTO_TEST_CASE(CInterface) {
+        BOOST_CHECK(!glls_model_new(padded, 4, 3, 2, 0, 0));
+        glls_model *m = glls_model_new(padded, 4, 3, 5, 0, 1);
+        BOOST_REQUIRE(m);
+        double x[3];
+        BOOST_CHECK_EQUAL(glls_solve(m, x), GLLS_ERROR_ARGUMENT);
+        BOOST_CHECK(*glls_last_error(m));
+        BOOST_CHECK_EQUAL(glls_set_names(m, "I", "Bz Br"), GLLS_OK);
+        BOOST_CHECK_EQUAL(
+                glls_add_conditions_text(m, "Bz0 = 1\nBz9 = 1\n", 1),
+                GLLS_ERROR_PARSE);
+        BOOST_CHECK_EQUAL(glls_last_error_line(m), 2);
+        BOOST_CHECK_EQUAL(
+                glls_add_conditions_text(m, "Bz0 = 1\nBr0 + Bz1 = 3\n", 1),
+                GLLS_OK);
+        const int c[] = {0, 0};
+        const int r[] = {3, 0};
+        const double v[] = {1, -2};
+        BOOST_CHECK_EQUAL(
+                glls_add_conditions_triplets(m, 1, 2, c, r, v, nullptr),
+                GLLS_OK);
+        const int i[] = {2};
+        const double x2[] = {1};
+        BOOST_CHECK_EQUAL(glls_fix_x(m, 1, i, x2), GLLS_OK);
+        BOOST_CHECK_EQUAL(glls_solve(m, x), GLLS_OK);
+        BOOST_CHECK_EQUAL(std::string(glls_last_error(m)), "");
+        checkClose(std::vector<double>(x, x + 3),
+                reference("y0 = 1\ny1 + y2 = 3\ny3 = 2*y0\nx2 = 1\n"));
+        glls_clear_conditions(m);
+        BOOST_CHECK_EQUAL(glls_solve(m, x), GLLS_ERROR_ARGUMENT);
+        glls_model_free(m);
+    }
+
+    BOOST_AUTO_TEST_CASE(ColumnMajor) {
+        // the padded matrix with its constants as a Fortran array a(6, 4)
+        std::vector<double> data(6 * 4, 99.0);
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                data[r + 6*c] = padded[r*5 + c];
+            }
+        }
+        const std::string conds = "y0 = 1\ny1 + y2 = 3\ny3 = 0\n";
+        const auto x = reference("y0 = 2\ny1 + y2 = 5\ny3 = 1\n");
+        GllsModel borrowed(data.data(), 4, 3, 1, 6, true);
+        GllsModel copied(data.data(), 4, 3, 1, 6, true,
+                GllsModel::Storage::COPY);
+        borrowed.addConditions(conds);
+        copied.addConditions(conds);
+        checkClose(borrowed.solve(), x);
+        std::fill(data.begin(), data.end(), 0.0);
+        checkClose(copied.solve(), x);
+        // the columns overlap the rows
+        BOOST_CHECK_THROW(GllsModel(padded, 4, 3, 2, 3, true),
+                std::invalid_argument);
+        BOOST_CHECK(!glls_model_new_strided(padded, 4, 3, 1, 3, 1, 0));
+        glls_model *m = glls_model_new_strided(padded, 4, 3, 5, 1, 1, 0);
+        BOOST_REQUIRE(m);
+        glls_model_free(m);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,7 +1,10 @@
 #include "../src/gllsparser.h"
+#include "../src/threadpool.h"
 #include "../src/parsercommon.h"
 #include "../src/condparser.h"
+#include "../src/condtree.h"
 #include <sstream>
+#include <string>
 
 #ifndef BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE GllsParser
@@ -297,4 +300,369 @@ BOOST_AUTO_TEST_SUITE()
         );
     }
 
+    BOOST_AUTO_TEST_CASE(ReadCond_YConds) {
+        std::istringstream ss(
+                "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n"
+                "z1 - 2 = 3*y0 + z1 - y1 = y1\n x0 = 1\n 2*y0 = 0"
+        );
+        GllsParser gp(ss, false);
+        BOOST_REQUIRE_NO_THROW(gp.run());
+        const auto &cs = gp.yConds();
+        BOOST_REQUIRE_EQUAL(cs.size(), 3);
+        // z1 - 2 - (3*y0 + z1 - y1) = -3*y0 + y1 + 0*z1 - 2
+        BOOST_REQUIRE_EQUAL(cs.rowEnd(0) - cs.rowBegin(0), 3);
+        BOOST_CHECK_EQUAL(cs.ids()[0], 0);
+        BOOST_CHECK_CLOSE(cs.coefs()[0], -3.0, 1e-9);
+        BOOST_CHECK_EQUAL(cs.ids()[1], 2);
+        BOOST_CHECK_CLOSE(cs.coefs()[1], 1.0, 1e-9);
+        BOOST_CHECK_EQUAL(cs.ids()[2], 3);
+        BOOST_CHECK_CLOSE(cs.constants()[0], -2.0, 1e-9);
+        BOOST_REQUIRE_EQUAL(cs.rowEnd(1) - cs.rowBegin(1), 2);
+        BOOST_CHECK_CLOSE(cs.constants()[1], -2.0, 1e-9);
+        BOOST_REQUIRE_EQUAL(cs.rowEnd(2) - cs.rowBegin(2), 1);
+        BOOST_CHECK_CLOSE(cs.coefs()[cs.rowBegin(2)], 2.0, 1e-9);
+        BOOST_REQUIRE_EQUAL(gp.xValues().size(), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Family) {
+        std::istringstream ss(
+                "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n 9 10\n 11 12\n"
+                "y0 = 1\n"
+                "for i in 0..1: z{i} - z{i+1} = 2*y{2*i}+3 = y1\n"
+                "z2 = 0\n"
+                "for i in 1..1: x{i-1} = 3"
+        );
+        GllsParser gp(ss, false);
+        BOOST_REQUIRE_NO_THROW(gp.run());
+        const auto &cs = gp.yConds();
+        BOOST_CHECK_EQUAL(cs.size(), 2);
+        BOOST_REQUIRE_EQUAL(cs.families().size(), 1);
+        BOOST_CHECK_EQUAL(cs.families()[0].position, 1);
+        BOOST_CHECK_EQUAL(cs.expandedSize(), 6);
+        std::vector<std::vector<std::pair<int, double> > > rows;
+        std::vector<double> constants;
+        cs.forEachRow([&](const ConditionSet::RowView &r) {
+            rows.emplace_back();
+            for (std::size_t k = 0; k < r.size; ++k) {
+                rows.back().emplace_back(r.ids[k], r.coefs[k]);
+            }
+            constants.push_back(r.constant);
+        });
+        BOOST_REQUIRE_EQUAL(rows.size(), 6);
+        // i = 1: z1 - z2 - 2*y2 - 3 = 0
+        std::vector<std::pair<int, double> > r3 =
+            {{3, 1.0}, {5, -1.0}, {4, -2.0}};
+        BOOST_CHECK(isEqual(rows[3], r3));
+        BOOST_CHECK_CLOSE(constants[3], -3.0, 1e-9);
+        // i = 1: z1 - z2 - y1 = 0
+        std::vector<std::pair<int, double> > r4 =
+            {{3, 1.0}, {5, -1.0}, {2, -1.0}};
+        BOOST_CHECK(isEqual(rows[4], r4));
+        BOOST_CHECK_EQUAL(rows[5][0].first, 5);
+        BOOST_REQUIRE_EQUAL(gp.xValues().size(), 1);
+        BOOST_CHECK_EQUAL(gp.xValues()[0].first, 0);
+        BOOST_CHECK_CLOSE(gp.xValues()[0].second, 3.0, 1e-9);
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Family_Bounds) {
+        const char *buf[] = {
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..2: y{i} = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..1: y{i-1} = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..1: x{i+1} = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..1: x{i} = y{i}",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..1: 1 = 2",
+        };
+        for (const auto s : buf) {
+            std::istringstream ss(s);
+            GllsParser gp(ss, false);
+            BOOST_TEST_CHECKPOINT("parsing " << s);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) {
+                        BOOST_CHECK_EQUAL(e.line(), 7);
+                        return e.type() == ParserError::Type::SEMANTIC_ERROR;
+                    }
+            );
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Aggregate) {
+        std::istringstream ss(
+                "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n 9 10\n 11 12\n"
+                "2*sum(z0..z2) + y1 = mean( y1 .. y2 )"
+        );
+        GllsParser gp(ss, false);
+        BOOST_REQUIRE_NO_THROW(gp.run());
+        const auto &cs = gp.yConds();
+        BOOST_REQUIRE_EQUAL(cs.size(), 1);
+        BOOST_REQUIRE_EQUAL(cs.rangeEnd(0) - cs.rangeBegin(0), 2);
+        const auto &r = cs.ranges();
+        BOOST_CHECK_EQUAL(r[0].first, 1);
+        BOOST_CHECK_EQUAL(r[0].count, 3);
+        BOOST_CHECK_EQUAL(r[0].stride, 2);
+        BOOST_CHECK_CLOSE(r[0].coef, 2.0, 1e-9);
+        BOOST_CHECK_EQUAL(r[1].first, 2);
+        BOOST_CHECK_EQUAL(r[1].count, 2);
+        BOOST_CHECK_CLOSE(r[1].coef, -0.5, 1e-9);
+        BOOST_CHECK_EQUAL(cs.rowEnd(0) - cs.rowBegin(0), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Aggregate_Invalid) {
+        const char *buf[] = {
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n sum(y0..y2) = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n sum(y0..z1) = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n sum(y1..y0) = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n sum(x0..x1) = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n sum(y0.y1) = 0",
+            "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n for i in 0..1: sum(y0..y1)=0",
+        };
+        for (const auto s : buf) {
+            std::istringstream ss(s);
+            GllsParser gp(ss, false);
+            BOOST_TEST_CHECKPOINT("parsing " << s);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) {
+                        BOOST_CHECK_EQUAL(e.line(), 7);
+                        return e.type() == ParserError::Type::SEMANTIC_ERROR
+                            || e.type() == ParserError::Type::INVALID_TOKEN;
+                    }
+            );
+        }
+    }
+
+    static std::string pipelineInput(int lines)
+    {
+        std::ostringstream os;
+        os << "x\ny z\n1 2\n 3 4\n 5 6\n 7 8\n";
+        for (int i = 0; i < lines; ++i) {
+            switch (i % 4) {
+            case 0: os << "y0 + " << i << "*z1 = " << i << '\n'; break;
+            case 1: os << "for i in 0..1: y{i} = " << i << "*z{i}\n"; break;
+            case 2: os << "sum(y0..y1) = z0 - " << i << '\n'; break;
+            default: os << "x0 = " << i << "\n\n"; break;
+            }
+        }
+        return os.str();
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Pipelined) {
+        const std::string input = pipelineInput(5000);
+        std::istringstream ss1(input);
+        GllsParser seq(ss1, false);
+        BOOST_REQUIRE_NO_THROW(seq.run());
+        ThreadPool pool(3);
+        for (const unsigned threads : {0u, 2u, 3u, 8u}) {
+            std::istringstream ss2(input);
+            GllsParser par(ss2, false);
+            // 0: the batches are parsed on the shared pool
+            if (threads) {
+                par.setThreads(threads);
+            } else {
+                par.setPool(&pool);
+            }
+            BOOST_REQUIRE_NO_THROW(par.run());
+            BOOST_CHECK(seq.xValues() == par.xValues());
+            BOOST_REQUIRE_EQUAL(
+                    seq.yConds().expandedSize(), par.yConds().expandedSize());
+            BOOST_CHECK_EQUAL(
+                    seq.yConds().families().size(),
+                    par.yConds().families().size());
+            std::vector<std::vector<std::pair<int, double> > > a, b;
+            std::vector<double> ca, cb;
+            seq.yConds().forEachRow([&](const ConditionSet::RowView &r) {
+                a.emplace_back();
+                for (std::size_t k = 0; k < r.size; ++k) {
+                    a.back().emplace_back(r.ids[k], r.coefs[k]);
+                }
+                ca.push_back(r.constant);
+            });
+            par.yConds().forEachRow([&](const ConditionSet::RowView &r) {
+                b.emplace_back();
+                for (std::size_t k = 0; k < r.size; ++k) {
+                    b.back().emplace_back(r.ids[k], r.coefs[k]);
+                }
+                cb.push_back(r.constant);
+            });
+            BOOST_CHECK(a == b);
+            BOOST_CHECK(ca == cb);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Pipelined_Error) {
+        // the first error follows 4000 lines and 1000 blank lines
+        std::string input = pipelineInput(4000);
+        input += "y0 = x0\n";
+        input += "y9 = 0\n";
+        std::istringstream ss1(input);
+        GllsParser seq(ss1, false);
+        int line = 0;
+        try {
+            seq.run();
+        } catch (const ParserError &e) {
+            line = e.line();
+        }
+        BOOST_REQUIRE_EQUAL(line, 7 + 4000 + 1000);
+        ThreadPool pool(3);
+        for (const unsigned threads : {0u, 4u}) {
+            std::istringstream ss2(input);
+            GllsParser par(ss2, false);
+            if (threads) {
+                par.setThreads(threads);
+            } else {
+                par.setPool(&pool);
+            }
+            BOOST_CHECK_EXCEPTION(par.run(), ParserError,
+                    [line](const ParserError &e) {
+                        return e.line() == line
+                            && e.type() == ParserError::Type::SEMANTIC_ERROR;
+                    }
+            );
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_PoolTask) {
+        // run() in the only worker of the pool parses on that thread alone
+        const std::string input = pipelineInput(2000);
+        ThreadPool pool(1);
+        std::size_t rows = 0;
+        pool.submit([&]() {
+            std::istringstream ss(input);
+            GllsParser par(ss, false);
+            par.setPool(&pool);
+            par.run();
+            rows = par.yConds().expandedSize();
+        });
+        pool.wait();
+        std::istringstream ss(input);
+        GllsParser seq(ss, false);
+        seq.run();
+        BOOST_CHECK_EQUAL(rows, seq.yConds().expandedSize());
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCoef_Lazy) {
+        // 300 rows of "y z", row r is (r, 1), with comments and empty lines
+        std::ostringstream os;
+        os << "x\ny z\n";
+        for (int r = 0; r < 300; ++r) {
+            os << r << " 1";
+            if (r % 7 == 0) {
+                os << " # row " << r << "\n\n";
+            } else {
+                os << '\n';
+            }
+        }
+        os << "y0 = 1\nsum(z10..z12) = y130\n"
+              "for i in 0..2: y{64*i+1} = 0\nx0 = 2\n";
+        const std::string input = os.str();
+        std::istringstream ss1(input);
+        GllsParser eager(ss1, false);
+        BOOST_REQUIRE_NO_THROW(eager.run());
+        std::istringstream ss2(input);
+        GllsParser lazy(ss2, false);
+        lazy.setLazy(true);
+        GllsProblem g;
+        BOOST_REQUIRE_NO_THROW(g = lazy.run());
+        BOOST_CHECK_EQUAL(lazy.yVarSize(), 300);
+        BOOST_CHECK(lazy.xValues() == eager.xValues());
+        const std::vector<int> rows = {0, 2, 21, 23, 25, 130, 258, 260};
+        BOOST_REQUIRE(lazy.coefRows() == rows);
+        BOOST_CHECK(g.rows == rows);
+        BOOST_REQUIRE_EQUAL(lazy.coef().size(), rows.size() * 2);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            BOOST_CHECK_EQUAL(lazy.coef()[2*i], rows[i]);
+            BOOST_CHECK_EQUAL(lazy.coef()[2*i+1], 1);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCoef_Lazy_Invalid) {
+        const std::string input =
+            "x\ny\n1 2\n 3 4\n 5 a\n 7 8\n y0 = y3";
+        {
+            // the broken row is not referenced
+            std::istringstream ss(input);
+            GllsParser gp(ss, false);
+            gp.setLazy(true);
+            BOOST_CHECK_NO_THROW(gp.run());
+        }
+        {
+            std::istringstream ss(input + "\n y2 = 0");
+            GllsParser gp(ss, false);
+            gp.setLazy(true);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) { return e.line() == 5; });
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Blocks) {
+        // common conditions, then 600 blocks crossing the batch boundaries
+        std::ostringstream os;
+        os << "x\ny\n1 2\n 3 4\n 5 6\n y0 = 1\n\n";
+        for (int i = 0; i < 600; ++i) {
+            os << "[b" << i << "]\n";
+            if (i % 3) {
+                os << "y1 = " << i << "\n";
+            }
+            if (i % 5 == 0) {
+                os << "x0 = " << i << "\n";
+            }
+        }
+        const std::string input = os.str();
+        for (const unsigned threads : {1u, 4u}) {
+            std::istringstream ss(input);
+            GllsParser gp(ss, false);
+            gp.setThreads(threads);
+            gp.setBlocksAllowed(true);
+            BOOST_REQUIRE_NO_THROW(gp.run());
+            BOOST_CHECK_EQUAL(gp.yConds().size(), 1);
+            BOOST_CHECK(gp.xValues().empty());
+            const auto &blocks = gp.blocks();
+            BOOST_REQUIRE_EQUAL(blocks.size(), 600);
+            int line = 8;
+            for (int i = 0; i < 600; ++i) {
+                const auto &b = blocks[i];
+                BOOST_CHECK_EQUAL(b.name, "b" + std::to_string(i));
+                BOOST_CHECK_EQUAL(b.line, line);
+                BOOST_CHECK_EQUAL(b.yConds.size(), i % 3 ? 1 : 0);
+                BOOST_REQUIRE_EQUAL(b.xValues.size(), i % 5 == 0 ? 1 : 0);
+                if (i % 5 == 0) {
+                    BOOST_CHECK_EQUAL(b.xValues[0].second, i);
+                }
+                line += 1 + (i % 3 != 0) + (i % 5 == 0);
+            }
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(ReadCond_Blocks_Invalid) {
+        const std::string head = "x\ny\n1 2\n 3 4\n y0 = 1\n";
+        {
+            std::istringstream ss(head + "[a]\ny1 = 0\n");
+            GllsParser gp(ss, false);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) { return e.line() == 6; });
+        }
+        for (const char *h : {"[]", "[a b]", "[a", "[a] y1 = 0"}) {
+            std::istringstream ss(head + h + "\n");
+            GllsParser gp(ss, false);
+            gp.setBlocksAllowed(true);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) { return e.line() == 6; });
+        }
+        {
+            std::istringstream ss(head + "[a]\n[b]\n[a]\n[b]\n");
+            GllsParser gp(ss, false);
+            gp.setBlocksAllowed(true);
+            BOOST_CHECK_EXCEPTION(gp.run(), ParserError,
+                    [](const ParserError &e) { return e.line() == 8; });
+        }
+        {
+            // a header right after the coefficients ends them
+            std::istringstream ss("x\ny\n1 2\n 3 4\n[a]\ny0 = 1\n");
+            GllsParser gp(ss, false);
+            gp.setBlocksAllowed(true);
+            BOOST_REQUIRE_NO_THROW(gp.run());
+            BOOST_CHECK(gp.yConds().empty());
+            BOOST_REQUIRE_EQUAL(gp.blocks().size(), 1);
+            BOOST_CHECK_EQUAL(gp.blocks()[0].yConds.size(), 1);
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+#include "../src/gllsprofile.h"
+#include "../src/glls.h"
+#include <sstream>
+#include <string>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsProfile
+#endif
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const char *const input =
+    "x\ny\n"
+    "1 2 3\n4 5 6\n7 8 10\n3 1 2\n"
+    "y0 = 1\ny1 + y2 = 3 = y3\nx2 = 0.5\n";
+
+const GllsProfile::Phase *find(
+        const std::vector<GllsProfile::Phase> &phases, const std::string &name)
+{
+    for (const auto &p : phases) {
+        if (p.name == name) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Phases) {
+        // gllsalloc.cc counts the allocations
+        GllsProfile profile;
+        GllsProfile::setActive(&profile);
+        std::istringstream ss(input);
+        glls(ss);
+        GllsProfile::setActive(nullptr);
+        const auto phases = profile.phases();
+        const char *const names[] = {"readCoefWithCond", "attachCond",
+                "arrangeX", "arrangeY", "gram", "factorize", "substitute"};
+        BOOST_REQUIRE_EQUAL(phases.size(), 7);
+        for (std::size_t i = 0; i < phases.size(); ++i) {
+            BOOST_CHECK_EQUAL(phases[i].name, names[i]);
+            BOOST_CHECK_EQUAL(phases[i].calls, 1);
+            BOOST_CHECK_GE(phases[i].wallSeconds, 0.0);
+        }
+        const auto *coef = find(phases, "readCoefWithCond");
+        BOOST_CHECK_EQUAL(coef->rows, 4);
+        // the trimmed lines with their line ends
+        BOOST_CHECK_EQUAL(coef->bytes, 25);
+        BOOST_CHECK_EQUAL(find(phases, "attachCond")->rows, 3);
+        BOOST_CHECK_GT(find(phases, "attachCond")->allocations, 0);
+        BOOST_CHECK_GT(find(phases, "attachCond")->allocatedBytes, 0);
+        BOOST_CHECK_EQUAL(find(phases, "gram")->rows, 3);
+        BOOST_CHECK_EQUAL(find(phases, "factorize")->rows, 2);
+
+        // inactive, nothing is recorded
+        std::istringstream again(input);
+        glls(again);
+        BOOST_CHECK_EQUAL(profile.phases()[0].calls, 1);
+
+        std::ostringstream text, json;
+        profile.writeText(text);
+        profile.writeJson(json);
+        BOOST_CHECK(text.str().find("attachCond") != std::string::npos);
+        BOOST_CHECK(json.str().find("{\"name\": \"gram\", \"calls\": 1")
+                != std::string::npos);
+        BOOST_CHECK(json.str().find("\"allocations\"") != std::string::npos);
+        profile.clear();
+        BOOST_CHECK(profile.phases().empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(Accumulate) {
+        GllsProfile profile;
+        GllsProfile::setActive(&profile);
+        for (int i = 0; i < 3; ++i) {
+            GllsProfile::Span span("phase");
+            span.addRows(10);
+            span.addBytes(100);
+        }
+        GllsProfile::setActive(nullptr);
+        const auto phases = profile.phases();
+        BOOST_REQUIRE_EQUAL(phases.size(), 1);
+        BOOST_CHECK_EQUAL(phases[0].calls, 3);
+        BOOST_CHECK_EQUAL(phases[0].rows, 30);
+        BOOST_CHECK_EQUAL(phases[0].bytes, 300);
+    }
+
+    BOOST_AUTO_TEST_CASE(Counters) {
+        GllsProfile profile;
+        const bool counting = GllsProfile::setCountingHardware(true);
+        GllsProfile::setActive(&profile);
+        std::istringstream ss(input);
+        glls(ss);
+        GllsProfile::setActive(nullptr);
+        const auto phases = profile.phases();
+        BOOST_CHECK_GT(find(phases, "gram")->flops, 0);
+        BOOST_CHECK_GT(find(phases, "factorize")->flops, 0);
+        BOOST_CHECK_GT(find(phases, "substitute")->flops, 0);
+        BOOST_CHECK_EQUAL(find(phases, "attachCond")->flops, 0);
+        std::ostringstream text, json;
+        profile.writeText(text);
+        profile.writeJson(json);
+        BOOST_CHECK(json.str().find("\"gflop_per_s\"") != std::string::npos);
+        // most virtual machines have no PMU
+        if (counting && GllsProfile::hasCounter(GllsProfile::INSTRUCTIONS)) {
+            for (const auto &p : phases) {
+                BOOST_CHECK_GT(p.counters[GllsProfile::INSTRUCTIONS], 0);
+            }
+            BOOST_CHECK(text.str().find("IPC") != std::string::npos);
+        } else if (!counting) {
+            for (int c = 0; c < GllsProfile::COUNTERS; ++c) {
+                BOOST_CHECK(!GllsProfile::hasCounter(
+                        static_cast<GllsProfile::Counter>(c)));
+            }
+            BOOST_CHECK(text.str().find("IPC") == std::string::npos);
+            BOOST_CHECK(json.str().find("\"cycles\"") == std::string::npos);
+        }
+        GllsProfile::setCountingHardware(false);
+        BOOST_CHECK(!GllsProfile::hasCounter(GllsProfile::CYCLES));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,142 @@
+#include "../tools/gllsserver.h"
+#include "../tools/protocol.h"
+#include "../src/glls.h"
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsServer
+#endif
+#include <boost/test/unit_test.hpp>
+
+static Message request(
+        const std::string &command,
+        const std::string &id,
+        const std::string &body)
+{
+    Message m;
+    m.command = command;
+    m.args.assign(1, id);
+    m.body = body;
+    return m;
+}
+
+static std::vector<double> firstLine(const std::string &s)
+{
+    std::istringstream ss(s.substr(0, s.find('\n')));
+    std::vector<double> v;
+    double x;
+    while (ss >> x) {
+        v.push_back(x);
+    }
+    return v;
+}
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Protocol) {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        const Message a = request("SOLVE", "coil", "y0 = 1\ny1 = 2\n");
+        Message b;
+        BOOST_REQUIRE(sendMessage(fds[0], a));
+        BOOST_REQUIRE(sendMessage(fds[0], request("OK", "", "")));
+        BOOST_REQUIRE(receiveMessage(fds[1], b));
+        BOOST_CHECK_EQUAL(b.command, "SOLVE");
+        BOOST_REQUIRE_EQUAL(b.args.size(), 1);
+        BOOST_CHECK_EQUAL(b.args[0], "coil");
+        BOOST_CHECK_EQUAL(b.body, a.body);
+        BOOST_REQUIRE(receiveMessage(fds[1], b));
+        BOOST_CHECK_EQUAL(b.command, "OK");
+        BOOST_CHECK(b.body.empty());
+        close(fds[0]);
+        BOOST_CHECK(!receiveMessage(fds[1], b));
+        close(fds[1]);
+    }
+
+    BOOST_AUTO_TEST_CASE(OversizedBody) {
+        int fds[2];
+        BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        const std::string header = "LOAD a 99999999999999999\n";
+        BOOST_REQUIRE(write(fds[0], header.data(), header.size())
+                == static_cast<ssize_t>(header.size()));
+        Message b;
+        BOOST_CHECK(!receiveMessage(fds[1], b));
+        // a body shorter than announced is not waited for beyond its end
+        const std::string truncated = "LOAD a 100\nx\ny\n";
+        BOOST_REQUIRE(write(fds[0], truncated.data(), truncated.size())
+                == static_cast<ssize_t>(truncated.size()));
+        close(fds[0]);
+        BOOST_CHECK(!receiveMessage(fds[1], b));
+        close(fds[1]);
+    }
+
+    BOOST_AUTO_TEST_CASE(Solve) {
+        const std::string matrix = "x\ny\n1 2\n 3 4\n 5 6\n";
+        const std::string conds = "y0 = y1 = 1 = y2\n";
+        GllsServer server(1 << 20);
+        Message r = server.handle(request("SOLVE", "m", conds));
+        BOOST_CHECK_EQUAL(r.command, "ERR");
+        r = server.handle(request("LOAD", "m", matrix));
+        BOOST_REQUIRE_EQUAL(r.command, "OK");
+        r = server.handle(request("SOLVE", "m", conds));
+        BOOST_REQUIRE_EQUAL(r.command, "OK");
+        std::istringstream ss(matrix + conds);
+        const auto expected = glls(ss);
+        const auto x = firstLine(r.body);
+        BOOST_REQUIRE_EQUAL(x.size(), expected.size());
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            BOOST_CHECK_CLOSE(x[i], expected[i], 1e-9);
+        }
+        BOOST_CHECK(r.body.find("\nresidual 3 ") != r.body.npos);
+        // line numbers refer to the condition text
+        r = server.handle(request("SOLVE", "m", "y0 = 1\n\ny7 = 1\n"));
+        BOOST_CHECK_EQUAL(r.command, "ERR");
+        BOOST_CHECK(r.body.find("line 3") != r.body.npos);
+        r = server.handle(request("SOLVE", "m", "x0 = 1\n"));
+        BOOST_CHECK_EQUAL(r.command, "ERR");
+        r = server.handle(request("LOAD", "n", "x\ny\n1 2\n 3 a\n"));
+        BOOST_CHECK_EQUAL(r.command, "ERR");
+    }
+
+    BOOST_AUTO_TEST_CASE(MatrixFile) {
+        char path[] = "/tmp/glls_server_XXXXXX";
+        const int fd = mkstemp(path);
+        BOOST_REQUIRE(fd >= 0);
+        const std::string matrix = "x\ny\n1 2\n 3 4\n 5 6\n";
+        BOOST_REQUIRE(write(fd, matrix.data(), matrix.size())
+                == static_cast<ssize_t>(matrix.size()));
+        close(fd);
+        GllsServer server(1 << 20);
+        server.addMatrixFile("f", path);
+        BOOST_CHECK_EQUAL(server.loadedCount(), 0);
+        const Message r = server.handle(request("SOLVE", "f", "y0 = 1 = y1"));
+        BOOST_CHECK_EQUAL(r.command, "OK");
+        BOOST_CHECK_EQUAL(server.loadedCount(), 1);
+        std::remove(path);
+    }
+
+    BOOST_AUTO_TEST_CASE(Eviction) {
+        // a budget below one session keeps only the most recent one
+        GllsServer server(1);
+        const std::string a = "x\ny\n1 2\n 3 4\n 5 6\n";
+        const std::string b = "x\ny\n1 0\n 0 1\n 1 1\n";
+        BOOST_REQUIRE_EQUAL(server.handle(request("LOAD", "a", a)).command, "OK");
+        BOOST_REQUIRE_EQUAL(server.handle(request("LOAD", "b", b)).command, "OK");
+        BOOST_CHECK_EQUAL(server.loadedCount(), 1);
+        // an evicted matrix is loaded again
+        const Message r = server.handle(request("SOLVE", "a", "y0 = 1 = y1"));
+        BOOST_CHECK_EQUAL(r.command, "OK");
+        BOOST_CHECK_EQUAL(server.loadedCount(), 1);
+        BOOST_CHECK(server.memoryUsage() > 0);
+        GllsServer large(1 << 30);
+        large.handle(request("LOAD", "a", a));
+        large.handle(request("LOAD", "b", b));
+        BOOST_CHECK_EQUAL(large.loadedCount(), 2);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
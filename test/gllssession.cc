@@ -0,0 +1,98 @@
+#include "../src/gllssession.h"
+#include "../src/glls.h"
+#include "../src/parsercommon.h"
+#include <sstream>
+#include <string>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsSession
+#endif
+#include <boost/test/unit_test.hpp>
+
+static void checkSolution(GllsSession &session, const std::string &input)
+{
+    std::istringstream ss(input);
+    const auto expected = glls(ss);
+    const auto x = session.solve();
+    BOOST_REQUIRE_EQUAL(x.size(), expected.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        BOOST_CHECK_CLOSE(x[i], expected[i], 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(ctor) {
+        GllsSession session;
+        BOOST_CHECK(!session.loaded());
+    }
+
+    BOOST_AUTO_TEST_CASE(Incremental) {
+        const std::string coef =
+                "x\ny z\n1 2 0\n 3 4 1\n 5 6 0\n 7 8 1\n 9 1 0\n 2 2 2\n";
+        GllsSession session;
+        const std::string in1 = coef +
+                "y0 = 1\n# comment\nz0 = 2 # trailing\n\ny1 = z1\nx2 = 0.5\n";
+        session.update(in1);
+        BOOST_CHECK(session.loaded());
+        BOOST_CHECK_EQUAL(session.parsedLines(), 4);
+        checkSolution(session, in1);
+        BOOST_CHECK(!session.reusedFactorization());
+
+        // only a constant changed
+        const std::string in2 = coef +
+                "y0 = 3\n# comment\nz0 = 2 # trailing\n\ny1 = z1\nx2 = 0.5\n";
+        session.update(in2);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 1);
+        checkSolution(session, in2);
+        BOOST_CHECK(session.reusedFactorization());
+
+        // a fixed X changes the constants only
+        const std::string in3 = coef +
+                "y0 = 3\nz0 = 2\ny1 = z1\nx2 = -1\n";
+        session.update(in3);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 1);
+        checkSolution(session, in3);
+        BOOST_CHECK(session.reusedFactorization());
+
+        // a new row of the system
+        const std::string in4 = in3 + "z2 = 1\n";
+        session.update(in4);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 1);
+        checkSolution(session, in4);
+        BOOST_CHECK(!session.reusedFactorization());
+
+        // a new matrix parses everything again
+        const std::string in5 =
+                "x\ny z\n1 2 0\n 3 4 1\n 5 6 0\n 7 8 1\n 9 1 0\n 2 2 3\n"
+                "y0 = 3\nz0 = 2\ny1 = z1\nx2 = -1\nz2 = 1\n";
+        session.update(in5);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 5);
+        checkSolution(session, in5);
+        BOOST_CHECK(!session.reusedFactorization());
+    }
+
+    BOOST_AUTO_TEST_CASE(Errors) {
+        const std::string coef = "x\ny\n1 2\n 3 4\n 5 6\n";
+        const std::string good = coef + "y0 = y1 = 1 = y2\n";
+        GllsSession session;
+        session.update(good);
+        BOOST_CHECK_EXCEPTION(
+                session.update(coef + "y0 = 1\n\n y9 = 2\n"), ParserError,
+                [](const ParserError &e) { return e.line() == 8; });
+        // the previous conditions are kept
+        BOOST_CHECK_EQUAL(session.yConds().size(), 3);
+        checkSolution(session, good);
+        session.update(good);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 0);
+        BOOST_CHECK_THROW(
+                session.update("x\ny\n1 2\n 3 a\n y0 = 1\n"), ParserError);
+        BOOST_CHECK_THROW(
+                session.update("x\ny\n1 2\n 3 4\n y0 = 1\n y5 = 1\n"),
+                ParserError);
+        session.update(good);
+        BOOST_CHECK_EQUAL(session.parsedLines(), 0);
+        checkSolution(session, good);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,97 @@
+#include "../src/gllstrace.h"
+#include "../src/gllsparser.h"
+#include "../src/solveglls.h"
+#include "../src/threadpool.h"
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GllsTrace
+#endif
+#include <boost/test/unit_test.hpp>
+#include "testutil.h"
+
+namespace {
+
+bool contains(const std::string &s, const std::string &part)
+{
+    return s.find(part) != std::string::npos;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(Pooled) {
+        ThreadPool pool(4);
+        GllsTrace trace;
+        GllsTrace::setActive(&trace);
+        std::istringstream ss(largeInput(4000));
+        GllsParser gp(ss, true);
+        gp.setPool(&pool);
+        auto g = gp.run();
+        arrangeX(g, gp.xValues());
+        arrangeY(g, gp.yConds(), &pool);
+        solve(g, &pool);
+        GllsTrace::setActive(nullptr);
+
+        const std::size_t n = trace.size();
+        // 2000 conditions parsed, batches of lines and chunks of rows
+        BOOST_CHECK_GT(n, 2000);
+        std::ostringstream os;
+        trace.writeJson(os);
+        const std::string json = os.str();
+        for (const char *name : {"readCoef", "nextLine", "attachCond",
+                "CondParser::parse", "arrangeY chunk", "gram chunk",
+                "lu_factorize", "substitute"}) {
+            BOOST_CHECK_MESSAGE(
+                    contains(json, "\"name\": \"" + std::string(name) + '"'),
+                    name);
+        }
+        BOOST_CHECK(contains(json, "\"args\": {\"lines\": 256}"));
+        BOOST_CHECK(contains(json, "\"ph\": \"M\""));
+
+        // nothing is recorded without an active trace
+        std::istringstream again(largeInput(100));
+        GllsParser(again, true).run();
+        BOOST_CHECK_EQUAL(trace.size(), n);
+    }
+
+    BOOST_AUTO_TEST_CASE(Threads) {
+        GllsTrace trace;
+        GllsTrace::setActive(&trace);
+        std::thread t([]() {
+            GllsTrace::Span span("worker", "index", 7);
+        });
+        {
+            GllsTrace::Span span("main");
+        }
+        t.join();
+        GllsTrace::setActive(nullptr);
+        BOOST_CHECK_EQUAL(trace.size(), 2);
+        std::ostringstream os;
+        trace.writeJson(os);
+        const std::string json = os.str();
+        BOOST_CHECK(contains(json, "\"args\": {\"index\": 7}"));
+        // one thread_name record for each thread, with distinct ids
+        std::set<std::string> tids;
+        for (auto i = json.find("\"tid\": "); i != json.npos;
+                i = json.find("\"tid\": ", i + 1)) {
+            tids.insert(json.substr(i, json.find_first_of(",}", i) - i));
+        }
+        BOOST_CHECK_EQUAL(tids.size(), 2);
+
+        // a new trace starts with empty buffers
+        GllsTrace next;
+        GllsTrace::setActive(&next);
+        {
+            GllsTrace::Span span("main");
+        }
+        GllsTrace::setActive(nullptr);
+        BOOST_CHECK_EQUAL(next.size(), 1);
+        BOOST_CHECK_EQUAL(trace.size(), 2);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
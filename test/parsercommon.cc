@@ -87,6 +87,52 @@ BOOST_AUTO_TEST_SUITE(TestNextLine)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(TestParseNumber)
+
+    double parse(const std::string &s, std::size_t consumed) {
+        double v = -12345.0;
+        const char *p = parseNumber(s.data(), s.data() + s.size(), v);
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(p - s.data()), consumed);
+        return v;
+    }
+
+    BOOST_AUTO_TEST_CASE(NoNumber) {
+        BOOST_CHECK_EQUAL(parse("", 0), -12345.0);
+        BOOST_CHECK_EQUAL(parse("a1", 0), -12345.0);
+        BOOST_CHECK_EQUAL(parse("-", 0), -12345.0);
+        BOOST_CHECK_EQUAL(parse(".5", 0), -12345.0);
+    }
+
+    BOOST_AUTO_TEST_CASE(Exact) {
+        BOOST_CHECK_EQUAL(parse("0", 1), 0.0);
+        BOOST_CHECK_EQUAL(parse("010", 3), 10.0);
+        BOOST_CHECK_EQUAL(parse("1.", 2), 1.0);
+        BOOST_CHECK_EQUAL(parse("-2.5", 4), -2.5);
+        BOOST_CHECK_EQUAL(parse("+3e2", 4), 300.0);
+        BOOST_CHECK_EQUAL(parse("0.1", 3), 0.1);
+        BOOST_CHECK_EQUAL(parse("3.1415926e-1", 12), 0.31415926);
+        BOOST_CHECK_EQUAL(parse("4E+8 ", 4), 4e8);
+        BOOST_CHECK_EQUAL(parse("0.000123", 8), 0.000123);
+    }
+
+    BOOST_AUTO_TEST_CASE(Suffix) {
+        BOOST_CHECK_EQUAL(parse("3.25d", 4), 3.25);
+        BOOST_CHECK_EQUAL(parse("7e", 1), 7.0);
+        BOOST_CHECK_EQUAL(parse("7e-x", 1), 7.0);
+        BOOST_CHECK_EQUAL(parse("2*y0", 1), 2.0);
+    }
+
+    BOOST_AUTO_TEST_CASE(Fallback) {
+        BOOST_CHECK_EQUAL(parse("1e-300", 6), 1e-300);
+        BOOST_CHECK_EQUAL(parse("12345678901234567890", 20),
+                12345678901234567890.0);
+        BOOST_CHECK_EQUAL(parse("0.1234567890123456789", 21),
+                0.1234567890123456789);
+        BOOST_CHECK_EQUAL(parse("-0e400", 6), -0.0);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(TestParserError)
 
     BOOST_AUTO_TEST_CASE(Ctor) {
@@ -62,3 +62,60 @@ BOOST_AUTO_TEST_SUITE()
     }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(TestFrozenSymbolList)
+
+    BOOST_AUTO_TEST_CASE(Empty) {
+        const FrozenSymbolList f((SymbolList()));
+        BOOST_CHECK_EQUAL(f.size(), 0);
+        BOOST_CHECK(f.query("") < 0);
+        BOOST_CHECK(f.query("abc") < 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(SameIDs) {
+        SymbolList l;
+        BOOST_REQUIRE(l.insert("Bz"));
+        BOOST_REQUIRE(l.insert("Br"));
+        BOOST_REQUIRE(l.insert("Psi"));
+        BOOST_REQUIRE(l.insert("bz"));
+        const FrozenSymbolList f(l);
+        BOOST_CHECK_EQUAL(f.size(), 4);
+        BOOST_CHECK_EQUAL(f.query("Bz"), 0);
+        BOOST_CHECK_EQUAL(f.query("Br"), 1);
+        BOOST_CHECK_EQUAL(f.query("Psi"), 2);
+        BOOST_CHECK_EQUAL(f.query("bz"), 3);
+        BOOST_CHECK(f.query("B") < 0);
+        BOOST_CHECK(f.query("Psii") < 0);
+        BOOST_CHECK(f.query("") < 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(CharRange) {
+        SymbolList l;
+        BOOST_REQUIRE(l.insert("abc"));
+        BOOST_REQUIRE(l.insert("ab"));
+        const FrozenSymbolList f(l);
+        const char s[] = "abcd";
+        BOOST_CHECK_EQUAL(f.query(s, 3), 0);
+        BOOST_CHECK_EQUAL(f.query(s, 2), 1);
+        BOOST_CHECK(f.query(s, 4) < 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(ManySymbols) {
+        SymbolList l;
+        std::string name;
+        // enough for the table of a perfect hash to grow quadratically
+        for (int i = 0; i < 20000; ++i) {
+            name.clear();
+            for (int n = i; n >= 0; n = n / 26 - 1) {
+                name.push_back(static_cast<char>('a' + n % 26));
+            }
+            BOOST_REQUIRE(l.insert(name));
+        }
+        const FrozenSymbolList f(l);
+        for (const auto &p : l) {
+            BOOST_CHECK_EQUAL(f.query(p.first), p.second);
+            BOOST_CHECK(f.query(p.first + "0") < 0);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,46 @@
+/**
+*   @file testutil.h
+*
+*   Inputs and checks shared by the tests, to be included after
+*   boost/test/unit_test.hpp.
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_TESTUTIL_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_TESTUTIL_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+//! enough rows and conditions for several chunks of every parallel phase
+inline std::string largeInput(int rows)
+{
+    std::ostringstream os;
+    os << "x\ny\n";
+    for (int r = 0; r < rows; ++r) {
+        os << 1 + r % 7 << ' ' << (r * 13) % 11 - 5 << ' ' << r % 3 << '\n';
+    }
+    for (int r = 0; r + 1 < rows; r += 2) {
+        os << "y" << r << " + y" << r+1 << " = " << r % 17 << "\n";
+    }
+    os << "for i in 0.." << rows/4 << ": y{2*i} = 1\n";
+    return os.str();
+}
+
+/**
+    @brief check two solutions entrywise, relative to `percent` after
+           adding 1, so that entries near 0 are compared absolutely
+*/
+inline void checkClose(
+        const std::vector<double> &a,
+        const std::vector<double> &b,
+        double percent = 1e-9)
+{
+    BOOST_REQUIRE_EQUAL(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        BOOST_CHECK_CLOSE(a[i] + 1, b[i] + 1, percent);
+    }
+}
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_TESTUTIL_H_
@@ -0,0 +1,128 @@
+#include "../src/threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ThreadPool
+#endif
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE()
+
+    BOOST_AUTO_TEST_CASE(ctor) {
+        ThreadPool a(3);
+        BOOST_CHECK_EQUAL(a.size(), 3);
+        ThreadPool b;
+        BOOST_CHECK(b.size() >= 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(RunAll) {
+        ThreadPool pool(4);
+        std::vector<int> v(10000, 0);
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            pool.submit([&v, i]() { v[i] = static_cast<int>(i); });
+        }
+        pool.wait();
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            BOOST_REQUIRE_EQUAL(v[i], static_cast<int>(i));
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(NestedSubmit) {
+        ThreadPool pool(4);
+        std::atomic<int> count(0);
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([&pool, &count]() {
+                for (int k = 0; k < 100; ++k) {
+                    pool.submit([&count]() { ++count; });
+                }
+            });
+        }
+        pool.wait();
+        BOOST_CHECK_EQUAL(count.load(), 100 * 100);
+    }
+
+    BOOST_AUTO_TEST_CASE(Exception) {
+        ThreadPool pool(2);
+        std::atomic<int> count(0);
+        for (int i = 0; i < 10; ++i) {
+            pool.submit([&count, i]() {
+                if (i == 3) {
+                    throw std::runtime_error("task failed");
+                }
+                ++count;
+            });
+        }
+        BOOST_CHECK_THROW(pool.wait(), std::runtime_error);
+        BOOST_CHECK_EQUAL(count.load(), 9);
+        BOOST_CHECK_NO_THROW(pool.wait());
+    }
+
+    BOOST_AUTO_TEST_CASE(DestructorWaits) {
+        std::atomic<int> count(0);
+        {
+            ThreadPool pool(2);
+            for (int i = 0; i < 1000; ++i) {
+                pool.submit([&count]() { ++count; });
+            }
+        }
+        BOOST_CHECK_EQUAL(count.load(), 1000);
+    }
+
+    BOOST_AUTO_TEST_CASE(Priority) {
+        // one worker, blocked until all tasks are queued
+        ThreadPool pool(1);
+        std::mutex mutex;
+        std::unique_lock<std::mutex> block(mutex);
+        std::atomic<bool> started(false);
+        pool.submit([&mutex, &started]() {
+            started = true;
+            std::lock_guard<std::mutex> l(mutex);
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        std::vector<int> order;
+        const auto record = [&order](int v) {
+            return [&order, v]() { order.push_back(v); };
+        };
+        pool.submit(record(0), ThreadPool::Priority::LOW);
+        pool.submit(record(1));
+        pool.submit(record(2), ThreadPool::Priority::HIGH);
+        pool.submit(record(3));
+        block.unlock();
+        pool.wait();
+        BOOST_REQUIRE_EQUAL(order.size(), 4);
+        // high, then the own queue LIFO, then low
+        BOOST_CHECK(order == std::vector<int>({2, 3, 1, 0}));
+    }
+
+    BOOST_AUTO_TEST_CASE(ParallelFor) {
+        for (const unsigned threads : {1u, 4u}) {
+            ThreadPool pool(threads);
+            std::vector<int> v(1000, 0);
+            pool.parallelFor(v.size(), [&v](std::size_t i) { v[i] += 1; });
+            BOOST_CHECK(std::all_of(v.begin(), v.end(),
+                    [](int x) { return x == 1; }));
+            // nested in every task of a busy pool
+            std::atomic<int> count(0);
+            for (int i = 0; i < 8; ++i) {
+                pool.submit([&pool, &count]() {
+                    pool.parallelFor(100, [&count](std::size_t) { ++count; });
+                });
+            }
+            pool.wait();
+            BOOST_CHECK_EQUAL(count.load(), 800);
+            BOOST_CHECK_THROW(pool.parallelFor(10, [](std::size_t i) {
+                        if (i == 7) {
+                            throw std::runtime_error("failed");
+                        }
+                    }), std::runtime_error);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+#include "protocol.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [-s socket] [-v] [--load file] id < conditions\n"
+              << "  -s PATH     the socket of glls-server, default "
+              << defaultSocketPath() << "\n"
+              << "  -v          print the residual statistics to stderr\n"
+              << "  --load F    send the input file F as the matrix id "
+                 "first\n";
+}
+
+static std::string readAll(std::istream &is)
+{
+    return std::string(
+            (std::istreambuf_iterator<char>(is)),
+            std::istreambuf_iterator<char>());
+}
+
+static bool request(int fd, const Message &m, Message &r)
+{
+    if (!sendMessage(fd, m) || !receiveMessage(fd, r)) {
+        std::cerr << "connection to the server failed" << std::endl;
+        return false;
+    }
+    if (r.command != "OK") {
+        std::cerr << r.body << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string path = defaultSocketPath();
+    std::string load;
+    std::string id;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "--load") == 0 && i+1 < argc) {
+            load = argv[++i];
+        } else if (std::strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (id.empty() && argv[i][0] != '-') {
+            id = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (id.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path too long: " << path << std::endl;
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(
+            fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "failed to connect to " << path << std::endl;
+        return 1;
+    }
+    Message m, r;
+    if (!load.empty()) {
+        std::ifstream is(load, std::ios::binary);
+        if (!is) {
+            std::cerr << "failed to open " << load << std::endl;
+            return 1;
+        }
+        m.command = "LOAD";
+        m.args.assign(1, id);
+        m.body = readAll(is);
+        if (!request(fd, m, r)) {
+            return 1;
+        }
+    }
+    m.command = "SOLVE";
+    m.args.assign(1, id);
+    m.body = readAll(std::cin);
+    const bool ok = request(fd, m, r);
+    close(fd);
+    if (!ok) {
+        std::cout << '\n';
+        return 0;
+    }
+    // print x like glls does
+    const auto eol = r.body.find('\n');
+    std::istringstream xs(r.body.substr(0, eol));
+    double x;
+    while (xs >> x) {
+        std::cout << x << ' ';
+    }
+    std::cout << '\n';
+    if (verbose && eol != r.body.npos) {
+        std::cerr << r.body.substr(eol + 1);
+    }
+    return 0;
+}
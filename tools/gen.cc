@@ -0,0 +1,116 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [options] [-o input] [--solution file]\n"
+              << "  --x N          length of X, default 50\n"
+              << "  --names N      number of Y names, default 3\n"
+              << "  --rows N       rows of M, default 3000\n"
+              << "  --density D    fraction of nonzero entries of M, "
+                 "default 1\n"
+              << "  --conditions N condition lines on Y, default 100\n"
+              << "  --mix P:N:C:A  weights of plain, nested, chained and "
+                 "aggregate\n"
+              << "                 conditions, default 4:2:1:1\n"
+              << "  --depth N      nesting depth of nested conditions, "
+                 "default 3\n"
+              << "  --fix N        number of X values given, default 0\n"
+              << "  --seed N       seed of the random numbers, default 1\n"
+              << "  -o FILE        write the input to FILE instead of "
+                 "stdout\n"
+              << "  --solution F   write the planted X to F, as printed "
+                 "by glls\n";
+}
+
+static bool parseMix(const char *s, GeneratorOptions &o)
+{
+    return std::sscanf(s, "%d:%d:%d:%d",
+            &o.plain, &o.nested, &o.chained, &o.aggregate) == 4;
+}
+
+int main(int argc, char *argv[])
+{
+    GeneratorOptions o;
+    std::string output;
+    std::string solution;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i+1 < argc;
+        const char *const value = hasValue ? argv[i+1] : "";
+        bool ok = hasValue;
+        if (std::strcmp(argv[i], "--x") == 0) {
+            o.xSize = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--names") == 0) {
+            o.names = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--rows") == 0) {
+            o.rows = std::atol(value);
+        } else if (std::strcmp(argv[i], "--density") == 0) {
+            o.density = std::atof(value);
+        } else if (std::strcmp(argv[i], "--conditions") == 0) {
+            o.conditions = std::atol(value);
+        } else if (std::strcmp(argv[i], "--mix") == 0) {
+            ok = ok && parseMix(value, o);
+        } else if (std::strcmp(argv[i], "--depth") == 0) {
+            o.depth = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--fix") == 0) {
+            o.fixed = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            o.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(argv[i], "-o") == 0) {
+            output = value;
+        } else if (std::strcmp(argv[i], "--solution") == 0) {
+            solution = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+    if (std::min(o.conditions, o.rows) + o.fixed < o.xSize) {
+        std::cerr << "warning: fewer conditions or rows than X values, "
+                     "the planted X is not the solution" << std::endl;
+    }
+
+    std::vector<double> x;
+    try {
+        if (output.empty()) {
+            x = generateInput(std::cout, o);
+        } else {
+            std::ofstream os(output, std::ios::binary);
+            x = generateInput(os, o);
+            if (!os) {
+                std::cerr << "failed to write " << output << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+    if (!solution.empty()) {
+        std::ofstream os(solution);
+        for (const auto v : x) {
+            os << v << ' ';
+        }
+        os << '\n';
+        if (!os) {
+            std::cerr << "failed to write " << solution << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+//! the buffered text is written once it exceeds this size
+constexpr std::size_t FLUSH_SIZE = 1 << 20;
+
+//! append n/1000 in the shortest decimal form
+void appendMilli(std::string &out, long n)
+{
+    if (n < 0) {
+        out += '-';
+        n = -n;
+    }
+    out += std::to_string(n / 1000);
+    int frac = n % 1000;
+    if (frac) {
+        char digits[5] = {'.', char('0' + frac / 100),
+                char('0' + frac / 10 % 10), char('0' + frac % 10), 0};
+        int len = 4;
+        while (digits[len-1] == '0') {
+            --len;
+        }
+        out.append(digits, len);
+    }
+}
+
+void appendDouble(std::string &out, double v)
+{
+    char s[32];
+    std::snprintf(s, sizeof(s), "%.17g", v);
+    out += s;
+}
+
+//! a piece of a condition with its value for the planted solution
+struct Expr
+{
+    std::string text;
+    double value;
+};
+
+class Generator
+{
+public:
+    Generator(std::ostream &os, const GeneratorOptions &o);
+    std::vector<double> run();
+private:
+    void flush(bool force = false);
+    void writeMatrix();
+    void writeConditions();
+    std::string symbol(long row) const
+        { return names_[row % o_.names] + std::to_string(row / o_.names); }
+    int uniform(int lo, int hi)
+        { return std::uniform_int_distribution<int>(lo, hi)(gen_); }
+    long row()
+        { return std::uniform_int_distribution<long>(0, rows_ - 1)(gen_); }
+    Expr leaf();
+    Expr sum(int terms);
+    Expr nested(int depth);
+    Expr aggregate();
+    void equation(const Expr &lhs, const Expr &rhs);
+
+    std::ostream &os_;
+    const GeneratorOptions &o_;
+    std::mt19937_64 gen_;
+    long rows_;
+    std::vector<std::string> names_;
+    std::vector<double> x_;
+    //! Y = M*X of the planted X
+    std::vector<double> y_;
+    std::string out_;
+};
+
+Generator::Generator(std::ostream &os, const GeneratorOptions &o)
+    : os_(os), o_(o), gen_(o.seed),
+      rows_((o.rows + o.names - 1) / o.names * o.names)
+{
+    if (o.names == 1) {
+        names_.push_back("y");
+    }
+    for (int i = 0; o.names > 1 && i < o.names; ++i) {
+        std::string letters;
+        int k = i;
+        do {
+            letters.insert(letters.begin(), char('a' + k % 26));
+            k /= 26;
+        } while (k);
+        names_.push_back("y" + letters);
+    }
+}
+
+void Generator::flush(bool force)
+{
+    if (force || out_.size() > FLUSH_SIZE) {
+        os_.write(out_.data(), out_.size());
+        out_.clear();
+    }
+}
+
+void Generator::writeMatrix()
+{
+    std::bernoulli_distribution nonzero(o_.density);
+    std::vector<long> entries(o_.xSize);
+    y_.resize(rows_);
+    for (long r = 0; r < rows_; ++r) {
+        double y = 0;
+        for (int j = 0; j < o_.xSize; ++j) {
+            // keep at least one entry of every row
+            const bool keep = nonzero(gen_) || j == r % o_.xSize;
+            entries[j] = keep ? uniform(-9999, 9999) : 0;
+            y += entries[j] / 1000.0 * x_[j];
+            if (j) {
+                out_ += ' ';
+            }
+            appendMilli(out_, entries[j]);
+        }
+        out_ += '\n';
+        y_[r] = y;
+        flush();
+    }
+}
+
+Expr Generator::leaf()
+{
+    const long r = row();
+    const int c = uniform(1, 9);
+    if (c == 1) {
+        return Expr{symbol(r), y_[r]};
+    }
+    return Expr{std::to_string(c) + "*" + symbol(r), c * y_[r]};
+}
+
+Expr Generator::sum(int terms)
+{
+    Expr e = leaf();
+    for (int i = 1; i < terms; ++i) {
+        const Expr t = leaf();
+        const bool minus = uniform(0, 1);
+        e.text += (minus ? " - " : " + ") + t.text;
+        e.value += minus ? -t.value : t.value;
+    }
+    return e;
+}
+
+Expr Generator::nested(int depth)
+{
+    if (depth == 0) {
+        return leaf();
+    }
+    Expr a = nested(depth - 1);
+    const int c = uniform(2, 9);
+    switch (uniform(0, 3)) {
+    case 0:
+    case 1: {
+        const Expr b = nested(depth - 1);
+        const bool minus = uniform(0, 1);
+        return Expr{"(" + a.text + (minus ? " - " : " + ") + b.text + ")",
+                minus ? a.value - b.value : a.value + b.value};
+    }
+    case 2:
+        return Expr{std::to_string(c) + "*(" + a.text + ")", c * a.value};
+    default:
+        return Expr{"(" + a.text + ")/" + std::to_string(c), a.value / c};
+    }
+}
+
+Expr Generator::aggregate()
+{
+    const long perName = rows_ / o_.names;
+    if (perName < 2) {
+        return sum(2);
+    }
+    const int name = uniform(0, o_.names - 1);
+    const long lo = std::uniform_int_distribution<long>(0, perName - 2)(gen_);
+    const long hi = lo + uniform(1, static_cast<int>(
+            std::min<long>(50, perName - 1 - lo)));
+    double v = 0;
+    for (long i = lo; i <= hi; ++i) {
+        v += y_[i * o_.names + name];
+    }
+    const bool mean = uniform(0, 1);
+    if (mean) {
+        v /= hi - lo + 1;
+    }
+    return Expr{std::string(mean ? "mean(" : "sum(")
+            + names_[name] + std::to_string(lo) + ".."
+            + names_[name] + std::to_string(hi) + ")", v};
+}
+
+//! `lhs = rhs + constant` with the constant making it hold
+void Generator::equation(const Expr &lhs, const Expr &rhs)
+{
+    out_ += lhs.text;
+    out_ += " = ";
+    if (!rhs.text.empty()) {
+        out_ += rhs.text;
+        out_ += " + ";
+    }
+    appendDouble(out_, lhs.value - rhs.value);
+}
+
+void Generator::writeConditions()
+{
+    const int weights[] = {o_.plain, o_.nested, o_.chained, o_.aggregate};
+    std::discrete_distribution<int> kind(weights, weights + 4);
+    const Expr none = {"", 0.0};
+    for (long i = 0; i < o_.conditions; ++i) {
+        switch (kind(gen_)) {
+        case 0:
+            equation(sum(uniform(1, 3)), none);
+            break;
+        case 1:
+            equation(nested(o_.depth), none);
+            break;
+        case 2: {
+            const Expr a = sum(2);
+            const Expr b = sum(2);
+            const Expr c = leaf();
+            equation(a, b);
+            out_ += " = " + c.text + " + ";
+            appendDouble(out_, a.value - c.value);
+            break;
+        }
+        default: {
+            Expr a = aggregate();
+            const Expr b = leaf();
+            a.text += " - " + b.text;
+            a.value -= b.value;
+            equation(a, none);
+            break;
+        }
+        }
+        out_ += '\n';
+        flush();
+    }
+    std::vector<int> order(o_.xSize);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen_);
+    std::sort(order.begin(), order.begin() + o_.fixed);
+    for (int i = 0; i < o_.fixed; ++i) {
+        out_ += "x" + std::to_string(order[i]) + " = ";
+        appendMilli(out_, std::lround(x_[order[i]] * 1000));
+        out_ += '\n';
+    }
+}
+
+std::vector<double> Generator::run()
+{
+    x_.resize(o_.xSize);
+    for (auto &v : x_) {
+        v = uniform(-5000, 5000) / 1000.0;
+    }
+    out_ += "# glls-gen --seed " + std::to_string(o_.seed) + "\nx\n";
+    for (const auto &name : names_) {
+        out_ += name + ' ';
+    }
+    out_ += '\n';
+    writeMatrix();
+    writeConditions();
+    flush(true);
+    return x_;
+}
+
+} // namespace
+
+std::vector<double> generateInput(std::ostream &os, const GeneratorOptions &o)
+{
+    if (o.xSize <= 0 || o.names <= 0 || o.rows <= 0) {
+        throw std::invalid_argument("the sizes must be positive");
+    }
+    if (!(o.density > 0 && o.density <= 1)) {
+        throw std::invalid_argument("the density must be in (0, 1]");
+    }
+    if (o.plain < 0 || o.nested < 0 || o.chained < 0 || o.aggregate < 0
+            || (o.conditions > 0
+                && o.plain + o.nested + o.chained + o.aggregate == 0)) {
+        throw std::invalid_argument("invalid mix of conditions");
+    }
+    if (o.conditions < 0 || o.depth < 0 || o.depth > 20
+            || o.fixed < 0 || o.fixed > o.xSize) {
+        throw std::invalid_argument("invalid number of conditions");
+    }
+    return Generator(os, o).run();
+}
@@ -0,0 +1,57 @@
+/**
+*   @file generator.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GENERATOR_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GENERATOR_H_
+
+#include <iosfwd>
+#include <vector>
+
+struct GeneratorOptions
+{
+    GeneratorOptions()
+        : xSize(50), names(3), rows(3000), density(1.0), conditions(100),
+          plain(4), nested(2), chained(1), aggregate(1), depth(3), fixed(0),
+          seed(1)
+    {}
+    //! length of the X vector, i.e. columns of M
+    int xSize;
+    //! number of Y names
+    int names;
+    //! rows of M, rounded up to a multiple of `names`
+    long rows;
+    //! fraction of nonzero entries of M
+    double density;
+    //! number of condition lines on Y
+    long conditions;
+    /**
+        relative weights of the kinds of condition lines: sums of a few
+        terms, nested expressions of `depth` levels, chains of two `=`, and
+        aggregates
+    */
+    int plain;
+    int nested;
+    int chained;
+    int aggregate;
+    int depth;
+    //! number of X values given by a condition
+    int fixed;
+    unsigned seed;
+};
+
+/**
+    @brief write a random input, see readme.md, which is satisfied exactly
+           by a planted X
+
+    The entries of M and X are decimals of three digits, so they are parsed
+    exactly, and every condition holds for Y = M*X. Hence X is the solution
+    whenever the conditions determine it, i.e. the arranged problem has
+    full column rank, which needs at least `xSize - fixed` conditions and
+    rows.
+
+    @throw std::invalid_argument for inconsistent options
+    @return the planted X
+*/
+std::vector<double> generateInput(std::ostream &, const GeneratorOptions &);
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GENERATOR_H_
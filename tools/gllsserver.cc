@@ -0,0 +1,194 @@
+#include "gllsserver.h"
+#include "../src/gllssession.h"
+#include "../src/parsercommon.h"
+#include "../src/solveglls.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+static Message reply(const std::string &command, const std::string &body)
+{
+    Message m;
+    m.command = command;
+    m.body = body;
+    return m;
+}
+
+static std::string errorText(const ParserError &e)
+{
+    return "Error on input line " + std::to_string(e.line()) + ": " + e.what();
+}
+
+GllsServer::GllsServer(std::size_t budget)
+    : budget_(budget), clock_(0)
+{
+}
+
+GllsServer::~GllsServer()
+{
+}
+
+void GllsServer::addMatrixFile(const std::string &id, const std::string &path)
+{
+    std::shared_ptr<Slot> slot(new Slot);
+    slot->path = path;
+    slot->usage = 0;
+    slot->lastUse = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_[id] = slot;
+}
+
+std::size_t GllsServer::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t n = 0;
+    for (const auto &s : slots_) {
+        n += s.second->usage;
+    }
+    return n;
+}
+
+std::size_t GllsServer::loadedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::count_if(slots_.cbegin(), slots_.cend(),
+            [](const std::pair<const std::string, std::shared_ptr<Slot> > &s)
+            { return s.second->usage > 0; });
+}
+
+Message GllsServer::handle(const Message &request)
+{
+    if (request.args.size() != 1) {
+        return reply("ERR", "expect one matrix id");
+    }
+    if (request.command == "LOAD") {
+        return load(request.args[0], request.body);
+    }
+    if (request.command == "SOLVE") {
+        return solve(request.args[0], request.body);
+    }
+    return reply("ERR", "unknown command " + request.command);
+}
+
+Message GllsServer::load(const std::string &id, const std::string &text)
+{
+    std::unique_ptr<GllsSession> session(new GllsSession);
+    try {
+        session->update(text);
+    } catch (const ParserError &e) {
+        return reply("ERR", errorText(e));
+    } catch (const std::exception &e) {
+        return reply("ERR", e.what());
+    }
+    std::shared_ptr<Slot> slot(new Slot);
+    slot->text = text;
+    slot->usage = session->memoryUsage();
+    slot->session = std::move(session);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot->lastUse = ++clock_;
+        slots_[id] = slot;
+    }
+    evict();
+    return reply("OK", "");
+}
+
+Message GllsServer::solve(const std::string &id, const std::string &conditions)
+{
+    std::shared_ptr<Slot> slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = slots_.find(id);
+        if (it == slots_.end()) {
+            return reply("ERR", "unknown matrix " + id);
+        }
+        slot = it->second;
+        slot->lastUse = ++clock_;
+    }
+    Message m;
+    {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (!slot->session) {
+            std::string text = slot->text;
+            if (!slot->path.empty()) {
+                std::ifstream is(slot->path, std::ios::binary);
+                if (!is) {
+                    return reply("ERR", "failed to open " + slot->path);
+                }
+                text.assign(std::istreambuf_iterator<char>(is),
+                        std::istreambuf_iterator<char>());
+            }
+            std::unique_ptr<GllsSession> session(new GllsSession);
+            try {
+                session->update(text);
+            } catch (const ParserError &e) {
+                return reply("ERR", "matrix " + id + ": " + errorText(e));
+            } catch (const std::exception &e) {
+                return reply("ERR", "matrix " + id + ": " + e.what());
+            }
+            slot->session = std::move(session);
+        }
+        GllsSession &session = *slot->session;
+        try {
+            session.updateConditions(conditions, 1);
+            const auto x = session.solve();
+            const auto r = residual(session.arranged(), x);
+            double norm2 = 0.0;
+            double normInf = 0.0;
+            for (const auto v : r) {
+                norm2 += v * v;
+                normInf = std::max(normInf, std::fabs(v));
+            }
+            std::ostringstream os;
+            os.precision(17);
+            for (const auto v : x) {
+                os << v << ' ';
+            }
+            os << "\nresidual " << r.size() << ' '
+               << std::sqrt(norm2) << ' ' << normInf << '\n';
+            m = reply("OK", os.str());
+        } catch (const ParserError &e) {
+            m = reply("ERR", errorText(e));
+        } catch (const std::exception &e) {
+            m = reply("ERR", e.what());
+        }
+        slot->usage = session.memoryUsage();
+    }
+    evict();
+    return m;
+}
+
+/**
+    Drop the least recently used sessions until the budget is kept. The
+    most recent session is always kept, and busy sessions are skipped.
+*/
+void GllsServer::evict()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<Slot> > loaded;
+    std::size_t total = 0;
+    for (const auto &s : slots_) {
+        if (s.second->usage > 0) {
+            loaded.push_back(s.second);
+            total += s.second->usage;
+        }
+    }
+    std::sort(loaded.begin(), loaded.end(),
+            [](const std::shared_ptr<Slot> &a, const std::shared_ptr<Slot> &b)
+            { return a->lastUse < b->lastUse; });
+    for (std::size_t i = 0; i + 1 < loaded.size() && total > budget_; ++i) {
+        Slot &s = *loaded[i];
+        std::unique_lock<std::mutex> slotLock(s.mutex, std::try_to_lock);
+        if (!slotLock.owns_lock()) {
+            continue;
+        }
+        s.session.reset();
+        total -= s.usage;
+        s.usage = 0;
+    }
+}
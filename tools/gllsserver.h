@@ -0,0 +1,66 @@
+/**
+*   @file gllsserver.h
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_GLLSSERVER_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_GLLSSERVER_H_
+
+#include "protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class GllsSession;
+
+/**
+    @brief named matrices kept in memory for requests of glls-client
+
+    Each matrix is held by a GllsSession, so repeated requests against the
+    same matrix parse only new condition lines and reuse the factorization
+    when only constants differ. When the memory of all sessions exceeds the
+    budget, the least recently used ones are dropped, and loaded again from
+    their input on the next request. Requests on different matrices run
+    concurrently.
+*/
+class GllsServer
+{
+public:
+    //! @param budget bytes of memory for the sessions
+    explicit GllsServer(std::size_t budget);
+    ~GllsServer();
+    //! register a matrix from a file, which is read on the first request
+    void addMatrixFile(const std::string &id, const std::string &path);
+    //! @return the reply to a request, see protocol.h
+    Message handle(const Message &request);
+    //! @return approximate memory of the loaded sessions
+    std::size_t memoryUsage() const;
+    //! @return the number of loaded sessions
+    std::size_t loadedCount() const;
+private:
+    GllsServer(const GllsServer &) = delete;
+    GllsServer &operator=(const GllsServer &) = delete;
+    struct Slot
+    {
+        //! the input file, empty if the matrix came with LOAD
+        std::string path;
+        //! the input of LOAD, kept to load the session again
+        std::string text;
+        std::mutex mutex;
+        std::unique_ptr<GllsSession> session;
+        //! memory of the session, 0 if not loaded
+        std::atomic<std::size_t> usage;
+        std::uint64_t lastUse;
+    };
+    Message load(const std::string &id, const std::string &text);
+    Message solve(const std::string &id, const std::string &conditions);
+    void evict();
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Slot> > slots_;
+    const std::size_t budget_;
+    std::uint64_t clock_;
+};
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_GLLSSERVER_H_
@@ -0,0 +1,112 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//! the longest accepted header line
+static const std::size_t MAX_HEADER = 4096;
+//! the body grows by this much as it arrives, not by the announced length
+static const std::size_t BODY_CHUNK = 1 << 20;
+
+static bool sendAll(int fd, const char *p, std::size_t n)
+{
+    while (n > 0) {
+        const ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) {
+            continue;
+        }
+        if (k <= 0) {
+            return false;
+        }
+        p += k;
+        n -= k;
+    }
+    return true;
+}
+
+static bool receiveAll(int fd, char *p, std::size_t n)
+{
+    while (n > 0) {
+        const ssize_t k = recv(fd, p, n, 0);
+        if (k < 0 && errno == EINTR) {
+            continue;
+        }
+        if (k <= 0) {
+            return false;
+        }
+        p += k;
+        n -= k;
+    }
+    return true;
+}
+
+bool sendMessage(int fd, const Message &m)
+{
+    std::string header = m.command;
+    for (const auto &a : m.args) {
+        header += ' ';
+        header += a;
+    }
+    header += ' ' + std::to_string(m.body.size()) + '\n';
+    return sendAll(fd, header.data(), header.size())
+        && sendAll(fd, m.body.data(), m.body.size());
+}
+
+bool receiveMessage(int fd, Message &m)
+{
+    // the header is short, so it is read bytewise to leave the body intact
+    std::string header;
+    char c;
+    while (true) {
+        if (!receiveAll(fd, &c, 1)) {
+            return false;
+        }
+        if (c == '\n') {
+            break;
+        }
+        header += c;
+        if (header.size() > MAX_HEADER) {
+            return false;
+        }
+    }
+    std::istringstream ss(header);
+    std::vector<std::string> fields;
+    std::string f;
+    while (ss >> f) {
+        fields.push_back(f);
+    }
+    if (fields.size() < 2) {
+        return false;
+    }
+    char *end;
+    const unsigned long long n = std::strtoull(fields.back().c_str(), &end, 10);
+    if (*end != '\0' || n > MAX_BODY) {
+        return false;
+    }
+    m.command = fields.front();
+    m.args.assign(fields.begin() + 1, fields.end() - 1);
+    m.body.clear();
+    while (m.body.size() < n) {
+        const std::size_t k = m.body.size();
+        m.body.resize(k + std::min<std::size_t>(n - k, BODY_CHUNK));
+        if (!receiveAll(fd, &m.body[k], m.body.size() - k)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string defaultSocketPath()
+{
+    return "/tmp/glls-" + std::to_string(getuid()) + ".sock";
+}
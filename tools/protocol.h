@@ -0,0 +1,42 @@
+/**
+*   @file protocol.h
+*
+*   Messages between glls-server and glls-client over a stream socket. A
+*   message is a header line, whose last field is the length of the body,
+*   followed by the body:
+*
+*       LOAD <matrix id> <n>\n<input file of the matrix, n bytes>
+*       SOLVE <matrix id> <n>\n<condition lines, n bytes>
+*       OK <n>\n<reply, n bytes>
+*       ERR <n>\n<error message, n bytes>
+*
+*   The reply of SOLVE is `x` on the first line, followed by the line
+*   `residual <rows> <2-norm> <max-norm>`. A body longer than MAX_BODY is
+*   a malformed message.
+*/
+#ifndef _GENERAL_LINEAR_LEAST_SQUARES_PROTOCOL_H_
+#define _GENERAL_LINEAR_LEAST_SQUARES_PROTOCOL_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! the longest accepted body, 1 GiB
+const std::size_t MAX_BODY = std::size_t(1) << 30;
+
+struct Message
+{
+    std::string command;
+    std::vector<std::string> args;
+    std::string body;
+};
+
+//! @return false if the connection failed
+bool sendMessage(int fd, const Message &);
+//! @return false on the end of the connection or on a malformed message
+bool receiveMessage(int fd, Message &);
+
+//! @return the socket path used without `-s`
+std::string defaultSocketPath();
+
+#endif //_GENERAL_LINEAR_LEAST_SQUARES_PROTOCOL_H_
@@ -0,0 +1,103 @@
+#include "gllsserver.h"
+#include "protocol.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog
+              << " [-s socket] [-m megabytes] [id=file ...]\n"
+              << "  -s PATH   the Unix domain socket, default "
+              << defaultSocketPath() << "\n"
+              << "  -m MB     memory budget of the loaded matrices, "
+                 "default 1024\n"
+              << "  id=file   serve the matrix of the input file as id\n";
+}
+
+//! a failure of one connection closes it, never the server
+static void serve(GllsServer &server, int fd)
+{
+    try {
+        Message request;
+        while (receiveMessage(fd, request)) {
+            if (!sendMessage(fd, server.handle(request))) {
+                break;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "connection " << fd << ": " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "connection " << fd << ": unknown error" << std::endl;
+    }
+    close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string path = defaultSocketPath();
+    std::size_t budget = 1024;
+    std::vector<std::pair<std::string, std::string> > files;
+    for (int i = 1; i < argc; ++i) {
+        const char *eq = std::strchr(argv[i], '=');
+        if (std::strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "-m") == 0 && i+1 < argc) {
+            budget = std::strtoul(argv[++i], nullptr, 10);
+        } else if (eq && eq != argv[i]) {
+            files.emplace_back(std::string(argv[i], eq - argv[i]), eq + 1);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    GllsServer server(budget << 20);
+    for (const auto &f : files) {
+        server.addMatrixFile(f.first, f.second);
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path too long: " << path << std::endl;
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (fd < 0
+            || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+            || listen(fd, 64) < 0) {
+        std::cerr << "failed to listen on " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "listening on " << path << std::endl;
+    while (true) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        std::thread(serve, std::ref(server), client).detach();
+    }
+    close(fd);
+    unlink(path.c_str());
+    return 1;
+}